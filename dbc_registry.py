@@ -0,0 +1,338 @@
+"""
+Generates a table-driven signal decoder from a DBC file, alongside the cantools C source.
+
+For <name>.dbc this writes <name>_signals.hpp and <name>_signals.cpp, containing:
+  - an index for every signal in a CANSignalStore, e.g. BATTERY_BMS_BATT_STATUS_SO_C_SIGNAL
+  - a decode function per frame, with the bit extraction unrolled into shifts and masks of the data bytes
+  - <name>_frame_decoders, sorted by frame ID for findFrameDecoder
+  - <name>_signal_info, the name of every signal and the period of its frame, from GenMsgCycleTime
+
+and <name>_fixed.hpp, an integer codec for code which doesn't need floats. A fixed-point value counts the signal's
+resolution, its DBC scale, so decoding is the bit extraction plus a constant offset and never touches the FPU:
+  - <NAME>_<MSG>_<SIG>_RESOLUTION, the physical value of one count
+  - <name>_<msg>_<sig>_fixed(physical), constexpr, for converting thresholds at compile time
+  - <name>_<msg>_<sig>_get_fixed(data) and _set_fixed(data, value) for one signal
+  - <name>_<msg>_fixed_t with <name>_<msg>_decode_fixed and _encode_fixed for whole frames
+
+Usage: python dbc_registry.py -o .dbc_gen dbc/battery.dbc
+"""
+
+import argparse
+import pathlib
+import re
+
+import cantools
+
+
+def snake_case(name):
+    # the same conversion cantools uses for its generated names, so the two sets of names line up
+    name = re.sub(r"(.)([A-Z][a-z]+)", r"\1_\2", name)
+    name = re.sub(r"(_+)", "_", name)
+    name = re.sub(r"([a-z0-9])([A-Z])", r"\1_\2", name)
+    return name.lower()
+
+
+def frame_bits(signal):
+    """
+    The frame bit, counting from bit 0 of byte 0, of each signal bit from the least significant.
+    """
+    if signal.byte_order == "little_endian":
+        return [signal.start + i for i in range(signal.length)]
+
+    # big endian signals start at their most significant bit, and run down through each byte then on to the next
+    bits = []
+    pos = signal.start
+    for _ in range(signal.length):
+        bits.append(pos)
+        pos = pos + 15 if pos % 8 == 0 else pos - 1
+    return list(reversed(bits))
+
+
+def byte_segments(signal):
+    """
+    The part of the signal in each data byte it covers: (byte, first bit in the byte, number of bits, first signal bit).
+    """
+    segments = []
+    bits = frame_bits(signal)
+
+    i = 0
+    while i < len(bits):
+        byte = bits[i] // 8
+        first = bits[i] % 8
+
+        # signal bits in the same byte are always contiguous
+        n = 1
+        while i + n < len(bits) and bits[i + n] // 8 == byte:
+            n += 1
+
+        segments.append((byte, first, n, i))
+        i += n
+
+    return segments
+
+
+def extract_terms(signal, raw_type):
+    """
+    One shift and mask term per data byte the signal covers.
+    """
+    terms = []
+
+    for byte, first, n, i in byte_segments(signal):
+        term = f"data[{byte}]"
+        if first != 0:
+            term = f"({term} >> {first})"
+        if first + n < 8:
+            term = f"({term} & 0x{(1 << n) - 1:x}u)"
+        term = f"({raw_type}){term}"
+        if i != 0:
+            term = f"({term} << {i})"
+        terms.append(term)
+
+    return terms
+
+
+def insert_statements(signal, raw):
+    """
+    Statements writing the raw value into each data byte the signal covers, leaving other signals' bits alone.
+    """
+    statements = []
+
+    for byte, first, n, i in byte_segments(signal):
+        mask = (1 << n) - 1
+        value = raw if i == 0 else f"({raw} >> {i})"
+        if n < 8:
+            value = f"({value} & 0x{mask:x}u)"
+        if first != 0:
+            value = f"({value} << {first})"
+
+        if n == 8:
+            statements.append(f"data[{byte}] = (uint8_t){value};")
+        else:
+            statements.append(f"data[{byte}] = (uint8_t)((data[{byte}] & 0x{0xff & ~(mask << first):02x}u) | {value});")
+
+    return statements
+
+
+def float_literal(value):
+    text = repr(float(value))
+    if "e" not in text and "." not in text:
+        text += ".0"
+    return text + "f"
+
+
+def fixed_type(signal):
+    if signal.length < 32 or (signal.length == 32 and signal.is_signed):
+        return "int32_t"
+    return "int64_t"
+
+
+def generate_fixed(dbc_path, prefix, messages):
+    PREFIX = prefix.upper()
+
+    header = [
+        f"// Generated from {dbc_path.name} by dbc_registry.py, do not edit",
+        "#pragma once",
+        "",
+        "#include <stdint.h>",
+        "",
+    ]
+
+    for message in messages:
+        name = f"{prefix}_{snake_case(message.name)}"
+        fixed_signals = []
+
+        for signal in message.signals:
+            if signal.multiplexer_ids is not None or signal.is_float:
+                continue
+
+            # the offset is added to the raw count, so must be a whole number of counts
+            offset_counts = signal.offset / signal.scale
+            if offset_counts != int(offset_counts):
+                print(f"{dbc_path}: {message.name}.{signal.name} has an offset of part of a count, no fixed-point codec")
+                continue
+            offset_counts = int(offset_counts)
+
+            fixed_signals.append(signal)
+            sig = f"{name}_{snake_case(signal.name)}"
+            SIG = sig.upper()
+            value_type = fixed_type(signal)
+            raw_type = "uint32_t" if signal.length <= 32 else "uint64_t"
+            raw = " | ".join(extract_terms(signal, raw_type))
+
+            if signal.is_signed and signal.length < (32 if raw_type == "uint32_t" else 64):
+                width = 32 if raw_type == "uint32_t" else 64
+                signed_type = "int32_t" if width == 32 else "int64_t"
+                unused = width - signal.length
+                raw = f"({signed_type})(({raw}) << {unused}) >> {unused}"
+                if signed_type != value_type:
+                    raw = f"({value_type})({raw})"
+            else:
+                raw = f"({value_type})({raw})"
+
+            offset = f" + {offset_counts}" if offset_counts > 0 else (f" - {-offset_counts}" if offset_counts < 0 else "")
+            unoffset = f" - {offset_counts}" if offset_counts > 0 else (f" + {-offset_counts}" if offset_counts < 0 else "")
+
+            header += [
+                f"// {message.name}.{signal.name}: {signal.length} bits, scale {signal.scale:g}, offset {signal.offset:g}",
+                f"#define {SIG}_RESOLUTION {float_literal(signal.scale)}",
+                "",
+                f"static constexpr {value_type} {sig}_fixed(float value) {{",
+                f"    return ({value_type})(value / {SIG}_RESOLUTION + (value < 0 ? -0.5f : 0.5f));",
+                "}",
+                "",
+                f"static inline {value_type} {sig}_get_fixed(const uint8_t* data) {{",
+                f"    return {raw}{offset};",
+                "}",
+                "",
+                f"static inline void {sig}_set_fixed(uint8_t* data, {value_type} value) {{",
+                f"    {raw_type} raw = ({raw_type})(value{unoffset});",
+            ]
+            header += ["    " + statement for statement in insert_statements(signal, "raw")]
+            header += ["}", ""]
+
+        header.append(f"struct {name}_fixed_t {{")
+        for signal in fixed_signals:
+            header.append(f"    {fixed_type(signal)} {snake_case(signal.name)};")
+        header += ["};", ""]
+
+        header.append(f"static inline void {name}_decode_fixed(struct {name}_fixed_t* dst, const uint8_t* data) {{")
+        for signal in fixed_signals:
+            header.append(f"    dst->{snake_case(signal.name)} = {name}_{snake_case(signal.name)}_get_fixed(data);")
+        if not fixed_signals:
+            header += ["    (void)dst;", "    (void)data;"]
+        header += ["}", ""]
+
+        header.append(f"static inline void {name}_encode_fixed(uint8_t* data, const struct {name}_fixed_t* src) {{")
+        header += [f"    data[{i}] = 0;" for i in range(message.length)]
+        for signal in fixed_signals:
+            header.append(f"    {name}_{snake_case(signal.name)}_set_fixed(data, src->{snake_case(signal.name)});")
+        if not fixed_signals:
+            header.append("    (void)src;")
+        header += ["}", ""]
+
+    return header
+
+
+def generate(dbc_path, output_dir):
+    db = cantools.database.load_file(str(dbc_path))
+    prefix = dbc_path.stem.lower()
+    PREFIX = prefix.upper()
+
+    messages = sorted(db.messages, key=lambda m: m.frame_id)
+
+    signals = []  # (macro, message, signal)
+    for message in messages:
+        for signal in message.signals:
+            if signal.multiplexer_ids is not None:
+                print(f"{dbc_path}: multiplexed signal {message.name}.{signal.name} is not decoded")
+                continue
+            macro = f"{PREFIX}_{snake_case(message.name).upper()}_{snake_case(signal.name).upper()}_SIGNAL"
+            signals.append((macro, message, signal))
+
+    header = [
+        f"// Generated from {dbc_path.name} by dbc_registry.py, do not edit",
+        "#pragma once",
+        "",
+        '#include "can/CANSignalStore.hpp"',
+        "",
+        f"#define {PREFIX}_NUM_SIGNALS {len(signals)}",
+        f"#define {PREFIX}_NUM_DECODED_FRAMES {len(messages)}",
+        "",
+        f"// Indices of the signals in a {prefix} signal store",
+    ]
+    for index, (macro, message, signal) in enumerate(signals):
+        header.append(f"#define {macro} {index}")
+    header += [
+        "",
+        "namespace wrvcu {",
+        "",
+        f"extern const CANFrameDecoder {prefix}_frame_decoders[{PREFIX}_NUM_DECODED_FRAMES];",
+        f"extern const CANSignalInfo {prefix}_signal_info[{PREFIX}_NUM_SIGNALS];",
+        "",
+        "}",
+        "",
+    ]
+
+    source = [
+        f"// Generated from {dbc_path.name} by dbc_registry.py, do not edit",
+        f'#include "{prefix}_signals.hpp"',
+        "",
+        "#include <cstring>",
+        "",
+        "namespace wrvcu {",
+        "",
+    ]
+
+    for message in messages:
+        name = snake_case(message.name)
+        message_signals = [(macro, signal) for macro, m, signal in signals if m is message]
+
+        source.append(f"static void decode_{name}(const uint8_t* data, CANSignal* signals, uint32_t timestamp_ms) {{")
+        for macro, signal in message_signals:
+            raw_type = "uint32_t" if signal.length <= 32 else "uint64_t"
+            raw = " | ".join(extract_terms(signal, raw_type))
+            local = f"{snake_case(signal.name)}_raw"
+            value = f"(float){local}"
+
+            if signal.is_float:
+                float_type = "float" if signal.length == 32 else "double"
+                source.append(f"    {raw_type} {local}_bits = {raw};")
+                source.append(f"    {float_type} {local};")
+                source.append(f"    memcpy(&{local}, &{local}_bits, sizeof({local}));")
+            elif signal.is_signed:
+                signed_type = "int32_t" if raw_type == "uint32_t" else "int64_t"
+                width = 32 if raw_type == "uint32_t" else 64
+                if signal.length == width:
+                    source.append(f"    {signed_type} {local} = ({signed_type})({raw});")
+                else:
+                    # shift the sign bit to the top and back down to sign extend
+                    unused = width - signal.length
+                    source.append(
+                        f"    {signed_type} {local} = ({signed_type})(({raw}) << {unused}) >> {unused};"
+                    )
+            else:
+                source.append(f"    {raw_type} {local} = {raw};")
+
+            if signal.scale != 1:
+                value = f"{value} * {float_literal(signal.scale)}"
+            if signal.offset != 0:
+                value = f"{value} + {float_literal(signal.offset)}"
+
+            source.append(f"    signals[{macro}].value = {value};")
+            source.append(f"    signals[{macro}].timestamp_ms = timestamp_ms;")
+            source.append(f"    signals[{macro}].received = true;")
+        if not message_signals:
+            source.append("    (void)data;")
+            source.append("    (void)signals;")
+            source.append("    (void)timestamp_ms;")
+        source.append("}")
+        source.append("")
+
+    source.append(f"const CANFrameDecoder {prefix}_frame_decoders[{PREFIX}_NUM_DECODED_FRAMES] = {{")
+    for message in messages:
+        source.append(f"    {{ 0x{message.frame_id:x}u, decode_{snake_case(message.name)} }},")
+    source.append("};")
+    source.append("")
+
+    source.append(f"const CANSignalInfo {prefix}_signal_info[{PREFIX}_NUM_SIGNALS] = {{")
+    for macro, message, signal in signals:
+        # frames without a cycle time are event driven and never go stale
+        source.append(f'    {{ "{message.name}.{signal.name}", {message.cycle_time or 0}u }},')
+    source.append("};")
+    source.append("")
+    source.append("}")
+    source.append("")
+
+    output_dir.mkdir(parents=True, exist_ok=True)
+    (output_dir / f"{prefix}_signals.hpp").write_text("\n".join(header))
+    (output_dir / f"{prefix}_signals.cpp").write_text("\n".join(source))
+    (output_dir / f"{prefix}_fixed.hpp").write_text("\n".join(generate_fixed(dbc_path, prefix, messages)))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Generate a table-driven signal decoder from a DBC file.")
+    parser.add_argument("-o", "--output-directory", default=".", help="Directory to write the generated files to.")
+    parser.add_argument("infile", help="DBC file to read.")
+    args = parser.parse_args()
+
+    generate(pathlib.Path(args.infile), pathlib.Path(args.output_directory))
@@ -0,0 +1,234 @@
+#pragma once
+
+// The part of the Teensy Arduino core the firmware uses, for the host build. Pins, serial ports and time are backed
+// by host/src/arduino.cpp; the simulation drives them through host.hpp.
+
+#include <cmath>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define INPUT_PULLDOWN 3
+
+#define LED_BUILTIN 13
+
+// Teensy 4.1
+#define CORE_NUM_TOTAL_PINS 55
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define F_CPU_ACTUAL 600000000
+
+// Flash strings are ordinary strings on the host
+#define PSTR(s) (s)
+#define F(s) (s)
+
+#define lowByte(w) ((uint8_t)((w) & 0xff))
+#define highByte(w) ((uint8_t)((w) >> 8))
+
+// The DWT cycle counter counts host time at F_CPU_ACTUAL, so it measures what the code costs on the host, even when
+// the RTOS runs on simulated time.
+#define ARM_DWT_CYCCNT (hostCycleCount())
+uint32_t hostCycleCount();
+
+#define BUILTIN_SDCARD 254
+
+template <class A, class B>
+constexpr auto min(A a, B b) -> decltype(a < b ? a : b) {
+    return b < a ? b : a;
+}
+
+template <class A, class B>
+constexpr auto max(A a, B b) -> decltype(a < b ? a : b) {
+    return a < b ? b : a;
+}
+
+// as Teensy's, keeping the argument's type, where the C library's would truncate a float to an int
+template <class T>
+constexpr T abs(T x) {
+    return x > 0 ? x : -x;
+}
+
+template <class T, class L, class H>
+constexpr auto constrain(T amt, L low, H high) -> decltype(amt < low ? low : (amt > high ? high : amt)) {
+    return amt < low ? low : (amt > high ? high : amt);
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+uint8_t digitalRead(uint8_t pin);
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t msec);
+void delayMicroseconds(uint32_t usec);
+void yield();
+
+class String {
+    std::string s;
+
+public:
+    String() = default;
+    String(const char* cstr) : s(cstr ? cstr : ""){};
+    String(const std::string& str) : s(str){};
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(float value, unsigned char decimalPlaces = 2);
+    explicit String(double value, unsigned char decimalPlaces = 2);
+
+    const char* c_str() const {
+        return s.c_str();
+    }
+
+    unsigned int length() const {
+        return s.length();
+    }
+
+    String& operator+=(const String& rhs) {
+        s += rhs.s;
+        return *this;
+    }
+
+    friend String operator+(const String& lhs, const String& rhs) {
+        return String(lhs.s + rhs.s);
+    }
+
+    bool operator==(const String& rhs) const {
+        return s == rhs.s;
+    }
+
+    bool operator!=(const String& rhs) const {
+        return s != rhs.s;
+    }
+};
+
+class Print {
+public:
+    virtual ~Print() = default;
+
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    virtual void flush(){};
+
+    size_t write(const char* str) {
+        return write((const uint8_t*)str, strlen(str));
+    }
+    size_t write(int n) {
+        return write((uint8_t)n);
+    }
+    size_t write(unsigned int n) {
+        return write((uint8_t)n);
+    }
+    size_t write(long n) {
+        return write((uint8_t)n);
+    }
+    size_t write(unsigned long n) {
+        return write((uint8_t)n);
+    }
+
+    size_t print(const char* str) {
+        return write(str);
+    }
+    size_t print(const String& str) {
+        return write(str.c_str());
+    }
+    size_t print(char c) {
+        return write((uint8_t)c);
+    }
+    size_t print(int n, int base = DEC) {
+        return print((long)n, base);
+    }
+    size_t print(unsigned int n, int base = DEC) {
+        return print((unsigned long)n, base);
+    }
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+    size_t print(double n, int digits = 2);
+
+    size_t println() {
+        return write("\r\n");
+    }
+    template <class T>
+    size_t println(T value) {
+        return print(value) + println();
+    }
+    template <class T>
+    size_t println(T value, int format) {
+        return print(value, format) + println();
+    }
+
+    int printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    size_t readBytesUntil(char terminator, char* buffer, size_t length);
+};
+
+/**
+ * @brief A serial port. Serial writes to stdout; the others count what is written and otherwise drop it, and never
+ * have anything to read.
+ *
+ */
+class HardwareSerial : public Stream {
+    FILE* out;
+    uint32_t written = 0;
+
+public:
+    HardwareSerial(FILE* iout) : out(iout){};
+
+    void begin(uint32_t baud){};
+
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    void flush() override;
+
+    int available() override {
+        return 0;
+    }
+    int read() override {
+        return -1;
+    }
+    int peek() override {
+        return -1;
+    }
+
+    /**
+     * @brief Get the number of bytes written since start up.
+     *
+     */
+    uint32_t get_bytes_written() {
+        return written;
+    }
+
+    operator bool() const {
+        return true;
+    }
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial7;
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "SPI.h"
+
+/**
+ * @brief The MAX22530 ADC on the host. Channels read the counts set with hostSetADC, see host.hpp.
+ *
+ */
+class MAX22530 {
+    uint8_t cs;
+    SPIClass* spi;
+
+public:
+    MAX22530(uint8_t ics, SPIClass* ispi) : cs(ics), spi(ispi){};
+
+    bool begin(uint32_t frequency);
+
+    uint16_t readADC(int channel);
+    uint16_t readFiltered(int channel);
+};
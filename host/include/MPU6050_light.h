@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Wire.h"
+
+/**
+ * @brief The MPU6050 IMU on the host. Reads the motion set with hostSetIMU, see host.hpp.
+ *
+ */
+class MPU6050 {
+    float accX = 0, accY = 0, accZ = 1;
+    float gyroX = 0, gyroY = 0, gyroZ = 0;
+
+public:
+    MPU6050() = default;
+    MPU6050(TwoWire& wire){};
+
+    uint8_t begin(int gyro_config_num = 1, int acc_config_num = 0);
+    void calcOffsets(bool is_calc_gyro = true, bool is_calc_acc = true){};
+    void update();
+
+    float getAccX() {
+        return accX;
+    }
+    float getAccY() {
+        return accY;
+    }
+    float getAccZ() {
+        return accZ;
+    }
+    float getGyroX() {
+        return gyroX;
+    }
+    float getGyroY() {
+        return gyroY;
+    }
+    float getGyroZ() {
+        return gyroZ;
+    }
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Arduino.h"
+
+#define FILE_READ 0
+#define FILE_WRITE 1
+
+/**
+ * @brief A file on the host, under the directory set with hostSetSDRoot, see host.hpp.
+ *
+ */
+class File : public Stream {
+    FILE* file = nullptr;
+
+public:
+    File() = default;
+    File(FILE* ifile) : file(ifile){};
+
+    size_t write(uint8_t b) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    void flush() override;
+
+    int available() override;
+    int read() override;
+    int peek() override;
+
+    void close();
+
+    operator bool() const {
+        return file != nullptr;
+    }
+};
+
+/**
+ * @brief The SD card on the host. With no root directory set there is no card, and begin fails.
+ *
+ */
+class SDClass {
+public:
+    bool begin(uint8_t csPin);
+    bool exists(const char* filepath);
+    bool rename(const char* oldpath, const char* newpath);
+    bool remove(const char* filepath);
+    File open(const char* filepath, uint8_t mode = FILE_READ);
+};
+
+extern SDClass SD;
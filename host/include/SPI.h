@@ -0,0 +1,12 @@
+#pragma once
+
+#include "Arduino.h"
+
+class SPIClass {
+public:
+    void begin(){};
+    void end(){};
+};
+
+extern SPIClass SPI;
+extern SPIClass SPI1;
@@ -0,0 +1,4 @@
+#pragma once
+
+// Stream is part of the core on the host, see Arduino.h
+#include "Arduino.h"
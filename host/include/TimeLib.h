@@ -0,0 +1,26 @@
+#pragma once
+
+#include <ctime>
+
+// The real time clock on the host is the host's clock
+
+typedef time_t (*getExternalTime)();
+
+void setTime(int hr, int min, int sec, int day, int month, int yr);
+time_t now();
+void setSyncProvider(getExternalTime getTimeFunction);
+
+int year();
+int month();
+int day();
+int hour();
+int minute();
+int second();
+
+class TeensyRTC {
+public:
+    time_t get();
+    void set(time_t t);
+};
+
+extern TeensyRTC Teensy3Clock;
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "Arduino.h"
+
+class TwoWire {
+public:
+    void begin(){};
+    void setClock(uint32_t frequency){};
+};
+
+extern TwoWire Wire;
+extern TwoWire Wire1;
+extern TwoWire Wire2;
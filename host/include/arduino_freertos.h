@@ -0,0 +1,159 @@
+#pragma once
+
+// The FreeRTOS API the firmware uses, for the host build. host/src/kernel.cpp implements it on std::thread with the
+// same scheduling as the single core target: only the highest priority ready task runs, and tasks of equal priority
+// share the CPU tick by tick. The one difference is that a task can't be interrupted between kernel calls, so a task
+// woken by the tick, or by an interrupt, gets the CPU at the running task's next kernel call rather than at once.
+// A task which spins without calling into the kernel starves every other task, as with configUSE_PREEMPTION 0.
+
+#include "Arduino.h"
+#include <cstddef>
+#include <cstdint>
+
+typedef uint32_t StackType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+
+typedef void (*TaskFunction_t)(void*);
+typedef BaseType_t (*TaskHookFunction_t)(void*);
+
+typedef struct HostTCB* TaskHandle_t;
+typedef struct HostQueue* QueueHandle_t;
+typedef QueueHandle_t SemaphoreHandle_t;
+
+// Storage for a task and a queue, the kernel's structures are built in place by the Static create functions
+typedef struct {
+    alignas(std::max_align_t) unsigned char storage[256];
+} StaticTask_t;
+
+typedef struct {
+    alignas(std::max_align_t) unsigned char storage[128];
+} StaticQueue_t;
+typedef StaticQueue_t StaticSemaphore_t;
+
+typedef struct {
+    uint64_t entryTick;
+} TimeOut_t;
+
+typedef enum {
+    eRunning = 0,
+    eReady,
+    eBlocked,
+    eSuspended,
+    eDeleted,
+    eInvalid
+} eTaskState;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdPASS (pdTRUE)
+#define pdFAIL (pdFALSE)
+#define errQUEUE_EMPTY ((BaseType_t)0)
+#define errQUEUE_FULL ((BaseType_t)0)
+
+#define configTICK_RATE_HZ 1000
+#define configMAX_PRIORITIES 32
+#define configMAX_TASK_NAME_LEN 16
+#define configMINIMAL_STACK_SIZE 128
+#define configUSE_APPLICATION_TASK_TAG 1
+
+#define tskKERNEL_VERSION_NUMBER "V10.5.1 (host)"
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+
+#define pdMS_TO_TICKS(xTimeInMs) ((TickType_t)(((uint64_t)(xTimeInMs) * (uint64_t)configTICK_RATE_HZ) / (uint64_t)1000U))
+#define pdTICKS_TO_MS(xTicks) ((uint32_t)(((uint64_t)(xTicks) * (uint64_t)1000U) / (uint64_t)configTICK_RATE_HZ))
+
+#define configASSERT(x)                          \
+    if ((x) == 0) {                              \
+        vAssertCalled(__FILE__, __LINE__);       \
+    } else {                                     \
+    }
+
+#define taskENTER_CRITICAL() vPortEnterCritical()
+#define taskEXIT_CRITICAL() vPortExitCritical()
+#define taskENTER_CRITICAL_FROM_ISR() (vPortEnterCritical(), (UBaseType_t)0)
+#define taskEXIT_CRITICAL_FROM_ISR(x) ((void)(x), vPortExitCritical())
+
+#define taskYIELD() vPortYield()
+#define portYIELD_FROM_ISR(x) vPortYieldFromISR(x)
+
+void vAssertCalled(const char* file, int line);
+
+void vPortEnterCritical();
+void vPortExitCritical();
+void vPortYield();
+void vPortYieldFromISR(BaseType_t higherPriorityTaskWoken);
+
+// Tasks
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t pxTaskCode, const char* pcName, uint32_t ulStackDepth, void* pvParameters,
+    UBaseType_t uxPriority, StackType_t* puxStackBuffer, StaticTask_t* pxTaskBuffer);
+void vTaskDelete(TaskHandle_t xTaskToDelete);
+
+void vTaskStartScheduler();
+void vTaskEndScheduler();
+void vTaskSuspendAll();
+BaseType_t xTaskResumeAll();
+
+TaskHandle_t xTaskGetCurrentTaskHandle();
+char* pcTaskGetName(TaskHandle_t xTaskToQuery);
+eTaskState eTaskGetState(TaskHandle_t xTask);
+UBaseType_t uxTaskPriorityGet(TaskHandle_t xTask);
+void vTaskPrioritySet(TaskHandle_t xTask, UBaseType_t uxNewPriority);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask);
+
+void vTaskSetApplicationTaskTag(TaskHandle_t xTask, TaskHookFunction_t pxHookFunction);
+TaskHookFunction_t xTaskGetApplicationTaskTag(TaskHandle_t xTask);
+TaskHookFunction_t xTaskGetApplicationTaskTagFromISR(TaskHandle_t xTask);
+
+void vTaskSuspend(TaskHandle_t xTaskToSuspend);
+void vTaskResume(TaskHandle_t xTaskToResume);
+
+void vTaskDelay(TickType_t xTicksToDelay);
+void vTaskDelayUntil(TickType_t* pxPreviousWakeTime, TickType_t xTimeIncrement);
+TickType_t xTaskGetTickCount();
+TickType_t xTaskGetTickCountFromISR();
+
+void vTaskSetTimeOutState(TimeOut_t* pxTimeOut);
+BaseType_t xTaskCheckForTimeOut(TimeOut_t* pxTimeOut, TickType_t* pxTicksToWait);
+
+// Direct to task notifications, index 0 only
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify);
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t* pxHigherPriorityTaskWoken);
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait);
+BaseType_t xTaskGenericNotifyStateClear(TaskHandle_t xTask, UBaseType_t uxIndexToClear);
+
+// Queues
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t uxQueueLength, UBaseType_t uxItemSize, uint8_t* pucQueueStorage,
+    StaticQueue_t* pxStaticQueue);
+
+BaseType_t xQueueSendToBack(QueueHandle_t xQueue, const void* pvItemToQueue, TickType_t xTicksToWait);
+BaseType_t xQueueSendToFront(QueueHandle_t xQueue, const void* pvItemToQueue, TickType_t xTicksToWait);
+BaseType_t xQueueOverwrite(QueueHandle_t xQueue, const void* pvItemToQueue);
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void* pvBuffer, TickType_t xTicksToWait);
+BaseType_t xQueuePeek(QueueHandle_t xQueue, void* pvBuffer, TickType_t xTicksToWait);
+BaseType_t xQueueReset(QueueHandle_t xQueue);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue);
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t xQueue);
+
+BaseType_t xQueueSendToBackFromISR(QueueHandle_t xQueue, const void* pvItemToQueue, BaseType_t* pxHigherPriorityTaskWoken);
+BaseType_t xQueueSendToFrontFromISR(QueueHandle_t xQueue, const void* pvItemToQueue, BaseType_t* pxHigherPriorityTaskWoken);
+BaseType_t xQueueOverwriteFromISR(QueueHandle_t xQueue, const void* pvItemToQueue, BaseType_t* pxHigherPriorityTaskWoken);
+BaseType_t xQueueReceiveFromISR(QueueHandle_t xQueue, void* pvBuffer, BaseType_t* pxHigherPriorityTaskWoken);
+BaseType_t xQueuePeekFromISR(QueueHandle_t xQueue, void* pvBuffer);
+UBaseType_t uxQueueMessagesWaitingFromISR(QueueHandle_t xQueue);
+
+// Semaphores and mutexes, mutexes have priority inheritance
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* pxMutexBuffer);
+SemaphoreHandle_t xQueueCreateCountingSemaphoreStatic(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount,
+    StaticSemaphore_t* pxStaticSemaphore);
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore);
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t xSemaphore, BaseType_t* pxHigherPriorityTaskWoken);
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t xSemaphore);
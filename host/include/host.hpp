@@ -0,0 +1,95 @@
+#pragma once
+
+// The host side of the host build's hardware: what the simulation sets for the firmware to read, and reads back
+// from what the firmware drives.
+
+#include "Arduino.h"
+
+// ---------- GPIO ----------
+
+/**
+ * @brief Drive a pin, as the car's wiring would drive an input.
+ *
+ */
+void hostSetPin(uint8_t pin, uint8_t level);
+
+/**
+ * @brief Get a pin's level, e.g. an output the firmware drives.
+ *
+ */
+uint8_t hostGetPin(uint8_t pin);
+
+// ---------- MAX22530 ADC ----------
+
+/**
+ * @brief Set the counts an ADC channel reads, 0 to ADC_RESOLUTION - 1.
+ *
+ */
+void hostSetADC(int channel, uint16_t counts);
+
+/**
+ * @brief Get the number of channel reads made over SPI since start up.
+ *
+ */
+uint32_t hostGetADCReads();
+
+// ---------- MPU6050 IMU ----------
+
+/**
+ * @brief Set the motion the IMU reads, acceleration in g and rotation in degrees per second.
+ *
+ */
+void hostSetIMU(float accX, float accY, float accZ, float gyroX, float gyroY, float gyroZ);
+
+// ---------- SD card ----------
+
+/**
+ * @brief Put the SD card's files in a directory on the host. Until this is called there is no card.
+ *
+ */
+void hostSetSDRoot(const char* directory);
+
+// ---------- Time and the scheduler ----------
+
+/**
+ * @brief Get the time since start up in microseconds, which micros, millis and the RTOS tick all follow.
+ *
+ */
+uint64_t hostMicros();
+
+/**
+ * @brief Run on virtual time rather than the host's clock. Call before the scheduler starts.
+ *
+ * Nothing then runs in real time: a task's code is free between kernel calls, each kernel call costs it a microsecond,
+ * and while every task is blocked the clock jumps to the next wake up. A run is the same every time, and as fast as
+ * the host can run it. A task which waits on something without a kernel call, e.g. spinning on a flag, must spend the
+ * time with hostBusyWait, or it will wait forever.
+ */
+void hostUseVirtualTime();
+
+/**
+ * @brief Check whether the host runs on virtual time.
+ *
+ */
+bool hostIsVirtualTime();
+
+/**
+ * @brief Spend time on the CPU, as delayMicroseconds does. On virtual time this moves the clock on rather than waiting.
+ *
+ */
+void hostBusyWait(uint32_t us);
+
+/**
+ * @brief Block the calling task until hostMicros() reaches a time, which needn't be on a tick. Other tasks run
+ * meanwhile, and on virtual time the clock jumps to the wake up if they all block first.
+ *
+ * @param us The time to wake at
+ */
+void hostDelayUntilMicros(uint64_t us);
+
+/**
+ * @brief End the scheduler, returning from vTaskStartScheduler, once the RTOS has run for a time.
+ *
+ * @param ms The run time, or 0 to run until vTaskEndScheduler is called
+ */
+void hostRunFor(uint32_t ms);
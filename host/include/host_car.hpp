@@ -0,0 +1,24 @@
+#pragma once
+
+// The car as the host build runs it, for harnesses which put simulated nodes and a driver around it
+
+#include "can/CANSignalMonitor.hpp"
+#include "can/VirtualCANBus.hpp"
+#include "car.hpp"
+
+namespace wrvcu {
+
+extern VirtualCANBus powertrainBus;
+extern VirtualCANBus telemetryBus;
+extern VirtualCANController can1;
+extern VirtualCANController can3;
+extern CANSignalMonitor signalMonitor;
+
+}
+
+/**
+ * @brief Set the car up as setup() in src/main.cpp does, with the buses virtual, but don't start the scheduler. Other
+ * nodes must be attached to the buses before this is called.
+ *
+ */
+void hostCarInit();
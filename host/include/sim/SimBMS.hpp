@@ -0,0 +1,110 @@
+#pragma once
+
+#include "can/AbstractCANController.hpp"
+#include "devices/battery.hpp"
+#include "rtos/rtos.hpp"
+
+// ms, the period of every BMS and IVT frame but IVT_Msg_Result_T, from battery.dbc
+#define SIM_BMS_PERIOD 100
+
+// ms, the period of IVT_Msg_Result_T
+#define SIM_BMS_IVT_T_PERIOD 1000
+
+// ms, the model's time step
+#define SIM_BMS_STEP 10
+
+#define SIM_BMS_CELLS 84               // in series
+#define SIM_BMS_CAPACITY 30            // Ah
+#define SIM_BMS_CELL_EMPTY 3.3         // V, open circuit, at 0% SoC
+#define SIM_BMS_CELL_FULL 4.15         // V, open circuit, at 100% SoC
+#define SIM_BMS_CELL_RESISTANCE 0.0015 // Ohms, of each cell in series, with its share of the busbars
+#define SIM_BMS_PRECHARGE_TAU 400      // ms, of the precharge resistor and the inverter's DC link capacitance
+#define SIM_BMS_PRECHARGE_DONE 0.95    // of pack voltage, at which the main contactor closes
+#define SIM_BMS_PRECHARGE_TIMEOUT 5000 // ms, after which precharge has failed
+#define SIM_BMS_DISCHARGE_TAU 200      // ms, of the DC link discharging once the contactors open
+#define SIM_BMS_MAX_DISCHARGE 250      // A
+#define SIM_BMS_MAX_CHARGE 50          // A
+
+// The n-BMS's wake up frame, which Battery sends
+#define SIM_BMS_WAKE_ID 0x70
+
+// Stack depth in words of the simulated BMS's task
+#define SIM_BMS_TASK_STACK_DEPTH 1024
+
+namespace wrvcu {
+
+/**
+ * @brief A stand-in for the car's n-BMS and IVT, for the host build. It wakes on Battery's wake up frame, then follows
+ * BMS_IGNITION_PIN through precharge to Active and back, as the n-BMS does. The BMS's status, cell and current limit
+ * frames and the IVT's results are sent at the rates in battery.dbc.
+ *
+ */
+class SimBMS {
+    AbstractCANController* can = nullptr;
+
+    Queue<CANMessage, 256> rxQueue;
+
+    StaticTask<SIM_BMS_TASK_STACK_DEPTH> task;
+
+    ContactorStates state = ContactorStates::Init;
+    uint32_t prechargeStart = 0;
+    uint32_t stateChange_us = 0;
+
+    float linkVoltage = 0; // V, across the DC link after the contactors
+    float chargeUsed = 0;  // Ah
+
+    void loop();
+
+    void setState(ContactorStates newState);
+
+    void updateState();
+
+    void step(float dt);
+
+    void sendFrames(bool sendTemperature);
+
+    void send(uint32_t id, uint8_t len, const uint8_t* data);
+
+public:
+    float initialSoC = 90;     // %, of the pack at start up
+    float cellTemp = 25;       // deg C
+    float terminalCurrent = 0; // A, out of the pack
+    float isolation = 5000;    // kOhms, from the IMD
+    bool fault = false;        // puts the BMS in Error, opening the contactors
+
+    /**
+     * @brief Start the BMS on a controller, which must already be attached to the bus.
+     *
+     */
+    void init(AbstractCANController* ican, uint32_t task_priority);
+
+    ContactorStates getState();
+
+    /**
+     * @brief Get when the status last changed, in microseconds.
+     *
+     */
+    uint32_t getStateChangeTime();
+
+    /**
+     * @brief Get the open circuit voltage of a cell, which falls with the SoC.
+     *
+     */
+    float getCellVoltage();
+
+    /**
+     * @brief Get the pack's terminal voltage, which sags below the cells' open circuit voltage with the current drawn.
+     *
+     */
+    float getPackVoltage();
+
+    /**
+     * @brief Get the DC link's voltage, which rises through precharge while the contactors close.
+     *
+     */
+    float getLinkVoltage();
+
+    float getSoC();
+};
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "TractiveSystem.hpp"
+#include "sim/SimVehicle.hpp"
+
+// fraction of full brake pressure the driver holds through start up
+#define SIM_DRIVER_START_BRAKE 0.3
+
+// ms, by when driverStartUp has the car ready to drive
+#define SIM_DRIVER_READY 10000
+
+namespace wrvcu {
+
+/**
+ * @brief What the driver is doing with the car's controls at a moment.
+ *
+ */
+struct DriverInputs {
+    bool sdcClosed = true;
+    bool tsas = false;
+    bool start = false;
+    float throttle = 0; // fraction of pedal travel
+    float brake = 0;    // fraction of full brake pressure
+};
+
+/**
+ * @brief Set the pins and ADC channels the driver's controls are wired to.
+ *
+ * @param vehicle The car whose mechanical brakes the brake pedal works, or nullptr if nothing is driven
+ */
+void applyDriverInputs(DriverInputs const& inputs, SimVehicle* vehicle = nullptr);
+
+/**
+ * @brief The start up a driver goes through: press TSAS at 1 s, then brake and press start at 5 s, so the car is
+ * driving by SIM_DRIVER_READY.
+ *
+ * @param t Time since the start of the run in ms
+ * @return The inputs, with the pedals released after start up
+ */
+DriverInputs driverStartUp(uint32_t t);
+
+const char* tsStateName(TSStates state);
+
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "can/AbstractCANController.hpp"
+#include "can/CANOpenDevice.hpp"
+#include "rtos/rtos.hpp"
+#include "sim/SimBMS.hpp"
+#include "sim/SimVehicle.hpp"
+
+// ms, the period of the heartbeat
+#define SIM_INVERTER_HEARTBEAT_PERIOD 100
+
+// ms, the motor model's time step
+#define SIM_INVERTER_STEP 10
+
+// ms, how long the inverter waits for a torque command while enabled before faulting
+#define SIM_INVERTER_RPDO_TIMEOUT 100
+
+// V, below which the DC link is undervoltage, and the inverter faults if enabled
+#define SIM_INVERTER_MIN_DC_VOLTAGE 60
+
+// The motor's torque-speed curve: peak torque up to the base speed, then peak power, falling to nothing at the top
+// speed. Peak power is at the nominal DC link voltage, and falls with it.
+#define SIM_INVERTER_PEAK_TORQUE 140      // Nm
+#define SIM_INVERTER_PEAK_POWER 80000     // W
+#define SIM_INVERTER_NOMINAL_VOLTAGE 320  // V
+#define SIM_INVERTER_MAX_SPEED 6500       // rpm
+#define SIM_INVERTER_FADE_SPEED 6000      // rpm, from which torque fades to nothing at the top speed
+
+#define SIM_INVERTER_EFFICIENCY 0.9       // of the motor and inverter together
+#define SIM_INVERTER_AMBIENT_TEMP 25      // deg C
+#define SIM_INVERTER_MOTOR_HEATING 1.3e-5 // deg C per Nm^2 per s
+#define SIM_INVERTER_COOLING_TIME 300     // s, the time constant of the temperatures falling to ambient
+
+// Error codes sent in TPDO1, as CANopen's emergency error codes
+#define SIM_INVERTER_ERROR_UNDERVOLTAGE 0x3220
+#define SIM_INVERTER_ERROR_RPDO_TIMEOUT 0x8250
+
+// Stack depth in words of the simulated inverter's task
+#define SIM_INVERTER_TASK_STACK_DEPTH 1024
+
+namespace wrvcu {
+
+/**
+ * @brief A stand-in for the car's CANopen inverter, for the host build. It follows NMT commands and sends its
+ * heartbeat, answers SDO reads and writes of the controlword, and while operational with PWM enabled applies the torque
+ * in RPDO1 to a SimVehicle, as far as the motor's torque-speed curve allows. On each SYNC it sends TPDO1 (warning and
+ * error codes), TPDO2 (motor and controller temperatures in deg C, int16s) and TPDO4 (RPM in bytes 1-4), as Inverter
+ * decodes them.
+ *
+ */
+class SimInverter {
+    AbstractCANController* can = nullptr;
+    uint8_t nodeID = 1;
+    SimBMS* battery = nullptr;
+    SimVehicle* vehicle = nullptr;
+
+    Queue<CANMessage, 256> rxQueue;
+
+    StaticTask<SIM_INVERTER_TASK_STACK_DEPTH> task;
+
+    NMTState nmtState = NMTState::Boot;
+    uint16_t controlword = 0;
+    uint16_t errorCode = 0;
+
+    int16_t torqueCommand = 0; // as sent, in Inverter's units and polarity
+    uint32_t lastTorque = 0;   // ms
+    uint32_t torqueRx_us = 0;
+
+    float torque = 0; // Nm applied, forward positive
+    float motorTemp = SIM_INVERTER_AMBIENT_TEMP;
+    float controllerTemp = SIM_INVERTER_AMBIENT_TEMP;
+
+    int32_t sentRPM = 0;
+    uint32_t rpmTx_us = 0;
+
+    uint32_t faults = 0;
+
+    void loop();
+
+    void receive(CANMessage const& msg);
+
+    void handleNMT(CANMessage const& msg);
+
+    void handleSDO(CANMessage const& msg);
+
+    void sendHeartbeat();
+
+    void sendSDOResponse(uint8_t command, uint16_t index, uint8_t subindex, uint32_t data);
+
+    void sendTPDOs();
+
+    void fault(uint16_t code);
+
+    float maxTorque(float rpm, float linkVoltage);
+
+    void step(float dt);
+
+public:
+    int32_t polarityFactor = -1; // as Inverter's, so forward torque is sent negative
+
+    /**
+     * @brief Start the inverter on a controller, which must already be attached to the bus.
+     *
+     * @param vehicle The car the motor drives
+     * @param battery The BMS whose contactors feed the DC link, and which the inverter draws current from, or nullptr
+     * for a DC link which is always up
+     */
+    void init(AbstractCANController* ican, uint8_t inodeID, uint32_t task_priority, SimVehicle* vehicle, SimBMS* battery = nullptr);
+
+    NMTState getNMTState();
+
+    /**
+     * @brief Check whether the inverter is operational with PWM enabled, so torque commands are applied.
+     *
+     */
+    bool isEnabled();
+
+    /**
+     * @brief Get the torque being applied in Nm, forward positive, which the motor's curve may hold below the command.
+     *
+     */
+    float getTorque();
+
+    /**
+     * @brief Get the last torque command, in Inverter's units and polarity, with when it arrived in microseconds.
+     *
+     */
+    int16_t getTorqueCommand(uint32_t* rx_us = nullptr);
+
+    /**
+     * @brief Get the RPM last sent in TPDO4, forward positive, with when it was sent in microseconds.
+     *
+     */
+    int32_t getSentRPM(uint32_t* tx_us = nullptr);
+
+    float getMotorTemp();
+
+    uint16_t getErrorCode();
+
+    /**
+     * @brief Get the number of times the inverter has faulted.
+     *
+     */
+    uint32_t getFaults();
+};
+
+}
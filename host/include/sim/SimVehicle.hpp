@@ -0,0 +1,55 @@
+#pragma once
+
+#define SIM_VEHICLE_MASS 280           // kg, with the driver
+#define SIM_VEHICLE_WHEEL_RADIUS 0.23  // m
+#define SIM_VEHICLE_GEAR_RATIO 4.4     // motor turns per wheel turn
+#define SIM_VEHICLE_MOTOR_INERTIA 0.03 // kg m^2, of the rotor
+#define SIM_VEHICLE_DRAG_AREA 1.3      // m^2, the drag coefficient times the frontal area, with the wings
+#define SIM_VEHICLE_AIR_DENSITY 1.2    // kg/m^3
+#define SIM_VEHICLE_ROLLING 0.02       // rolling resistance coefficient
+#define SIM_VEHICLE_BRAKE_FORCE 6000   // N, at full brake pressure
+#define SIM_VEHICLE_GRAVITY 9.81       // m/s^2
+
+namespace wrvcu {
+
+/**
+ * @brief The car's drivetrain and body for the host build's simulated inverter to drive: the motor turns the rear wheels
+ * through a fixed reduction, and the car is slowed by aerodynamic drag, rolling resistance and the mechanical brakes.
+ * It has no task of its own, the inverter steps it with the torque it applies.
+ *
+ */
+class SimVehicle {
+    float speed = 0;    // m/s
+    float distance = 0; // m
+
+public:
+    float brake = 0; // fraction of full brake pressure, set by the driver
+
+    /**
+     * @brief Move the car on.
+     *
+     * @param motorTorque Nm at the motor shaft, forward positive
+     * @param dt Seconds
+     */
+    void step(float motorTorque, float dt);
+
+    /**
+     * @brief Get the car's speed in m/s.
+     *
+     */
+    float getSpeed();
+
+    /**
+     * @brief Get the motor's speed in rpm, which turns with the wheels.
+     *
+     */
+    float getMotorSpeed();
+
+    /**
+     * @brief Get the distance driven in m.
+     *
+     */
+    float getDistance();
+};
+
+}
@@ -0,0 +1,6 @@
+# Force-includes the host's FreeRTOS and Arduino API into the C++ sources of the native envs, see platformio.ini.
+# Only C++, as the generated DBC sources are C and the header pulls in the C++ standard library.
+
+Import("env")
+
+env.Append(CXXFLAGS=["-include", "arduino_freertos.h"])
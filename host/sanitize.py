@@ -0,0 +1,9 @@
+# Builds a native env with the sanitizers named by its custom_sanitize option, see platformio.ini
+
+Import("env")
+
+sanitize = env.GetProjectOption("custom_sanitize", "")
+
+if sanitize:
+    flags = ["-fsanitize=" + sanitize, "-fno-omit-frame-pointer"]
+    env.Append(CCFLAGS=flags, LINKFLAGS=flags)
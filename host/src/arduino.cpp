@@ -0,0 +1,421 @@
+#include "Arduino.h"
+#include "MAX22530.h"
+#include "MPU6050_light.h"
+#include "SD.h"
+#include "SPI.h"
+#include "TimeLib.h"
+#include "Wire.h"
+#include "arduino_freertos.h"
+#include "host.hpp"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#define HOST_NUM_PINS 64
+#define HOST_ADC_CHANNELS 4
+
+// Pin levels, written by the firmware and the simulation from different threads
+static std::atomic<uint8_t> pins[HOST_NUM_PINS];
+
+static std::atomic<uint16_t> adcCounts[HOST_ADC_CHANNELS];
+static std::atomic<uint32_t> adcReads{ 0 };
+
+static std::mutex imuMutex;
+static float imuMotion[6] = { 0, 0, 1, 0, 0, 0 };
+
+static std::string sdRoot;
+
+static const auto cycleStart = std::chrono::steady_clock::now();
+
+HardwareSerial Serial(stdout);
+HardwareSerial Serial7(nullptr);
+
+SPIClass SPI;
+SPIClass SPI1;
+
+TwoWire Wire;
+TwoWire Wire1;
+TwoWire Wire2;
+
+SDClass SD;
+
+TeensyRTC Teensy3Clock;
+
+// ---------- host.hpp ----------
+
+void hostSetPin(uint8_t pin, uint8_t level) {
+    if (pin < HOST_NUM_PINS) {
+        pins[pin] = level;
+    }
+}
+
+uint8_t hostGetPin(uint8_t pin) {
+    return pin < HOST_NUM_PINS ? pins[pin].load() : LOW;
+}
+
+void hostSetADC(int channel, uint16_t counts) {
+    if (channel >= 0 && channel < HOST_ADC_CHANNELS) {
+        adcCounts[channel] = counts;
+    }
+}
+
+uint32_t hostGetADCReads() {
+    return adcReads;
+}
+
+void hostSetIMU(float accX, float accY, float accZ, float gyroX, float gyroY, float gyroZ) {
+    std::lock_guard<std::mutex> lock(imuMutex);
+    imuMotion[0] = accX;
+    imuMotion[1] = accY;
+    imuMotion[2] = accZ;
+    imuMotion[3] = gyroX;
+    imuMotion[4] = gyroY;
+    imuMotion[5] = gyroZ;
+}
+
+void hostSetSDRoot(const char* directory) {
+    sdRoot = directory;
+}
+
+uint32_t hostCycleCount() {
+    auto elapsed = std::chrono::steady_clock::now() - cycleStart;
+    return (uint32_t)(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() * (F_CPU_ACTUAL / 1000000) / 1000);
+}
+
+// ---------- Pins and time ----------
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    hostSetPin(pin, val != LOW ? HIGH : LOW);
+}
+
+uint8_t digitalRead(uint8_t pin) {
+    return hostGetPin(pin);
+}
+
+uint32_t millis() {
+    return (uint32_t)(hostMicros() / 1000);
+}
+
+uint32_t micros() {
+    return (uint32_t)hostMicros();
+}
+
+void delay(uint32_t msec) {
+    // from a task, let the other tasks run
+    if (xTaskGetCurrentTaskHandle() != nullptr) {
+        vTaskDelay(pdMS_TO_TICKS(msec));
+    } else if (hostIsVirtualTime()) {
+        hostBusyWait(msec * 1000);
+    } else {
+        std::this_thread::sleep_for(std::chrono::milliseconds(msec));
+    }
+}
+
+void delayMicroseconds(uint32_t usec) {
+    hostBusyWait(usec);
+}
+
+void yield() {
+}
+
+// ---------- String ----------
+
+static std::string formatInteger(unsigned long long value, unsigned char base, bool negative) {
+    if (base < 2 || base > 36) {
+        base = 10;
+    }
+
+    char buffer[72];
+    int i = sizeof(buffer) - 1;
+    buffer[i] = '\0';
+    do {
+        int digit = value % base;
+        buffer[--i] = digit < 10 ? '0' + digit : 'A' + digit - 10;
+        value /= base;
+    } while (value > 0);
+
+    if (negative) {
+        buffer[--i] = '-';
+    }
+    return std::string(&buffer[i]);
+}
+
+static std::string formatFloat(double value, unsigned char decimalPlaces) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", decimalPlaces, value);
+    return std::string(buffer);
+}
+
+String::String(int value, unsigned char base) :
+    String((long)value, base){};
+
+String::String(unsigned int value, unsigned char base) :
+    String((unsigned long)value, base){};
+
+String::String(long value, unsigned char base) :
+    s(base == 10 ? formatInteger(value < 0 ? -(unsigned long long)value : value, base, value < 0) : formatInteger((unsigned long)value, base, false)){};
+
+String::String(unsigned long value, unsigned char base) :
+    s(formatInteger(value, base, false)){};
+
+String::String(float value, unsigned char decimalPlaces) :
+    s(formatFloat(value, decimalPlaces)){};
+
+String::String(double value, unsigned char decimalPlaces) :
+    s(formatFloat(value, decimalPlaces)){};
+
+// ---------- Print and Stream ----------
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size-- > 0) {
+        n += write(*buffer++);
+    }
+    return n;
+}
+
+size_t Print::print(long n, int base) {
+    return print(String(n, base));
+}
+
+size_t Print::print(unsigned long n, int base) {
+    return print(String(n, base));
+}
+
+size_t Print::print(double n, int digits) {
+    return print(String(n, digits));
+}
+
+int Print::printf(const char* format, ...) {
+    char buffer[256];
+
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    if (len > 0) {
+        write((const uint8_t*)buffer, std::min<size_t>(len, sizeof(buffer) - 1));
+    }
+    return len;
+}
+
+size_t Stream::readBytesUntil(char terminator, char* buffer, size_t length) {
+    size_t n = 0;
+    while (n < length) {
+        int c = read();
+        if (c < 0 || c == terminator) {
+            break;
+        }
+        buffer[n++] = (char)c;
+    }
+    return n;
+}
+
+size_t HardwareSerial::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    written += size;
+    if (out != nullptr) {
+        fwrite(buffer, 1, size, out);
+    }
+    return size;
+}
+
+void HardwareSerial::flush() {
+    if (out != nullptr) {
+        fflush(out);
+    }
+}
+
+// ---------- Devices ----------
+
+bool MAX22530::begin(uint32_t frequency) {
+    return true;
+}
+
+uint16_t MAX22530::readADC(int channel) {
+    if (channel < 0 || channel >= HOST_ADC_CHANNELS) {
+        return 0;
+    }
+
+    adcReads++;
+    return adcCounts[channel];
+}
+
+uint16_t MAX22530::readFiltered(int channel) {
+    return readADC(channel);
+}
+
+uint8_t MPU6050::begin(int gyro_config_num, int acc_config_num) {
+    return 0;
+}
+
+void MPU6050::update() {
+    std::lock_guard<std::mutex> lock(imuMutex);
+    accX = imuMotion[0];
+    accY = imuMotion[1];
+    accZ = imuMotion[2];
+    gyroX = imuMotion[3];
+    gyroY = imuMotion[4];
+    gyroZ = imuMotion[5];
+}
+
+// ---------- SD card ----------
+
+static std::string sdPath(const char* filepath) {
+    return sdRoot + "/" + filepath;
+}
+
+size_t File::write(uint8_t b) {
+    return write(&b, 1);
+}
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+    return file != nullptr ? fwrite(buffer, 1, size, file) : 0;
+}
+
+void File::flush() {
+    if (file != nullptr) {
+        fflush(file);
+    }
+}
+
+int File::available() {
+    if (file == nullptr) {
+        return 0;
+    }
+
+    long position = ftell(file);
+    fseek(file, 0, SEEK_END);
+    long end = ftell(file);
+    fseek(file, position, SEEK_SET);
+    return (int)(end - position);
+}
+
+int File::read() {
+    return file != nullptr ? fgetc(file) : -1;
+}
+
+int File::peek() {
+    if (file == nullptr) {
+        return -1;
+    }
+
+    int c = fgetc(file);
+    if (c != EOF) {
+        ungetc(c, file);
+    }
+    return c;
+}
+
+void File::close() {
+    if (file != nullptr) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+bool SDClass::begin(uint8_t csPin) {
+    return !sdRoot.empty();
+}
+
+bool SDClass::exists(const char* filepath) {
+    if (sdRoot.empty()) {
+        return false;
+    }
+
+    FILE* file = fopen(sdPath(filepath).c_str(), "r");
+    if (file != nullptr) {
+        fclose(file);
+    }
+    return file != nullptr;
+}
+
+bool SDClass::rename(const char* oldpath, const char* newpath) {
+    return !sdRoot.empty() && ::rename(sdPath(oldpath).c_str(), sdPath(newpath).c_str()) == 0;
+}
+
+bool SDClass::remove(const char* filepath) {
+    return !sdRoot.empty() && ::remove(sdPath(filepath).c_str()) == 0;
+}
+
+File SDClass::open(const char* filepath, uint8_t mode) {
+    if (sdRoot.empty()) {
+        return File();
+    }
+    return File(fopen(sdPath(filepath).c_str(), mode == FILE_WRITE ? "a+" : "r"));
+}
+
+// ---------- Real time clock ----------
+
+static time_t clockOffset = 0;
+
+void setTime(int hr, int min, int sec, int day, int month, int yr) {
+    struct tm t = {};
+    t.tm_hour = hr;
+    t.tm_min = min;
+    t.tm_sec = sec;
+    t.tm_mday = day;
+    t.tm_mon = month - 1;
+    t.tm_year = (yr >= 1900 ? yr : yr + 2000) - 1900;
+    clockOffset = timegm(&t) - time(nullptr);
+}
+
+time_t now() {
+    return time(nullptr) + clockOffset;
+}
+
+void setSyncProvider(getExternalTime getTimeFunction) {
+    if (getTimeFunction != nullptr) {
+        clockOffset = getTimeFunction() - time(nullptr);
+    }
+}
+
+static struct tm nowUTC() {
+    time_t t = now();
+    struct tm result;
+    gmtime_r(&t, &result);
+    return result;
+}
+
+int year() {
+    return nowUTC().tm_year + 1900;
+}
+
+int month() {
+    return nowUTC().tm_mon + 1;
+}
+
+int day() {
+    return nowUTC().tm_mday;
+}
+
+int hour() {
+    return nowUTC().tm_hour;
+}
+
+int minute() {
+    return nowUTC().tm_min;
+}
+
+int second() {
+    return nowUTC().tm_sec;
+}
+
+time_t TeensyRTC::get() {
+    return time(nullptr);
+}
+
+void TeensyRTC::set(time_t t) {
+}
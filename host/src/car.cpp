@@ -0,0 +1,89 @@
+#include "SD.h"
+#include "arduino_freertos.h"
+#include "can/CANGateway.hpp"
+#include "can/CANOpenHost.hpp"
+#include "can/CANSignalMonitor.hpp"
+#include "can/CANTelemetryRoutes.hpp"
+#include "can/VirtualCANBus.hpp"
+#include "constants.hpp"
+#include "host_car.hpp"
+#include "logging/log.hpp"
+#include "pins.hpp"
+#include "vcu_log.h"
+
+// vehicle globals, as in src/main.cpp but with both CAN buses virtual
+namespace wrvcu {
+TractiveSystem ts;
+Inverter inverter;
+Battery battery;
+ThrottleManager throttle;
+IMU imu;
+
+VirtualCANBus powertrainBus;
+VirtualCANBus telemetryBus;
+VirtualCANController can1; // powertrain: inverter, BMS and IVT
+VirtualCANController can3; // telemetry and logging
+CANGateway gateway;
+CANOpenHost canOpen;
+CANSignalMonitor signalMonitor;
+
+ADC adc(ADC_CS, &SPI);
+
+Display display;
+
+}
+
+using namespace wrvcu;
+
+void hostCarInit() {
+    Serial.begin(115200);
+    Serial7.begin(115200);
+
+    pinMode(LED_BUILTIN, OUTPUT);
+    digitalWrite(LED_BUILTIN, HIGH);
+
+    SD.begin(BUILTIN_SDCARD);
+
+    setLogLevel(LogLocation::STDOUT, LogLevel::DEBUG);
+    setLogLevel(LogLocation::FILE, LogLevel::DEBUG);
+    setLogLevel(LogLocation::RADIO, LogLevel::DEBUG);
+
+    loggingInit();
+
+    imu.init(&Wire2);
+
+    // the buses first, as devices send frames from init
+    powertrainBus.attach(&can1);
+    telemetryBus.attach(&can3);
+    powertrainBus.init(TASK_PRIORITY_DEFAULT + 4);
+    telemetryBus.init(TASK_PRIORITY_DEFAULT + 4);
+
+    can1.init(TASK_PRIORITY_DEFAULT + 3);
+    canOpen.init((&can1));
+    inverter.init((&can1), 1);
+
+    battery.init((&can1));
+
+    battery.watchSignals(&signalMonitor);
+    signalMonitor.init(CAN_SIGNAL_MONITOR_TASK_PRIORITY);
+
+    can3.init(CAN_TASK_PRIORITY);
+
+    addTelemetryRoutes(&gateway, &can1, &can3);
+
+    adc.init(false);
+    throttle.init(&adc);
+
+    display.init();
+    ts.init();
+}
+
+/**
+ * @brief Start the car as setup() in src/main.cpp does, with the buses virtual and nothing else on them.
+ *
+ */
+void host_car() {
+    hostCarInit();
+
+    startScheduler();
+}
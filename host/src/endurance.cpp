@@ -0,0 +1,213 @@
+#include "host.hpp"
+#include "host_car.hpp"
+#include "sim/SimBMS.hpp"
+#include "sim/SimDriver.hpp"
+#include "sim/SimInverter.hpp"
+#include "sim/SimVehicle.hpp"
+#include <chrono>
+
+// A 30 minute endurance event on virtual time. A scripted driver closes the SDC, starts the tractive system, drives
+// laps until the time is up and opens the SDC again, with a simulated BMS and inverter on the powertrain bus closing the
+// loop. The run ends with the tractive system's state timeline and a checksum of it, which is the same on every run.
+
+#define ENDURANCE_DURATION (30 * 60 * 1000) // ms
+#define ENDURANCE_DRIVE_START SIM_DRIVER_READY
+#define ENDURANCE_DRIVE_END (ENDURANCE_DURATION - 10000)
+#define ENDURANCE_SDC_OPEN (ENDURANCE_DURATION - 5000)
+
+#define ENDURANCE_DRIVER_PERIOD 10 // ms
+#define ENDURANCE_MAX_TRANSITIONS 64
+
+using namespace wrvcu;
+
+static VirtualCANController bmsCan;
+static SimBMS bms;
+static VirtualCANController inverterCan;
+static SimInverter inverterSim;
+static SimVehicle vehicle;
+
+static StaticTask<> driverTask;
+
+/**
+ * @brief A stretch of a lap with the pedals held.
+ *
+ */
+struct LapSegment {
+    uint32_t length; // ms
+    float throttle;
+    float brake;
+};
+
+// paced for the whole event rather than a single fast lap, as an endurance driver would
+static const LapSegment lap[] = {
+    { 6000, 0.3f, 0.0f }, // start/finish straight
+    { 1000, 0.0f, 0.0f },
+    { 2000, 0.0f, 0.3f }, // hairpin
+    { 5000, 0.15f, 0.0f },
+    { 8000, 0.1f, 0.0f }, // slalom
+    { 3000, 0.25f, 0.0f },
+    { 1000, 0.0f, 0.0f },
+    { 1500, 0.0f, 0.3f }, // chicane
+    { 4500, 0.2f, 0.0f },
+    { 7000, 0.12f, 0.0f }, // sweeper
+    { 5000, 0.3f, 0.0f },  // back straight
+    { 1000, 0.0f, 0.0f },
+    { 2500, 0.0f, 0.3f }, // hairpin
+    { 6000, 0.15f, 0.0f },
+    { 6500, 0.23f, 0.0f },
+};
+
+static uint32_t lapLength() {
+    uint32_t length = 0;
+    for (const LapSegment& segment : lap) {
+        length += segment.length;
+    }
+    return length;
+}
+
+/**
+ * @brief The driver's script: close the SDC, press TSAS, brake and press start, then drive laps until the end.
+ *
+ * @param t Time since the start of the event in ms
+ */
+static DriverInputs script(uint32_t t) {
+    DriverInputs inputs = driverStartUp(t);
+
+    if (t >= ENDURANCE_DRIVE_START && t < ENDURANCE_DRIVE_END) {
+        uint32_t lapTime = (t - ENDURANCE_DRIVE_START) % lapLength();
+        for (const LapSegment& segment : lap) {
+            if (lapTime < segment.length) {
+                inputs.throttle = segment.throttle;
+                inputs.brake = segment.brake;
+                break;
+            }
+            lapTime -= segment.length;
+        }
+    }
+
+    inputs.sdcClosed = t < ENDURANCE_SDC_OPEN;
+    return inputs;
+}
+
+struct Transition {
+    uint32_t time; // ms since the start of the event
+    TSStates state;
+};
+
+static Transition transitions[ENDURANCE_MAX_TRANSITIONS];
+static int numTransitions = 0;
+static uint32_t stateTime[(int)TSStates::Driving + 1] = { 0 }; // ms spent in each state
+static float maxSpeed = 0;                                      // m/s
+static float maxMotorTemp = 0;                                  // deg C
+
+// FNV-1a
+static uint32_t checksum(uint32_t hash, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        hash = (hash ^ ((value >> (8 * i)) & 0xff)) * 16777619u;
+    }
+    return hash;
+}
+
+static void printTime(uint32_t ms) {
+    printf("%2lu:%02lu.%03lu", (unsigned long)(ms / 60000), (unsigned long)(ms / 1000 % 60), (unsigned long)(ms % 1000));
+}
+
+static void report(std::chrono::steady_clock::time_point wallStart) {
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    VirtualCANBusStats powertrain = powertrainBus.getStats();
+
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < numTransitions; i++) {
+        hash = checksum(hash, transitions[i].time);
+        hash = checksum(hash, (uint32_t)transitions[i].state);
+    }
+    hash = checksum(hash, powertrain.frames);
+    hash = checksum(hash, inverterSim.getFaults());
+
+    printf("\nEndurance: ");
+    printTime(ENDURANCE_DURATION);
+    printf(" simulated in %.2f s, %.0fx real time\n", wall, ENDURANCE_DURATION / 1000.0 / wall);
+
+    printf("Tractive system states:\n");
+    for (int i = 0; i < numTransitions; i++) {
+        printf("  ");
+        printTime(transitions[i].time);
+        printf("  %s\n", tsStateName(transitions[i].state));
+    }
+
+    printf("Time in each state:\n");
+    for (int s = 0; s <= (int)TSStates::Driving; s++) {
+        if (stateTime[s] > 0) {
+            printf("  %-16s ", tsStateName((TSStates)s));
+            printTime(stateTime[s]);
+            printf("\n");
+        }
+    }
+
+    printf("Inverter: %lu faults, hottest motor %.1f deg C\n", (unsigned long)inverterSim.getFaults(), maxMotorTemp);
+    printf("Car: %.1f km driven, top speed %.0f km/h\n", vehicle.getDistance() / 1000, maxSpeed * 3.6);
+    printf("Battery: %.1f%% charge left, %lu signals stale, %lu stale events\n", bms.getSoC(),
+        (unsigned long)signalMonitor.getStaleSignals(), (unsigned long)signalMonitor.getStaleEvents());
+    printf("Powertrain bus: %lu frames, %.1f%% load\n", (unsigned long)powertrain.frames,
+        powertrain.busTime_us > 0 ? 100.0 * powertrain.bits * 1000000 / powertrainBus.getBitRate() / powertrain.busTime_us : 0.0);
+    printf("Checksum: %08lx\n", (unsigned long)hash);
+
+    // every task has run the whole event. These are host peaks, only good for sizing the simulated nodes, see stack_report.py
+    Task::print_stack_report();
+}
+
+/**
+ * @brief Drive the event, recording each state the tractive system passes through, then end the scheduler.
+ *
+ */
+void endurance_driver() {
+    auto wallStart = std::chrono::steady_clock::now();
+    uint32_t start = Task::millis();
+    uint32_t prev = start;
+
+    TSStates last = ts.getState();
+    transitions[numTransitions++] = { 0, last };
+
+    while (prev - start < ENDURANCE_DURATION) {
+        uint32_t t = prev - start;
+        applyDriverInputs(script(t), &vehicle);
+
+        TSStates state = ts.getState();
+        if (state != last && numTransitions < ENDURANCE_MAX_TRANSITIONS) {
+            transitions[numTransitions++] = { t, state };
+        }
+        last = state;
+        stateTime[(int)state] += ENDURANCE_DRIVER_PERIOD;
+        maxSpeed = std::max(maxSpeed, vehicle.getSpeed());
+        maxMotorTemp = std::max(maxMotorTemp, inverterSim.getMotorTemp());
+
+        Task::delay_until(&prev, ENDURANCE_DRIVER_PERIOD);
+    }
+
+    report(wallStart);
+    vTaskEndScheduler();
+}
+
+/**
+ * @brief Run the endurance event on virtual time, whatever the command line asks for.
+ *
+ */
+void host_endurance() {
+    hostUseVirtualTime();
+    hostRunFor(0);
+
+    applyDriverInputs(script(0), &vehicle);
+
+    powertrainBus.attach(&bmsCan);
+    powertrainBus.attach(&inverterCan);
+    hostCarInit();
+
+    bmsCan.init(CAN_TASK_PRIORITY);
+    inverterCan.init(CAN_TASK_PRIORITY);
+    bms.init(&bmsCan, TASK_PRIORITY_DEFAULT + 1);
+    inverterSim.init(&inverterCan, 1, TASK_PRIORITY_DEFAULT + 1, &vehicle, &bms);
+
+    driverTask.start(endurance_driver, TASK_PRIORITY_DEFAULT + 1, "Driver_Task");
+
+    startScheduler();
+}
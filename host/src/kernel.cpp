@@ -0,0 +1,1506 @@
+#include "arduino_freertos.h"
+#include "host.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <new>
+#include <thread>
+
+// The trace hooks are force-included by build_flags, as on the target
+#ifndef traceTASK_SWITCHED_IN
+#define traceTASK_SWITCHED_IN()
+#endif
+
+#ifndef traceTASK_SWITCHED_OUT
+#define traceTASK_SWITCHED_OUT()
+#endif
+
+// The most tasks that can exist at once. Each runs on its own thread, and the threads are all started before main,
+// so creating a task never touches the heap, as on the target.
+#define HOST_MAX_TASKS 48
+
+// How much of a thread's stack is painted when a task starts on it, so uxTaskGetStackHighWaterMark can measure how much
+// the task used. Far more than any StaticTask's stack, so a task which would overflow on the target still shows it.
+#define HOST_STACK_PAINT_BYTES (128 * 1024)
+#define HOST_STACK_PAINT 0xa5
+#define HOST_STACK_PAINT_GAP 64
+
+// What each kernel call costs a task in virtual time. With virtual time a task's code is free between kernel calls,
+// so this is what moves the clock, and the tick with it, while tasks are busy.
+#define HOST_VIRTUAL_KERNEL_CALL_US 1
+
+struct HostTCB;
+
+namespace {
+
+/**
+ * @brief A link in one of the kernel's lists, as FreeRTOS's ListItem_t. Lists are kept in ascending order of value.
+ *
+ */
+struct ListItem {
+    HostTCB* owner = nullptr;
+    uint64_t value = 0;
+    ListItem* prev = nullptr;
+    ListItem* next = nullptr;
+    struct List* container = nullptr;
+};
+
+struct List {
+    ListItem* head = nullptr;
+    ListItem* tail = nullptr;
+
+    bool empty() const {
+        return head == nullptr;
+    }
+
+    void insertEnd(ListItem* item) {
+        item->prev = tail;
+        item->next = nullptr;
+        if (tail != nullptr) {
+            tail->next = item;
+        } else {
+            head = item;
+        }
+        tail = item;
+        item->container = this;
+    }
+
+    void insertFront(ListItem* item) {
+        item->prev = nullptr;
+        item->next = head;
+        if (head != nullptr) {
+            head->prev = item;
+        } else {
+            tail = item;
+        }
+        head = item;
+        item->container = this;
+    }
+
+    // after any items of equal value, so equal items are kept in the order they arrived
+    void insertSorted(ListItem* item, uint64_t value) {
+        item->value = value;
+
+        ListItem* after = tail;
+        while (after != nullptr && after->value > value) {
+            after = after->prev;
+        }
+
+        if (after == nullptr) {
+            insertFront(item);
+            return;
+        }
+
+        item->prev = after;
+        item->next = after->next;
+        if (after->next != nullptr) {
+            after->next->prev = item;
+        } else {
+            tail = item;
+        }
+        after->next = item;
+        item->container = this;
+    }
+};
+
+void listRemove(ListItem* item) {
+    List* list = item->container;
+    if (list == nullptr) {
+        return;
+    }
+
+    if (item->prev != nullptr) {
+        item->prev->next = item->next;
+    } else {
+        list->head = item->next;
+    }
+    if (item->next != nullptr) {
+        item->next->prev = item->prev;
+    } else {
+        list->tail = item->prev;
+    }
+
+    item->prev = nullptr;
+    item->next = nullptr;
+    item->container = nullptr;
+}
+
+enum class TaskState {
+    Ready,
+    Running,
+    Blocked,
+    Suspended,
+    Deleted
+};
+
+enum class NotifyState {
+    NotWaiting,
+    Waiting,
+    Received
+};
+
+/**
+ * @brief A thread to run a task on. A task only runs while it is the current task; at any other time its thread
+ * waits on wake.
+ *
+ */
+struct Worker {
+    std::thread thread;
+    std::condition_variable_any wake;
+    HostTCB* tcb = nullptr;
+    bool killed = false; // the task was deleted, or the scheduler ended, and the thread must unwind
+};
+
+/**
+ * @brief Thrown on a task's thread to unwind it when the task is deleted.
+ *
+ */
+struct TaskKilled {};
+
+} // namespace
+
+struct HostTCB {
+    char name[configMAX_TASK_NAME_LEN];
+    TaskFunction_t function;
+    void* parameters;
+    uint32_t stackDepth;
+    uint8_t* stackTop; // where the task's frames start on its thread, nullptr if its stack wasn't painted
+    TaskHookFunction_t tag;
+
+    UBaseType_t priority;     // raised above basePriority while holding a mutex a higher priority task waits for
+    UBaseType_t basePriority;
+    UBaseType_t mutexesHeld;
+
+    TaskState state;
+    ListItem stateItem; // in a ready list, or the delayed list
+    ListItem eventItem; // in a queue's list of waiting tasks
+    bool timedOut;
+
+    uint32_t notifyValue;
+    NotifyState notifyState;
+
+    Worker* worker;
+};
+
+struct HostQueue {
+    uint8_t* storage;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    UBaseType_t head; // the next item to receive
+    UBaseType_t count;
+
+    bool isMutex;
+    HostTCB* holder;
+
+    List waitingToSend;
+    List waitingToReceive;
+};
+
+static_assert(sizeof(HostTCB) <= sizeof(StaticTask_t), "StaticTask_t is too small for the host's task control block");
+static_assert(sizeof(HostQueue) <= sizeof(StaticQueue_t), "StaticQueue_t is too small for the host's queue");
+
+namespace {
+
+// The kernel lock. Kernel calls, the tick and critical sections all hold it, as interrupts are masked on the target.
+std::recursive_mutex kernelMutex;
+typedef std::unique_lock<std::recursive_mutex> Lock;
+
+List readyLists[configMAX_PRIORITIES];
+List delayedList;
+List microsDelayedList; // tasks in hostDelayUntilMicros, by the microsecond they wake at
+
+HostTCB* current = nullptr; // nullptr while no task is ready, the idle task on the target
+uint64_t tickCount = 0;
+uint64_t runUntilTick = 0;
+uint32_t runForMs = 0;
+
+bool schedulerRunning = false;
+UBaseType_t schedulerSuspended = 0;
+UBaseType_t criticalNesting = 0;
+bool yieldPending = false;   // a task of higher priority than the current one may be ready
+bool timeSliceDue = false;   // the tick has passed with another task ready at the current task's priority
+bool shuttingDown = false;
+bool switchedInPending = false; // the current task's thread hasn't taken the CPU yet, so its switch in isn't traced
+
+std::condition_variable_any schedulerEnded;
+std::thread tickThread;
+std::condition_variable_any tickWake; // wakes the tick thread early, for a task in hostDelayUntilMicros
+
+// With virtual time there's no tick thread: the clock moves only as tasks spend time, and jumps ahead over idle time
+std::atomic<bool> virtualTime{ false };
+std::atomic<uint64_t> virtualMicros{ 0 };
+
+thread_local HostTCB* self = nullptr;     // the task this thread runs
+thread_local Worker* thisWorker = nullptr;
+
+const auto startTime = std::chrono::steady_clock::now();
+
+Worker (&workers())[HOST_MAX_TASKS];
+
+void advanceTick(uint64_t to);
+void wakeDueMicros();
+void endScheduler();
+void spendVirtualTime(Lock& lock, uint64_t us);
+
+bool inTask() {
+    return self != nullptr && self == current;
+}
+
+bool canBlock() {
+    return schedulerRunning && inTask();
+}
+
+HostTCB* highestReady() {
+    for (int p = configMAX_PRIORITIES - 1; p >= 0; p--) {
+        if (!readyLists[p].empty()) {
+            return readyLists[p].head->owner;
+        }
+    }
+    return nullptr;
+}
+
+void addToReady(HostTCB* t, bool front = false) {
+    t->state = TaskState::Ready;
+    if (front) {
+        readyLists[t->priority].insertFront(&t->stateItem);
+    } else {
+        readyLists[t->priority].insertEnd(&t->stateItem);
+    }
+
+    if (current == nullptr || t->priority > current->priority) {
+        yieldPending = true;
+    }
+}
+
+/**
+ * @brief With virtual time, jump the clock over time the CPU would spend idle, to the next task's wake up. If no task
+ * will ever wake, the scheduler ends, as nothing outside the tasks can wake one.
+ *
+ */
+void skipIdleTime() {
+    while (virtualTime && schedulerRunning && highestReady() == nullptr) {
+        uint64_t wake_us = UINT64_MAX;
+        if (!delayedList.empty()) {
+            wake_us = delayedList.head->value * 1000;
+        }
+        if (!microsDelayedList.empty()) {
+            wake_us = std::min(wake_us, microsDelayedList.head->value);
+        }
+        if (runUntilTick != 0) {
+            wake_us = std::min(wake_us, runUntilTick * 1000);
+        }
+
+        if (wake_us == UINT64_MAX) {
+            printf("WARNING: Every task is blocked with no timeout, so virtual time can't advance!\n");
+            endScheduler();
+            return;
+        }
+
+        virtualMicros = std::max(virtualMicros.load(), wake_us);
+        wakeDueMicros();
+        advanceTick(virtualMicros / 1000);
+    }
+}
+
+/**
+ * @brief Make the highest priority ready task current, and hand its thread the CPU. The outgoing task must already
+ * be on the list it belongs on.
+ *
+ */
+void switchContext() {
+    if (!switchedInPending) {
+        traceTASK_SWITCHED_OUT();
+    }
+    switchedInPending = false;
+    current = nullptr;
+
+    skipIdleTime();
+    if (!schedulerRunning) {
+        return;
+    }
+
+    HostTCB* next = highestReady();
+    if (next != nullptr) {
+        listRemove(&next->stateItem);
+        next->state = TaskState::Running;
+    }
+    current = next;
+    yieldPending = false;
+    timeSliceDue = false;
+
+    // a task on another thread is traced in once that thread has woken, or it would be charged for the handoff
+    if (next == nullptr || next == self) {
+        traceTASK_SWITCHED_IN();
+    } else {
+        switchedInPending = true;
+    }
+
+    if (next != nullptr) {
+        next->worker->wake.notify_one();
+    }
+}
+
+/**
+ * @brief Trace the switch in to the current task, once its thread has the CPU. A host thread takes far longer to wake
+ * than a context switch takes on the target, and the run time of the task which woke shouldn't include it.
+ *
+ */
+void traceSwitchedIn() {
+    if (switchedInPending && inTask()) {
+        switchedInPending = false;
+        traceTASK_SWITCHED_IN();
+    }
+}
+
+/**
+ * @brief Park this task's thread until it is current again.
+ *
+ */
+void waitToRun(Lock& lock) {
+    Worker* worker = thisWorker;
+    HostTCB* task = self;
+    worker->wake.wait(lock, [&] { return current == task || worker->killed || shuttingDown; });
+
+    if (worker->killed || shuttingDown) {
+        throw TaskKilled();
+    }
+    traceSwitchedIn();
+}
+
+/**
+ * @brief Take the kernel lock for a kernel call. A task still running once it has been killed, when the scheduler
+ * ends, stops at its next kernel call, as it would have stopped at once on the target.
+ *
+ */
+Lock lockKernel() {
+    Lock lock(kernelMutex);
+
+    if (virtualTime && inTask()) {
+        spendVirtualTime(lock, HOST_VIRTUAL_KERNEL_CALL_US);
+    }
+
+    if (self != nullptr && (thisWorker->killed || shuttingDown) && std::uncaught_exceptions() == 0) {
+        throw TaskKilled();
+    }
+    return lock;
+}
+
+void yieldCurrent(Lock& lock) {
+    switchContext();
+    if (current != self) {
+        waitToRun(lock);
+    }
+}
+
+/**
+ * @brief Switch tasks if a kernel call or the tick has readied a task which should run instead of the current one.
+ *
+ * @param fromTask Switch away from the calling task, if it's the current one. Calls from ISRs leave the switch to
+ * portYIELD_FROM_ISR.
+ */
+void reschedule(Lock& lock, bool fromTask) {
+    if (!schedulerRunning || schedulerSuspended > 0) {
+        return;
+    }
+
+    // the CPU is idle, so dispatch from whichever thread this is
+    if (current == nullptr) {
+        if (highestReady() != nullptr) {
+            switchContext();
+        }
+        return;
+    }
+
+    if (!fromTask || !inTask() || criticalNesting > 0 || !yieldPending) {
+        return;
+    }
+
+    HostTCB* next = highestReady();
+    if (next == nullptr) {
+        yieldPending = false;
+        return;
+    }
+
+    if (next->priority > self->priority) {
+        // preempted tasks resume first among their priority
+        addToReady(self, true);
+        yieldCurrent(lock);
+    } else if (next->priority == self->priority && timeSliceDue) {
+        addToReady(self);
+        yieldCurrent(lock);
+    } else {
+        yieldPending = false;
+    }
+}
+
+/**
+ * @brief Move virtual time on by time the caller spends on the CPU, running the tick for each millisecond passed, so
+ * that the current task can be preempted or time sliced as the tick interrupt would.
+ *
+ */
+void spendVirtualTime(Lock& lock, uint64_t us) {
+    virtualMicros += us;
+    if (!schedulerRunning || !inTask()) {
+        return;
+    }
+
+    wakeDueMicros();
+    advanceTick(virtualMicros / 1000);
+    reschedule(lock, true);
+}
+
+/**
+ * @brief Block the current task, on an event list and/or for a number of ticks, until another task or the tick
+ * makes it ready.
+ *
+ * @return true if it was woken before the timeout
+ */
+bool blockCurrent(Lock& lock, List* eventList, TickType_t ticks) {
+    configASSERT(criticalNesting == 0);
+    configASSERT(schedulerSuspended == 0);
+
+    HostTCB* t = self;
+    t->timedOut = false;
+
+    if (eventList != nullptr) {
+        eventList->insertSorted(&t->eventItem, configMAX_PRIORITIES - t->priority);
+    }
+    if (ticks != portMAX_DELAY) {
+        delayedList.insertSorted(&t->stateItem, tickCount + ticks);
+    }
+    t->state = TaskState::Blocked;
+
+    yieldCurrent(lock);
+
+    return !t->timedOut;
+}
+
+void wakeTask(HostTCB* t) {
+    if (t->state != TaskState::Blocked) {
+        return;
+    }
+
+    listRemove(&t->eventItem);
+    listRemove(&t->stateItem);
+    addToReady(t);
+}
+
+// wake the highest priority task waiting on an event list
+HostTCB* wakeFirst(List* list) {
+    if (list->empty()) {
+        return nullptr;
+    }
+
+    HostTCB* t = list->head->owner;
+    wakeTask(t);
+    return t;
+}
+
+bool wokeHigherPriority(HostTCB* t) {
+    return t != nullptr && (current == nullptr || t->priority > current->priority);
+}
+
+void removeFromLists(HostTCB* t) {
+    listRemove(&t->stateItem);
+    listRemove(&t->eventItem);
+}
+
+void setPriority(HostTCB* t, UBaseType_t priority) {
+    t->priority = priority;
+
+    if (t->state == TaskState::Ready) {
+        listRemove(&t->stateItem);
+        addToReady(t);
+    }
+
+    if (t->eventItem.container != nullptr) {
+        List* list = t->eventItem.container;
+        listRemove(&t->eventItem);
+        list->insertSorted(&t->eventItem, configMAX_PRIORITIES - priority);
+    }
+
+    if (t == current) {
+        HostTCB* next = highestReady();
+        if (next != nullptr && next->priority > priority) {
+            yieldPending = true;
+        }
+    }
+}
+
+void endScheduler() {
+    schedulerRunning = false;
+    tickWake.notify_one();
+
+    if (current != nullptr) {
+        if (!switchedInPending) {
+            traceTASK_SWITCHED_OUT();
+        }
+        switchedInPending = false;
+        current = nullptr;
+    }
+
+    for (Worker& w : workers()) {
+        if (w.tcb != nullptr) {
+            w.killed = true;
+            w.wake.notify_one();
+        }
+    }
+
+    schedulerEnded.notify_all();
+}
+
+void advanceTick(uint64_t to) {
+    while (tickCount < to && schedulerRunning) {
+        tickCount++;
+
+        while (!delayedList.empty() && delayedList.head->value <= tickCount) {
+            HostTCB* t = delayedList.head->owner;
+            listRemove(&t->stateItem);
+            listRemove(&t->eventItem);
+            t->timedOut = true;
+            addToReady(t);
+        }
+
+        if (current != nullptr && !readyLists[current->priority].empty()) {
+            timeSliceDue = true;
+            yieldPending = true;
+        }
+
+        if (runUntilTick != 0 && tickCount >= runUntilTick) {
+            endScheduler();
+        }
+    }
+}
+
+/**
+ * @brief Ready the tasks in hostDelayUntilMicros whose wake up the clock has reached.
+ *
+ */
+void wakeDueMicros() {
+    while (!microsDelayedList.empty() && microsDelayedList.head->value <= hostMicros()) {
+        HostTCB* t = microsDelayedList.head->owner;
+        listRemove(&t->stateItem);
+        t->timedOut = true;
+        addToReady(t);
+    }
+}
+
+void tickLoop() {
+    auto next = std::chrono::steady_clock::now();
+
+    Lock lock(kernelMutex);
+    while (schedulerRunning) {
+        next += std::chrono::milliseconds(1);
+
+        // wake early for any task in hostDelayUntilMicros due before the tick
+        while (schedulerRunning && std::chrono::steady_clock::now() < next) {
+            auto until = next;
+            if (!microsDelayedList.empty()) {
+                until = std::min(until, startTime + std::chrono::microseconds(microsDelayedList.head->value));
+            }
+            tickWake.wait_until(lock, until);
+
+            wakeDueMicros();
+            reschedule(lock, false);
+        }
+
+        advanceTick(hostMicros() / 1000);
+        reschedule(lock, false);
+    }
+}
+
+/**
+ * @brief Paint the thread's stack below the caller, which the task's frames grow down into. The sanitizers keep their
+ * own state for stack memory and would see the paint as a bad access, so under them nothing is painted.
+ *
+ * @return uint8_t* Where the task's frames start, above the paint, or nullptr if nothing was painted
+ */
+__attribute__((noinline)) uint8_t* paintStack() {
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+    return nullptr;
+#else
+    uint8_t* top = (uint8_t*)__builtin_frame_address(0);
+
+    // byte by byte rather than with memset, which would need a frame of its own below this one. The paint starts clear
+    // of this function's locals, so a task's first few words are always counted as used.
+    volatile uint8_t* paint = top - HOST_STACK_PAINT_GAP;
+    for (int i = 0; i < HOST_STACK_PAINT_BYTES; i++) {
+        *--paint = HOST_STACK_PAINT;
+    }
+    return top;
+#endif
+}
+
+void workerLoop(Worker* w) {
+    thisWorker = w;
+
+    Lock lock(kernelMutex);
+    while (true) {
+        w->wake.wait(lock, [&] { return shuttingDown || w->killed || (w->tcb != nullptr && current == w->tcb); });
+        if (shuttingDown) {
+            return;
+        }
+
+        if (!w->killed) {
+            self = w->tcb;
+            self->stackTop = paintStack();
+            traceSwitchedIn();
+            lock.unlock();
+
+            try {
+                self->function(self->parameters);
+
+                printf("WARNING: Task %s returned! Tasks must delete themselves.\n", self->name);
+                configASSERT(0);
+            } catch (TaskKilled&) {
+            }
+
+            lock.lock();
+            self = nullptr;
+        }
+
+        w->tcb = nullptr;
+        w->killed = false;
+        schedulerEnded.notify_all();
+    }
+}
+
+/**
+ * @brief The threads tasks run on, started before main.
+ *
+ */
+struct WorkerPool {
+    Worker workers[HOST_MAX_TASKS];
+
+    WorkerPool() {
+        for (Worker& w : workers) {
+            w.thread = std::thread(workerLoop, &w);
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            Lock lock(kernelMutex);
+            shuttingDown = true;
+            for (Worker& w : workers) {
+                w.wake.notify_one();
+            }
+        }
+
+        for (Worker& w : workers) {
+            if (w.thread.get_id() == std::this_thread::get_id()) {
+                w.thread.detach();
+            } else if (w.thread.joinable()) {
+                w.thread.join();
+            }
+        }
+    }
+};
+
+WorkerPool pool;
+
+Worker (&workers())[HOST_MAX_TASKS] {
+    return pool.workers;
+}
+
+bool allWorkersIdle() {
+    for (Worker& w : workers()) {
+        if (w.tcb != nullptr) {
+            return false;
+        }
+    }
+    return true;
+}
+
+HostTCB* taskOrSelf(TaskHandle_t task) {
+    return task != nullptr ? task : self;
+}
+
+// The tick at which a wait of some ticks from now ends, UINT64_MAX for no timeout
+uint64_t deadlineFor(TickType_t ticks) {
+    return ticks == portMAX_DELAY ? UINT64_MAX : tickCount + ticks;
+}
+
+// The ticks left until a deadline, false if it has passed
+bool ticksLeft(uint64_t deadline, TickType_t* ticks) {
+    if (deadline == UINT64_MAX) {
+        *ticks = portMAX_DELAY;
+        return true;
+    }
+    if (deadline <= tickCount) {
+        return false;
+    }
+    *ticks = (TickType_t)(deadline - tickCount);
+    return true;
+}
+
+} // namespace
+
+// ------------------ Time ------------------
+
+uint64_t hostMicros() {
+    if (virtualTime) {
+        return virtualMicros;
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void hostUseVirtualTime() {
+    Lock lock = lockKernel();
+    configASSERT(!schedulerRunning);
+    virtualTime = true;
+}
+
+bool hostIsVirtualTime() {
+    return virtualTime;
+}
+
+void hostBusyWait(uint32_t us) {
+    if (!virtualTime) {
+        uint64_t end = hostMicros() + us;
+        while (hostMicros() < end) {
+        }
+        return;
+    }
+
+    Lock lock = lockKernel();
+    spendVirtualTime(lock, us);
+}
+
+void hostDelayUntilMicros(uint64_t us) {
+    Lock lock = lockKernel();
+    if (!canBlock()) {
+        return;
+    }
+
+    if (us <= hostMicros()) {
+        return;
+    }
+
+    HostTCB* t = self;
+    t->timedOut = false;
+    microsDelayedList.insertSorted(&t->stateItem, us);
+    t->state = TaskState::Blocked;
+
+    // on the host's clock, the tick thread wakes it
+    tickWake.notify_one();
+    yieldCurrent(lock);
+}
+
+void hostRunFor(uint32_t ms) {
+    Lock lock = lockKernel();
+    runForMs = ms;
+    if (schedulerRunning) {
+        runUntilTick = ms == 0 ? 0 : tickCount + ms;
+    }
+}
+
+// ------------------ Ports ------------------
+
+void vAssertCalled(const char* file, int line) {
+    printf("ASSERT: %s:%d in task %s\n", file, line, self != nullptr ? self->name : "(none)");
+    fflush(stdout);
+    abort();
+}
+
+void vPortEnterCritical() {
+    kernelMutex.lock();
+    criticalNesting++;
+}
+
+void vPortExitCritical() {
+    configASSERT(criticalNesting > 0);
+    criticalNesting--;
+
+    if (criticalNesting == 0 && yieldPending && inTask()) {
+        Lock lock(kernelMutex, std::adopt_lock);
+        reschedule(lock, true);
+        return;
+    }
+
+    kernelMutex.unlock();
+}
+
+void vPortYield() {
+    Lock lock = lockKernel();
+    if (canBlock() && schedulerSuspended == 0) {
+        addToReady(self);
+        yieldCurrent(lock);
+    }
+}
+
+void vPortYieldFromISR(BaseType_t higherPriorityTaskWoken) {
+    if (higherPriorityTaskWoken == pdFALSE) {
+        return;
+    }
+
+    Lock lock = lockKernel();
+    reschedule(lock, true);
+}
+
+// ------------------ Tasks ------------------
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t pxTaskCode, const char* pcName, uint32_t ulStackDepth, void* pvParameters,
+    UBaseType_t uxPriority, StackType_t* puxStackBuffer, StaticTask_t* pxTaskBuffer) {
+    if (pxTaskCode == nullptr || puxStackBuffer == nullptr || pxTaskBuffer == nullptr) {
+        return nullptr;
+    }
+
+    Lock lock = lockKernel();
+
+    Worker* worker = nullptr;
+    for (Worker& w : workers()) {
+        if (w.tcb == nullptr && !w.killed) {
+            worker = &w;
+            break;
+        }
+    }
+    if (worker == nullptr) {
+        printf("WARNING: No thread for task %s! At most %d tasks can exist at once.\n", pcName, HOST_MAX_TASKS);
+        configASSERT(0);
+        return nullptr;
+    }
+
+    HostTCB* t = new (pxTaskBuffer) HostTCB();
+    strncpy(t->name, pcName, configMAX_TASK_NAME_LEN - 1);
+    t->name[configMAX_TASK_NAME_LEN - 1] = '\0';
+    t->function = pxTaskCode;
+    t->parameters = pvParameters;
+    t->stackDepth = ulStackDepth;
+    t->priority = uxPriority < configMAX_PRIORITIES ? uxPriority : configMAX_PRIORITIES - 1;
+    t->basePriority = t->priority;
+    t->stateItem.owner = t;
+    t->eventItem.owner = t;
+    t->notifyState = NotifyState::NotWaiting;
+    t->worker = worker;
+
+    worker->tcb = t;
+
+    addToReady(t);
+    reschedule(lock, true);
+
+    return t;
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete) {
+    Lock lock = lockKernel();
+
+    HostTCB* t = taskOrSelf(xTaskToDelete);
+    if (t == nullptr || t->state == TaskState::Deleted) {
+        return;
+    }
+
+    removeFromLists(t);
+    t->state = TaskState::Deleted;
+
+    if (t == current) {
+        switchContext();
+    }
+
+    if (t == self) {
+        lock.unlock();
+        throw TaskKilled();
+    }
+
+    t->worker->killed = true;
+    t->worker->wake.notify_one();
+}
+
+void vTaskStartScheduler() {
+    Lock lock = lockKernel();
+
+    tickCount = hostMicros() / 1000;
+    runUntilTick = runForMs == 0 ? 0 : tickCount + runForMs;
+    schedulerRunning = true;
+
+    if (!virtualTime) {
+        tickThread = std::thread(tickLoop);
+    }
+
+    switchContext();
+
+    schedulerEnded.wait(lock, [] { return !schedulerRunning && allWorkersIdle(); });
+
+    lock.unlock();
+    if (tickThread.joinable()) {
+        tickThread.join();
+    }
+}
+
+void vTaskEndScheduler() {
+    Lock lock = lockKernel();
+    endScheduler();
+
+    if (self != nullptr) {
+        lock.unlock();
+        throw TaskKilled();
+    }
+}
+
+void vTaskSuspendAll() {
+    Lock lock = lockKernel();
+    schedulerSuspended++;
+}
+
+BaseType_t xTaskResumeAll() {
+    Lock lock = lockKernel();
+    configASSERT(schedulerSuspended > 0);
+    schedulerSuspended--;
+
+    if (schedulerSuspended == 0 && yieldPending && inTask()) {
+        reschedule(lock, true);
+        return pdTRUE;
+    }
+    return pdFALSE;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    // the trace hooks call this in the middle of a switch, so it must never stop the caller
+    Lock lock(kernelMutex);
+    return current;
+}
+
+char* pcTaskGetName(TaskHandle_t xTaskToQuery) {
+    HostTCB* t = taskOrSelf(xTaskToQuery);
+    return t != nullptr ? t->name : nullptr;
+}
+
+eTaskState eTaskGetState(TaskHandle_t xTask) {
+    Lock lock = lockKernel();
+
+    if (xTask == nullptr) {
+        return eInvalid;
+    }
+    if (xTask == current) {
+        return eRunning;
+    }
+
+    switch (xTask->state) {
+    case TaskState::Ready:
+    case TaskState::Running:
+        return eReady;
+    case TaskState::Blocked:
+        return eBlocked;
+    case TaskState::Suspended:
+        return eSuspended;
+    case TaskState::Deleted:
+        return eDeleted;
+    }
+    return eInvalid;
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t xTask) {
+    Lock lock = lockKernel();
+    return taskOrSelf(xTask)->priority;
+}
+
+void vTaskPrioritySet(TaskHandle_t xTask, UBaseType_t uxNewPriority) {
+    Lock lock = lockKernel();
+
+    HostTCB* t = taskOrSelf(xTask);
+    if (uxNewPriority >= configMAX_PRIORITIES) {
+        uxNewPriority = configMAX_PRIORITIES - 1;
+    }
+
+    // a task holding a mutex keeps any priority it inherited until it gives the mutex back
+    t->basePriority = uxNewPriority;
+    if (t->mutexesHeld == 0 || uxNewPriority > t->priority) {
+        setPriority(t, uxNewPriority);
+    }
+
+    reschedule(lock, true);
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t xTask) {
+    // tasks run on their threads' stacks rather than the StaticTask's, so the use is measured from the paint there.
+    // x86-64 frames are larger than the target's, so this overestimates what the task needs on the target.
+    HostTCB* t = taskOrSelf(xTask);
+    if (t == nullptr || t->stackTop == nullptr) {
+        return t != nullptr ? t->stackDepth : 0;
+    }
+
+    const uint8_t* paintTop = t->stackTop - HOST_STACK_PAINT_GAP;
+    const uint8_t* deepest = paintTop - HOST_STACK_PAINT_BYTES;
+    while (deepest < paintTop && *deepest == HOST_STACK_PAINT) {
+        deepest++;
+    }
+
+    uint32_t used = (t->stackTop - deepest + sizeof(StackType_t) - 1) / sizeof(StackType_t);
+    return used < t->stackDepth ? t->stackDepth - used : 0;
+}
+
+void vTaskSetApplicationTaskTag(TaskHandle_t xTask, TaskHookFunction_t pxHookFunction) {
+    Lock lock = lockKernel();
+    taskOrSelf(xTask)->tag = pxHookFunction;
+}
+
+TaskHookFunction_t xTaskGetApplicationTaskTag(TaskHandle_t xTask) {
+    Lock lock = lockKernel();
+    return taskOrSelf(xTask)->tag;
+}
+
+TaskHookFunction_t xTaskGetApplicationTaskTagFromISR(TaskHandle_t xTask) {
+    // the trace hooks call this from inside switchContext, so it mustn't spend virtual time, which could reschedule
+    Lock lock(kernelMutex);
+    return taskOrSelf(xTask)->tag;
+}
+
+void vTaskSuspend(TaskHandle_t xTaskToSuspend) {
+    Lock lock = lockKernel();
+
+    HostTCB* t = taskOrSelf(xTaskToSuspend);
+    removeFromLists(t);
+    t->state = TaskState::Suspended;
+    if (t->notifyState == NotifyState::Waiting) {
+        t->notifyState = NotifyState::NotWaiting;
+    }
+
+    if (t == current) {
+        configASSERT(schedulerSuspended == 0);
+        yieldCurrent(lock);
+    }
+}
+
+void vTaskResume(TaskHandle_t xTaskToResume) {
+    Lock lock = lockKernel();
+
+    HostTCB* t = xTaskToResume;
+    if (t == nullptr || t->state != TaskState::Suspended) {
+        return;
+    }
+
+    addToReady(t);
+    reschedule(lock, true);
+}
+
+void vTaskDelay(TickType_t xTicksToDelay) {
+    Lock lock = lockKernel();
+    if (!canBlock()) {
+        return;
+    }
+
+    if (xTicksToDelay == 0) {
+        addToReady(self);
+        yieldCurrent(lock);
+        return;
+    }
+
+    blockCurrent(lock, nullptr, xTicksToDelay);
+}
+
+void vTaskDelayUntil(TickType_t* pxPreviousWakeTime, TickType_t xTimeIncrement) {
+    Lock lock = lockKernel();
+
+    // as FreeRTOS, allowing for the tick count overflowing
+    const TickType_t now = (TickType_t)tickCount;
+    const TickType_t timeToWake = *pxPreviousWakeTime + xTimeIncrement;
+    bool shouldDelay;
+
+    if (now < *pxPreviousWakeTime) {
+        shouldDelay = (timeToWake < *pxPreviousWakeTime) && (timeToWake > now);
+    } else {
+        shouldDelay = (timeToWake < *pxPreviousWakeTime) || (timeToWake > now);
+    }
+
+    *pxPreviousWakeTime = timeToWake;
+
+    if (!canBlock()) {
+        return;
+    }
+
+    if (shouldDelay) {
+        blockCurrent(lock, nullptr, timeToWake - now);
+    } else {
+        addToReady(self);
+        yieldCurrent(lock);
+    }
+}
+
+TickType_t xTaskGetTickCount() {
+    Lock lock = lockKernel();
+    return (TickType_t)tickCount;
+}
+
+TickType_t xTaskGetTickCountFromISR() {
+    return xTaskGetTickCount();
+}
+
+void vTaskSetTimeOutState(TimeOut_t* pxTimeOut) {
+    Lock lock = lockKernel();
+    pxTimeOut->entryTick = tickCount;
+}
+
+BaseType_t xTaskCheckForTimeOut(TimeOut_t* pxTimeOut, TickType_t* pxTicksToWait) {
+    Lock lock = lockKernel();
+
+    if (*pxTicksToWait == portMAX_DELAY) {
+        return pdFALSE;
+    }
+
+    uint64_t elapsed = tickCount - pxTimeOut->entryTick;
+    if (elapsed < *pxTicksToWait) {
+        *pxTicksToWait -= (TickType_t)elapsed;
+        pxTimeOut->entryTick = tickCount;
+        return pdFALSE;
+    }
+
+    *pxTicksToWait = 0;
+    return pdTRUE;
+}
+
+// ------------------ Notifications ------------------
+
+static bool notifyGive(HostTCB* t) {
+    configASSERT(t != nullptr);
+
+    NotifyState previous = t->notifyState;
+    t->notifyState = NotifyState::Received;
+    t->notifyValue++;
+
+    if (previous == NotifyState::Waiting) {
+        wakeTask(t);
+        return wokeHigherPriority(t);
+    }
+    return false;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t xTaskToNotify) {
+    Lock lock = lockKernel();
+    notifyGive(xTaskToNotify);
+    reschedule(lock, true);
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t xTaskToNotify, BaseType_t* pxHigherPriorityTaskWoken) {
+    Lock lock = lockKernel();
+    if (notifyGive(xTaskToNotify) && pxHigherPriorityTaskWoken != nullptr) {
+        *pxHigherPriorityTaskWoken = pdTRUE;
+    }
+    reschedule(lock, false);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t xClearCountOnExit, TickType_t xTicksToWait) {
+    Lock lock = lockKernel();
+    HostTCB* t = self;
+    configASSERT(t != nullptr);
+
+    if (t->notifyValue == 0 && xTicksToWait > 0 && canBlock()) {
+        t->notifyState = NotifyState::Waiting;
+        blockCurrent(lock, nullptr, xTicksToWait);
+    }
+
+    uint32_t value = t->notifyValue;
+    if (value != 0) {
+        t->notifyValue = xClearCountOnExit != pdFALSE ? 0 : value - 1;
+    }
+    t->notifyState = NotifyState::NotWaiting;
+
+    return value;
+}
+
+BaseType_t xTaskGenericNotifyStateClear(TaskHandle_t xTask, UBaseType_t uxIndexToClear) {
+    Lock lock = lockKernel();
+    configASSERT(uxIndexToClear == 0);
+
+    HostTCB* t = taskOrSelf(xTask);
+    if (t->notifyState == NotifyState::Received) {
+        t->notifyState = NotifyState::NotWaiting;
+        return pdPASS;
+    }
+    return pdFAIL;
+}
+
+// ------------------ Queues ------------------
+
+enum class QueuePosition {
+    Back,
+    Front,
+    Overwrite
+};
+
+static uint8_t* queueSlot(HostQueue* q, UBaseType_t index) {
+    return q->storage + (index % q->length) * q->itemSize;
+}
+
+static void queueCopyIn(HostQueue* q, const void* item, QueuePosition position) {
+    if (position == QueuePosition::Overwrite && q->count > 0) {
+        // overwrite is only for queues of length one
+        if (q->itemSize > 0) {
+            memcpy(queueSlot(q, q->head), item, q->itemSize);
+        }
+        return;
+    }
+
+    if (position == QueuePosition::Front) {
+        q->head = (q->head + q->length - 1) % q->length;
+        if (q->itemSize > 0) {
+            memcpy(queueSlot(q, q->head), item, q->itemSize);
+        }
+    } else if (q->itemSize > 0) {
+        memcpy(queueSlot(q, q->head + q->count), item, q->itemSize);
+    }
+    q->count++;
+}
+
+static void queueCopyOut(HostQueue* q, void* buffer, bool peek) {
+    if (q->itemSize > 0) {
+        memcpy(buffer, queueSlot(q, q->head), q->itemSize);
+    }
+    if (!peek) {
+        q->head = (q->head + 1) % q->length;
+        q->count--;
+    }
+}
+
+static HostQueue* createQueue(UBaseType_t length, UBaseType_t itemSize, uint8_t* storage, StaticQueue_t* buffer) {
+    if (buffer == nullptr || length == 0 || (itemSize > 0 && storage == nullptr)) {
+        return nullptr;
+    }
+
+    HostQueue* q = new (buffer) HostQueue();
+    q->storage = storage;
+    q->length = length;
+    q->itemSize = itemSize;
+    return q;
+}
+
+static BaseType_t queueSend(HostQueue* q, const void* item, TickType_t ticks, QueuePosition position) {
+    configASSERT(q != nullptr);
+    Lock lock = lockKernel();
+    uint64_t deadline = deadlineFor(ticks);
+
+    while (true) {
+        if (q->count < q->length || position == QueuePosition::Overwrite) {
+            queueCopyIn(q, item, position);
+            wakeFirst(&q->waitingToReceive);
+            reschedule(lock, true);
+            return pdPASS;
+        }
+
+        TickType_t left;
+        if (ticks == 0 || !canBlock() || !ticksLeft(deadline, &left)) {
+            return errQUEUE_FULL;
+        }
+        blockCurrent(lock, &q->waitingToSend, left);
+    }
+}
+
+static BaseType_t queueSendFromISR(HostQueue* q, const void* item, BaseType_t* woken, QueuePosition position) {
+    configASSERT(q != nullptr);
+    Lock lock = lockKernel();
+
+    if (q->count >= q->length && position != QueuePosition::Overwrite) {
+        return errQUEUE_FULL;
+    }
+
+    queueCopyIn(q, item, position);
+    if (wokeHigherPriority(wakeFirst(&q->waitingToReceive)) && woken != nullptr) {
+        *woken = pdTRUE;
+    }
+    reschedule(lock, false);
+    return pdPASS;
+}
+
+// a mutex's holder, if it holds no other mutex, goes back to the highest priority still waiting for it
+static void disinheritAfterTimeout(HostQueue* q) {
+    HostTCB* holder = q->holder;
+    if (holder == nullptr || holder->mutexesHeld != 1) {
+        return;
+    }
+
+    UBaseType_t priority = holder->basePriority;
+    if (!q->waitingToReceive.empty()) {
+        priority = std::max(priority, q->waitingToReceive.head->owner->priority);
+    }
+    if (priority != holder->priority) {
+        setPriority(holder, priority);
+    }
+}
+
+static BaseType_t queueReceive(HostQueue* q, void* buffer, TickType_t ticks, bool peek) {
+    configASSERT(q != nullptr);
+    Lock lock = lockKernel();
+    uint64_t deadline = deadlineFor(ticks);
+
+    while (true) {
+        if (q->count > 0) {
+            if (q->isMutex) {
+                q->count = 0;
+                q->holder = self;
+                if (self != nullptr) {
+                    self->mutexesHeld++;
+                }
+            } else {
+                queueCopyOut(q, buffer, peek);
+            }
+
+            // a peek leaves the item for the next receiver
+            wakeFirst(peek ? &q->waitingToReceive : &q->waitingToSend);
+            reschedule(lock, true);
+            return pdPASS;
+        }
+
+        TickType_t left;
+        if (ticks == 0 || !canBlock() || !ticksLeft(deadline, &left)) {
+            return errQUEUE_EMPTY;
+        }
+
+        if (q->isMutex && q->holder != nullptr && q->holder->priority < self->priority) {
+            setPriority(q->holder, self->priority);
+        }
+
+        if (!blockCurrent(lock, &q->waitingToReceive, left) && q->isMutex) {
+            disinheritAfterTimeout(q);
+        }
+    }
+}
+
+static BaseType_t queueReceiveFromISR(HostQueue* q, void* buffer, BaseType_t* woken, bool peek) {
+    configASSERT(q != nullptr);
+    Lock lock = lockKernel();
+
+    if (q->count == 0) {
+        return errQUEUE_EMPTY;
+    }
+
+    queueCopyOut(q, buffer, peek);
+    if (!peek && wokeHigherPriority(wakeFirst(&q->waitingToSend)) && woken != nullptr) {
+        *woken = pdTRUE;
+    }
+    reschedule(lock, false);
+    return pdPASS;
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t uxQueueLength, UBaseType_t uxItemSize, uint8_t* pucQueueStorage,
+    StaticQueue_t* pxStaticQueue) {
+    return createQueue(uxQueueLength, uxItemSize, pucQueueStorage, pxStaticQueue);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t xQueue, const void* pvItemToQueue, TickType_t xTicksToWait) {
+    return queueSend(xQueue, pvItemToQueue, xTicksToWait, QueuePosition::Back);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t xQueue, const void* pvItemToQueue, TickType_t xTicksToWait) {
+    return queueSend(xQueue, pvItemToQueue, xTicksToWait, QueuePosition::Front);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t xQueue, const void* pvItemToQueue) {
+    configASSERT(xQueue->length == 1);
+    return queueSend(xQueue, pvItemToQueue, 0, QueuePosition::Overwrite);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t xQueue, void* pvBuffer, TickType_t xTicksToWait) {
+    return queueReceive(xQueue, pvBuffer, xTicksToWait, false);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t xQueue, void* pvBuffer, TickType_t xTicksToWait) {
+    return queueReceive(xQueue, pvBuffer, xTicksToWait, true);
+}
+
+BaseType_t xQueueReset(QueueHandle_t xQueue) {
+    Lock lock = lockKernel();
+
+    xQueue->head = 0;
+    xQueue->count = 0;
+    wakeFirst(&xQueue->waitingToSend);
+    reschedule(lock, true);
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t xQueue) {
+    Lock lock = lockKernel();
+    return xQueue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t xQueue) {
+    Lock lock = lockKernel();
+    return xQueue->length - xQueue->count;
+}
+
+BaseType_t xQueueSendToBackFromISR(QueueHandle_t xQueue, const void* pvItemToQueue, BaseType_t* pxHigherPriorityTaskWoken) {
+    return queueSendFromISR(xQueue, pvItemToQueue, pxHigherPriorityTaskWoken, QueuePosition::Back);
+}
+
+BaseType_t xQueueSendToFrontFromISR(QueueHandle_t xQueue, const void* pvItemToQueue, BaseType_t* pxHigherPriorityTaskWoken) {
+    return queueSendFromISR(xQueue, pvItemToQueue, pxHigherPriorityTaskWoken, QueuePosition::Front);
+}
+
+BaseType_t xQueueOverwriteFromISR(QueueHandle_t xQueue, const void* pvItemToQueue, BaseType_t* pxHigherPriorityTaskWoken) {
+    configASSERT(xQueue->length == 1);
+    return queueSendFromISR(xQueue, pvItemToQueue, pxHigherPriorityTaskWoken, QueuePosition::Overwrite);
+}
+
+BaseType_t xQueueReceiveFromISR(QueueHandle_t xQueue, void* pvBuffer, BaseType_t* pxHigherPriorityTaskWoken) {
+    return queueReceiveFromISR(xQueue, pvBuffer, pxHigherPriorityTaskWoken, false);
+}
+
+BaseType_t xQueuePeekFromISR(QueueHandle_t xQueue, void* pvBuffer) {
+    return queueReceiveFromISR(xQueue, pvBuffer, nullptr, true);
+}
+
+UBaseType_t uxQueueMessagesWaitingFromISR(QueueHandle_t xQueue) {
+    return uxQueueMessagesWaiting(xQueue);
+}
+
+// ------------------ Semaphores ------------------
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* pxMutexBuffer) {
+    HostQueue* q = createQueue(1, 0, nullptr, pxMutexBuffer);
+    if (q != nullptr) {
+        q->isMutex = true;
+        q->count = 1;
+    }
+    return q;
+}
+
+SemaphoreHandle_t xQueueCreateCountingSemaphoreStatic(UBaseType_t uxMaxCount, UBaseType_t uxInitialCount,
+    StaticSemaphore_t* pxStaticSemaphore) {
+    HostQueue* q = createQueue(uxMaxCount, 0, nullptr, pxStaticSemaphore);
+    if (q != nullptr) {
+        q->count = uxInitialCount;
+    }
+    return q;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t xSemaphore, TickType_t xBlockTime) {
+    return queueReceive(xSemaphore, nullptr, xBlockTime, false);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t xSemaphore) {
+    if (!xSemaphore->isMutex) {
+        return queueSend(xSemaphore, nullptr, 0, QueuePosition::Back);
+    }
+
+    Lock lock = lockKernel();
+
+    // only the holder can give a mutex back
+    if (xSemaphore->holder != self || self == nullptr) {
+        return pdFAIL;
+    }
+
+    xSemaphore->holder = nullptr;
+    xSemaphore->count = 1;
+    self->mutexesHeld--;
+    if (self->mutexesHeld == 0 && self->priority != self->basePriority) {
+        setPriority(self, self->basePriority);
+    }
+
+    wakeFirst(&xSemaphore->waitingToReceive);
+    reschedule(lock, true);
+    return pdPASS;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t xSemaphore, BaseType_t* pxHigherPriorityTaskWoken) {
+    configASSERT(!xSemaphore->isMutex);
+    return queueSendFromISR(xSemaphore, nullptr, pxHigherPriorityTaskWoken, QueuePosition::Back);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t xSemaphore) {
+    return uxQueueMessagesWaiting(xSemaphore);
+}
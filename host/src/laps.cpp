@@ -0,0 +1,278 @@
+#include "host.hpp"
+#include "host_car.hpp"
+#include "sim/SimBMS.hpp"
+#include "sim/SimDriver.hpp"
+#include "sim/SimInverter.hpp"
+#include "sim/SimVehicle.hpp"
+
+// Flying laps on virtual time, with the car driving the vehicle model through the simulated inverter and drawing from
+// the simulated BMS. A driver follows a recorded pedal trace lap after lap, and each lap reports what the car did on
+// track and what the torque path cost the VCU: the tractive system task's time per cycle, and the power limiter's. The
+// limiter's clamp is commented out in DriveSequence, so it runs here in shadow mode, called every cycle beside the car
+// with its answer compared to what the car asked for. The costs are host time, so they vary between runs and stay out
+// of the checksum.
+
+#define LAPS_COUNT 3
+#define LAPS_PERIOD 10 // ms, as the TS loop
+#define LAPS_MAX_STATS 32
+
+using namespace wrvcu;
+
+static VirtualCANController bmsCan;
+static SimBMS bms;
+static VirtualCANController inverterCan;
+static SimInverter inverterSim;
+static SimVehicle vehicle;
+
+static StaticTask<> probeTask;
+
+/**
+ * @brief A point on the pedal trace, between which the pedals move linearly.
+ *
+ */
+struct TracePoint {
+    uint32_t time; // ms into the lap
+    float throttle;
+    float brake;
+};
+
+// a lap of about a minute, with the throttle off before each brake so the pedals are never both pressed
+static const TracePoint trace[] = {
+    { 0, 1.0f, 0.0f }, // start/finish straight
+    { 8000, 1.0f, 0.0f },
+    { 8100, 0.0f, 0.0f },
+    { 8300, 0.0f, 0.6f }, // hairpin
+    { 10500, 0.0f, 0.6f },
+    { 10800, 0.35f, 0.0f },
+    { 16000, 0.5f, 0.0f },
+    { 18000, 0.8f, 0.0f },
+    { 22000, 0.8f, 0.0f },
+    { 22100, 0.0f, 0.0f },
+    { 22300, 0.0f, 0.4f }, // chicane
+    { 23500, 0.0f, 0.4f },
+    { 23800, 0.3f, 0.0f }, // sweeper
+    { 30000, 0.3f, 0.0f },
+    { 31000, 1.0f, 0.0f }, // back straight
+    { 40000, 1.0f, 0.0f },
+    { 40100, 0.0f, 0.0f },
+    { 40300, 0.0f, 0.7f }, // hairpin
+    { 42500, 0.0f, 0.7f },
+    { 42800, 0.4f, 0.0f },
+    { 48000, 0.6f, 0.0f },
+    { 52000, 0.9f, 0.0f },
+    { 58000, 0.9f, 0.0f },
+    { 58100, 0.0f, 0.0f },
+    { 58300, 0.0f, 0.3f },
+    { 60000, 0.0f, 0.3f },
+};
+
+#define LAPS_TRACE_LENGTH (sizeof(trace) / sizeof(trace[0]))
+#define LAPS_LAP_LENGTH (trace[LAPS_TRACE_LENGTH - 1].time)
+
+/**
+ * @brief The pedals at a point in the lap.
+ *
+ * @param t ms into the lap
+ */
+static DriverInputs tracePedals(uint32_t t) {
+    DriverInputs inputs;
+
+    for (size_t i = 1; i < LAPS_TRACE_LENGTH; i++) {
+        const TracePoint& a = trace[i - 1];
+        const TracePoint& b = trace[i];
+        if (t < b.time) {
+            float k = (float)(t - a.time) / (b.time - a.time);
+            inputs.throttle = a.throttle + (b.throttle - a.throttle) * k;
+            inputs.brake = a.brake + (b.brake - a.brake) * k;
+            return inputs;
+        }
+    }
+
+    inputs.throttle = trace[LAPS_TRACE_LENGTH - 1].throttle;
+    inputs.brake = trace[LAPS_TRACE_LENGTH - 1].brake;
+    return inputs;
+}
+
+struct LapResult {
+    float distance = 0;          // m
+    float topSpeed = 0;          // m/s
+    float energy = 0;            // Wh, out of the pack
+    float peakPower = 0;         // W, out of the pack
+    float minPackVoltage = 1000; // V
+    float minDriveLimit = 1000;  // Nm
+    uint32_t cycles = 0;
+    uint32_t limitedCycles = 0;  // where the drive limit was below the car's request
+    uint32_t overLimitTime = 0;  // ms, drawing more than the BMS allows
+    uint32_t tsRun_us = 0;       // the tractive system task's time running
+    uint32_t tsMaxRun_us = 0;    // its longest single run
+    uint32_t adcReads = 0;       // channel reads over SPI, by every task
+    uint64_t limiterCycles = 0;  // DWT cycles in both limiters, all lap
+    uint32_t limiterMaxCycles = 0;
+};
+
+static LapResult results[LAPS_COUNT];
+
+/**
+ * @brief Get the tractive system task's run time since the last sample.
+ *
+ */
+static TaskRunStats sampleTractiveSystem() {
+    TaskRunStats stats[LAPS_MAX_STATS];
+    int n = Task::sample_run_stats(stats, LAPS_MAX_STATS);
+
+    for (int i = 0; i < n; i++) {
+        // the kernel keeps only the start of a task's name
+        if (strncmp(stats[i].name, "TractiveSystem_Task", configMAX_TASK_NAME_LEN - 1) == 0) {
+            return stats[i];
+        }
+    }
+
+    printf("WARNING: The tractive system task wasn't in the run stats!\n");
+    return TaskRunStats {};
+}
+
+/**
+ * @brief Drive one lap, calling the power limiter every cycle and recording the lap.
+ *
+ * @param prev The probe's last wake time, advanced through the lap
+ */
+static void runLap(LapResult& result, uint32_t* prev) {
+    float startDistance = vehicle.getDistance();
+    uint32_t start = *prev;
+    uint32_t adcStart = hostGetADCReads();
+
+    sampleTractiveSystem();
+
+    while (*prev - start < LAPS_LAP_LENGTH) {
+        applyDriverInputs(tracePedals(*prev - start), &vehicle);
+
+        uint32_t before = ARM_DWT_CYCCNT;
+        float driveLimit = ts.calculateMaxDriveTorque();
+        ts.calculateMaxRegenTorque();
+        uint32_t cost = ARM_DWT_CYCCNT - before;
+
+        result.limiterCycles += cost;
+        result.limiterMaxCycles = std::max(result.limiterMaxCycles, cost);
+
+        // Inverter's polarity sends forward torque negative
+        float request = -inverterSim.getTorqueCommand() * INVERTER_NM_PER_UNIT;
+        if (driveLimit < request) {
+            result.limitedCycles++;
+        }
+        result.minDriveLimit = std::min(result.minDriveLimit, driveLimit);
+
+        float packVoltage = bms.getPackVoltage();
+        float power = packVoltage * bms.terminalCurrent;
+        result.energy += power * LAPS_PERIOD / 3600000.0f;
+        result.peakPower = std::max(result.peakPower, power);
+        result.minPackVoltage = std::min(result.minPackVoltage, packVoltage);
+        if (bms.terminalCurrent > SIM_BMS_MAX_DISCHARGE) {
+            result.overLimitTime += LAPS_PERIOD;
+        }
+
+        result.topSpeed = std::max(result.topSpeed, vehicle.getSpeed());
+        result.cycles++;
+
+        if (ts.getState() != TSStates::Driving) {
+            printf("WARNING: The car stopped driving, it's in %s!\n", tsStateName(ts.getState()));
+        }
+
+        Task::delay_until(prev, LAPS_PERIOD);
+    }
+
+    TaskRunStats stats = sampleTractiveSystem();
+    result.tsRun_us = stats.run_us;
+    result.tsMaxRun_us = stats.maxRun_us;
+    result.distance = vehicle.getDistance() - startDistance;
+    result.adcReads = hostGetADCReads() - adcStart;
+}
+
+// FNV-1a
+static uint32_t checksum(uint32_t hash, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        hash = (hash ^ ((value >> (8 * i)) & 0xff)) * 16777619u;
+    }
+    return hash;
+}
+
+static void report() {
+    uint32_t cyclesPerMicro = F_CPU_ACTUAL / 1000000;
+    uint32_t hash = 2166136261u;
+
+    printf("\n     Distance  Top     Energy  Peak    Min     Min drive  Limited  Over   TS per  TS max  ADC reads  Limiter (ns)\n");
+    printf("Lap  (m)       (km/h)  (Wh)    (kW)    pack V  limit Nm   cycles   (ms)   cycle   run     per cycle  avg    max\n");
+
+    for (int i = 0; i < LAPS_COUNT; i++) {
+        const LapResult& result = results[i];
+        uint32_t tsCycles = LAPS_LAP_LENGTH / LAPS_PERIOD;
+
+        printf("%-4d %-9.0f %-7.1f %-7.1f %-7.1f %-7.1f %-10.1f %4.1f%%    %-6lu %-7.1f %-7lu %-10.1f %-6lu %lu\n", i + 1,
+            result.distance, result.topSpeed * 3.6, result.energy, result.peakPower / 1000, result.minPackVoltage,
+            result.minDriveLimit, result.cycles > 0 ? 100.0 * result.limitedCycles / result.cycles : 0.0,
+            (unsigned long)result.overLimitTime, (double)result.tsRun_us / tsCycles, (unsigned long)result.tsMaxRun_us,
+            (double)result.adcReads / tsCycles,
+            (unsigned long)(result.cycles > 0 ? result.limiterCycles * 1000 / cyclesPerMicro / result.cycles : 0),
+            (unsigned long)(result.limiterMaxCycles * 1000 / cyclesPerMicro));
+
+        hash = checksum(hash, (uint32_t)result.distance);
+        hash = checksum(hash, (uint32_t)result.energy);
+        hash = checksum(hash, result.limitedCycles);
+        hash = checksum(hash, result.overLimitTime);
+        hash = checksum(hash, result.adcReads);
+    }
+
+    printf("TS per cycle and TS max run are in us of host time, over %d ms cycles\n", LAPS_PERIOD);
+    printf("Inverter: %lu faults, battery: %.1f%% charge left\n", (unsigned long)inverterSim.getFaults(), bms.getSoC());
+    printf("Checksum: %08lx\n", (unsigned long)hash);
+}
+
+/**
+ * @brief Start the car up, drive the laps, then end the scheduler.
+ *
+ */
+void laps_probe() {
+    uint32_t start = Task::millis();
+    uint32_t prev = start;
+
+    while (prev - start < SIM_DRIVER_READY) {
+        applyDriverInputs(driverStartUp(prev - start), &vehicle);
+        Task::delay_until(&prev, LAPS_PERIOD);
+    }
+
+    if (ts.getState() != TSStates::Driving) {
+        printf("WARNING: The car isn't driving after start up, it's in %s!\n", tsStateName(ts.getState()));
+    }
+
+    for (int i = 0; i < LAPS_COUNT; i++) {
+        printf("Lap %d\n", i + 1);
+        runLap(results[i], &prev);
+    }
+
+    report();
+    vTaskEndScheduler();
+}
+
+/**
+ * @brief Run the laps on virtual time, whatever the command line asks for.
+ *
+ */
+void host_laps() {
+    hostUseVirtualTime();
+    hostRunFor(0);
+
+    applyDriverInputs(driverStartUp(0), &vehicle);
+
+    powertrainBus.attach(&bmsCan);
+    powertrainBus.attach(&inverterCan);
+    hostCarInit();
+
+    bmsCan.init(CAN_TASK_PRIORITY);
+    inverterCan.init(CAN_TASK_PRIORITY);
+    bms.init(&bmsCan, TASK_PRIORITY_DEFAULT + 1);
+    inverterSim.init(&inverterCan, 1, TASK_PRIORITY_DEFAULT + 1, &vehicle, &bms);
+
+    // above the car's tasks, so the pedals are in place before anything reads them on that tick
+    probeTask.start(laps_probe, TASK_PRIORITY_DEFAULT + 3, "Probe_Task");
+
+    startScheduler();
+}
@@ -0,0 +1,88 @@
+#include "Arduino.h"
+#include "host.hpp"
+
+// Runs the car, or one of the src/test_*.cpp harnesses, on the host:
+//   program [harness] [--duration ms] [--virtual] [--sd directory]
+
+#define HOST_DEFAULT_DURATION 10000 // ms
+
+void host_car();
+void host_endurance();
+void host_laps();
+void host_powertrain();
+
+void test_rtos();
+void test_can_dispatch();
+void test_can_gateway();
+void test_virtual_can();
+void test_can_replay();
+void test_dbc_codec();
+void test_queue_batch();
+void test_spsc_queue();
+void test_task_alloc();
+void test_logging();
+
+struct Harness {
+    const char* name;
+    void (*run)();
+};
+
+static const Harness harnesses[] = {
+    { "car", host_car },
+    { "endurance", host_endurance },
+    { "laps", host_laps },
+    { "powertrain", host_powertrain },
+    { "rtos", test_rtos },
+    { "can_dispatch", test_can_dispatch },
+    { "can_gateway", test_can_gateway },
+    { "virtual_can", test_virtual_can },
+    { "can_replay", test_can_replay },
+    { "dbc_codec", test_dbc_codec },
+    { "queue_batch", test_queue_batch },
+    { "spsc_queue", test_spsc_queue },
+    { "task_alloc", test_task_alloc },
+    { "logging", test_logging },
+};
+
+static void usage(const char* program) {
+    printf("usage: %s [harness] [--duration ms] [--virtual] [--sd directory]\n", program);
+    printf("  --duration  run time, 0 to run until the scheduler is ended (default %d)\n", HOST_DEFAULT_DURATION);
+    printf("  --virtual   run on virtual time, as fast as the host can and the same every run\n");
+    printf("  --sd        directory to use as the SD card (default none)\n");
+    printf("harnesses:");
+    for (const Harness& harness : harnesses) {
+        printf(" %s", harness.name);
+    }
+    printf("\n");
+}
+
+int main(int argc, char** argv) {
+    const char* name = "car";
+    uint32_t duration = HOST_DEFAULT_DURATION;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+            duration = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--virtual") == 0) {
+            hostUseVirtualTime();
+        } else if (strcmp(argv[i], "--sd") == 0 && i + 1 < argc) {
+            hostSetSDRoot(argv[++i]);
+        } else if (argv[i][0] != '-') {
+            name = argv[i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    for (const Harness& harness : harnesses) {
+        if (strcmp(harness.name, name) == 0) {
+            hostRunFor(duration);
+            harness.run();
+            return 0;
+        }
+    }
+
+    usage(argv[0]);
+    return 2;
+}
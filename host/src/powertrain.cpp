@@ -0,0 +1,252 @@
+#include "can/CANStats.hpp"
+#include "host.hpp"
+#include "host_car.hpp"
+#include "sim/SimBMS.hpp"
+#include "sim/SimDriver.hpp"
+#include "sim/SimInverter.hpp"
+#include "sim/SimVehicle.hpp"
+
+// Closed-loop latencies across the powertrain bus, on virtual time. A simulated BMS and inverter sit on the bus with the
+// car, a driver starts the tractive system, and then steps the throttle while filler frames load the bus harder phase
+// by phase. Each phase reports how long the car takes to act on what the other nodes send and how they see the car's
+// commands, along with what the load cost in dropped frames and inverter faults.
+
+#define POWERTRAIN_PHASE_LENGTH 10000 // ms
+#define POWERTRAIN_STEP_PERIOD 503    // ms between throttle steps, so they land all through the 10 ms TS cycle
+#define POWERTRAIN_THROTTLE_LOW 0.3f  // fraction of pedal travel
+#define POWERTRAIN_THROTTLE_HIGH 0.6f // fraction of pedal travel
+#define POWERTRAIN_POLL_PERIOD 1      // ms
+#define POWERTRAIN_SHUTDOWN 2000      // ms, after opening the SDC, for the BMS to go back to Ready
+
+using namespace wrvcu;
+
+static VirtualCANController bmsCan;
+static SimBMS bms;
+static VirtualCANController inverterCan;
+static SimInverter inverterSim;
+static SimVehicle vehicle;
+
+static StaticTask<> probeTask;
+
+/**
+ * @brief A background load on the bus, with the ID its filler frames are sent with.
+ *
+ */
+struct LoadPhase {
+    float load;
+    uint16_t id;
+};
+
+// Filler at 0x7ff loses arbitration to everything, so the car's frames only ever wait for the frame on the bus. At 0x001
+// it wins, and takes the bus from the car.
+static const LoadPhase phases[] = {
+    { 0.0f, 0x7ff },
+    { 0.5f, 0x7ff },
+    { 0.8f, 0x7ff },
+    { 0.95f, 0x7ff },
+    { 1.0f, 0x7ff },
+    { 0.5f, 0x001 },
+    { 0.8f, 0x001 },
+};
+
+#define POWERTRAIN_NUM_PHASES (sizeof(phases) / sizeof(phases[0]))
+
+struct PhaseResult {
+    CANLatencyStats torque; // throttle step to the torque command reaching the inverter
+    CANLatencyStats rpm;    // TPDO4 sent to Inverter's rpm changing
+    float busLoad = 0;
+    uint32_t txDropped = 0;
+    uint32_t rxDropped = 0;
+    uint32_t inverterFaults = 0;
+    bool stayedDriving = true;
+};
+
+static PhaseResult results[POWERTRAIN_NUM_PHASES];
+
+// BMS status to Battery's contactorState, through start up and shut down
+static CANLatencyStats statusLatency;
+
+/**
+ * @brief Watches for the car catching up with the BMS's status, polled with the rest of the probe.
+ *
+ */
+struct StatusWatch {
+    uint32_t lastChange_us = 0;
+    bool pending = false;
+
+    void poll(uint32_t now_us) {
+        uint32_t change_us = bms.getStateChangeTime();
+        if (change_us != lastChange_us) {
+            lastChange_us = change_us;
+            pending = true;
+        }
+
+        if (pending && battery.contactorState == bms.getState()) {
+            statusLatency.add(now_us - change_us);
+            pending = false;
+        }
+    }
+};
+
+static StatusWatch statusWatch;
+
+static uint32_t txDropped() {
+    return can1.get_tx_dropped() + bmsCan.get_tx_dropped() + inverterCan.get_tx_dropped();
+}
+
+static uint32_t rxDropped() {
+    return can1.get_rx_counters().dropped + bmsCan.get_rx_counters().dropped + inverterCan.get_rx_counters().dropped;
+}
+
+/**
+ * @brief Run one phase, stepping the throttle between two positions and timing each hop across the bus.
+ *
+ * @param prev The probe's last wake time, advanced through the phase
+ */
+static void runPhase(LoadPhase const& phase, PhaseResult& result, uint32_t* prev) {
+    powertrainBus.setBackgroundLoad(phase.load, phase.id);
+
+    VirtualCANBusStats busStart = powertrainBus.getStats();
+    uint32_t txStart = txDropped();
+    uint32_t rxStart = rxDropped();
+    uint32_t faultsStart = inverterSim.getFaults();
+
+    uint32_t start = *prev;
+    uint32_t step_us = 0;
+    int16_t stepFrom = inverterSim.getTorqueCommand();
+    bool torquePending = false;
+    int32_t lastRPM = inverter.rpm;
+
+    DriverInputs inputs;
+
+    while (*prev - start < POWERTRAIN_PHASE_LENGTH) {
+        uint32_t t = *prev - start;
+        uint32_t now_us = (uint32_t)hostMicros();
+
+        if (t % POWERTRAIN_STEP_PERIOD == 0) {
+            bool high = (t / POWERTRAIN_STEP_PERIOD) % 2 == 0;
+            inputs.throttle = high ? POWERTRAIN_THROTTLE_HIGH : POWERTRAIN_THROTTLE_LOW;
+            applyDriverInputs(inputs);
+
+            step_us = now_us;
+            stepFrom = inverterSim.getTorqueCommand();
+            torquePending = true;
+        }
+
+        // the inverter timestamps each command as it arrives, so this latency is exact
+        uint32_t rx_us;
+        int16_t command = inverterSim.getTorqueCommand(&rx_us);
+        if (torquePending && command != stepFrom && (int32_t)(rx_us - step_us) >= 0) {
+            result.torque.add(rx_us - step_us);
+            torquePending = false;
+        }
+
+        // Inverter's rpm is only seen when it's polled, so this latency is to the next poll
+        if (inverter.rpm != lastRPM) {
+            uint32_t tx_us;
+            if (inverter.rpm == inverterSim.getSentRPM(&tx_us)) {
+                result.rpm.add(now_us - tx_us);
+            }
+            lastRPM = inverter.rpm;
+        }
+
+        statusWatch.poll(now_us);
+        if (ts.getState() != TSStates::Driving) {
+            result.stayedDriving = false;
+        }
+
+        Task::delay_until(prev, POWERTRAIN_POLL_PERIOD);
+    }
+
+    VirtualCANBusStats busEnd = powertrainBus.getStats();
+    uint64_t busTime_us = busEnd.busTime_us - busStart.busTime_us;
+    if (busTime_us > 0) {
+        result.busLoad = (float)(busEnd.bits - busStart.bits) * 1000000 / powertrainBus.getBitRate() / busTime_us;
+    }
+    result.txDropped = txDropped() - txStart;
+    result.rxDropped = rxDropped() - rxStart;
+    result.inverterFaults = inverterSim.getFaults() - faultsStart;
+}
+
+static void report() {
+    printf("\nBMS status to Battery: %lu changes, min %lu us, avg %lu us, max %lu us\n", (unsigned long)statusLatency.count,
+        (unsigned long)(statusLatency.count > 0 ? statusLatency.min_us : 0), (unsigned long)statusLatency.avg_us(),
+        (unsigned long)statusLatency.max_us);
+
+    printf("\nFiller         Bus    Throttle to RPDO1 (us)    TPDO4 to Inverter (us)    TX     RX     Inverter  Stayed\n");
+    printf("load   ID     load   min    avg    max        min    avg    max        drops  drops  faults    driving\n");
+
+    for (size_t i = 0; i < POWERTRAIN_NUM_PHASES; i++) {
+        const PhaseResult& result = results[i];
+        printf("%4.0f%%  0x%03x  %4.0f%%  %-6lu %-6lu %-10lu %-6lu %-6lu %-10lu %-6lu %-6lu %-9lu %s\n",
+            phases[i].load * 100, phases[i].id, result.busLoad * 100,
+            (unsigned long)(result.torque.count > 0 ? result.torque.min_us : 0), (unsigned long)result.torque.avg_us(),
+            (unsigned long)result.torque.max_us, (unsigned long)(result.rpm.count > 0 ? result.rpm.min_us : 0),
+            (unsigned long)result.rpm.avg_us(), (unsigned long)result.rpm.max_us, (unsigned long)result.txDropped,
+            (unsigned long)result.rxDropped, (unsigned long)result.inverterFaults, result.stayedDriving ? "yes" : "no");
+    }
+}
+
+/**
+ * @brief Start the car up, run each phase in turn, then shut down and end the scheduler.
+ *
+ */
+void powertrain_probe() {
+    uint32_t start = Task::millis();
+    uint32_t prev = start;
+
+    while (prev - start < SIM_DRIVER_READY) {
+        applyDriverInputs(driverStartUp(prev - start));
+        statusWatch.poll((uint32_t)hostMicros());
+        Task::delay_until(&prev, POWERTRAIN_POLL_PERIOD);
+    }
+
+    if (ts.getState() != TSStates::Driving) {
+        printf("WARNING: The car isn't driving after start up, it's in %s!\n", tsStateName(ts.getState()));
+    }
+
+    for (size_t i = 0; i < POWERTRAIN_NUM_PHASES; i++) {
+        printf("Phase %d: %.0f%% filler at 0x%03x\n", (int)i + 1, phases[i].load * 100, phases[i].id);
+        runPhase(phases[i], results[i], &prev);
+    }
+
+    powertrainBus.setBackgroundLoad(0, 0x7ff);
+
+    DriverInputs inputs;
+    inputs.sdcClosed = false;
+    applyDriverInputs(inputs);
+
+    uint32_t shutdown = prev;
+    while (prev - shutdown < POWERTRAIN_SHUTDOWN) {
+        statusWatch.poll((uint32_t)hostMicros());
+        Task::delay_until(&prev, POWERTRAIN_POLL_PERIOD);
+    }
+
+    report();
+    vTaskEndScheduler();
+}
+
+/**
+ * @brief Run the powertrain latency phases on virtual time, whatever the command line asks for.
+ *
+ */
+void host_powertrain() {
+    hostUseVirtualTime();
+    hostRunFor(0);
+
+    applyDriverInputs(driverStartUp(0));
+
+    powertrainBus.attach(&bmsCan);
+    powertrainBus.attach(&inverterCan);
+    hostCarInit();
+
+    bmsCan.init(CAN_TASK_PRIORITY);
+    inverterCan.init(CAN_TASK_PRIORITY);
+    bms.init(&bmsCan, TASK_PRIORITY_DEFAULT + 1);
+    inverterSim.init(&inverterCan, 1, TASK_PRIORITY_DEFAULT + 1, &vehicle, &bms);
+
+    // above the car's tasks, so a throttle step is in place before anything reads it on that tick
+    probeTask.start(powertrain_probe, TASK_PRIORITY_DEFAULT + 3, "Probe_Task");
+
+    startScheduler();
+}
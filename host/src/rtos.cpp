@@ -0,0 +1,59 @@
+#include "host.hpp"
+#include "rtos/rtos.hpp"
+#include <pthread.h>
+
+namespace wrvcu {
+
+void startScheduler() {
+    Serial.println(PSTR("\r\nBooting FreeRTOS kernel " tskKERNEL_VERSION_NUMBER ". Built by gcc " __VERSION__ " on " __DATE__ ". ***\r\n"));
+
+    vTaskStartScheduler();
+
+    Serial.println("Scheduler returned.");
+    Serial.flush();
+};
+
+void delayMicros(uint32_t us) {
+    hostDelayUntilMicros(hostMicros() + us);
+}
+
+struct StackBounds {
+    char* low;
+    char* high;
+};
+
+static StackBounds getStackBounds() {
+    StackBounds bounds = { nullptr, nullptr };
+
+    pthread_attr_t attr;
+    if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+        void* stack;
+        size_t size;
+        pthread_attr_getstack(&attr, &stack, &size);
+        pthread_attr_destroy(&attr);
+
+        bounds.low = (char*)stack;
+        bounds.high = bounds.low + size;
+    }
+    return bounds;
+}
+
+// Looked up once per thread, as glibc reads /proc to find the main thread's stack, which allocates. The main thread's
+// is looked up before main, so that starting tasks never touches the heap.
+static thread_local StackBounds stackBounds = getStackBounds();
+[[maybe_unused]] static const StackBounds mainStackBounds = stackBounds;
+
+/**
+ * @brief Check whether a pointer is on the stack.
+ *
+ * On the host every task has its own thread, so this checks the calling thread's stack.
+ *
+ * @param ptr
+ * @return true
+ * @return false
+ */
+bool isOnStack(void* ptr) {
+    return (char*)ptr >= stackBounds.low && (char*)ptr < stackBounds.high;
+}
+
+} // namespace wrvcu
@@ -0,0 +1,220 @@
+#include "sim/SimBMS.hpp"
+#include "battery.h"
+#include "host.hpp"
+#include "pins.hpp"
+#include "rtos/task.hpp"
+#include <algorithm>
+
+namespace wrvcu {
+
+void SimBMS::init(AbstractCANController* ican, uint32_t task_priority) {
+    can = ican;
+
+    rxQueue.init();
+    can->subscribe(SIM_BMS_WAKE_ID, &rxQueue);
+
+    task.start(
+        [this] { loop(); }, task_priority, "SimBMS_Task");
+}
+
+void SimBMS::loop() {
+    uint32_t prev = Task::millis();
+    uint32_t lastFrames = prev;
+    uint32_t lastTemperature = prev;
+
+    while (true) {
+        CANMessage msg;
+        while (rxQueue.dequeue(msg, 0)) {
+            if (msg.id == SIM_BMS_WAKE_ID && state == ContactorStates::Init) {
+                setState(ContactorStates::Ready);
+            }
+        }
+
+        updateState();
+        step(SIM_BMS_STEP / 1000.0f);
+
+        // an asleep BMS says nothing
+        uint32_t now = Task::millis();
+        if (state != ContactorStates::Init && now - lastFrames >= SIM_BMS_PERIOD) {
+            bool sendTemperature = now - lastTemperature >= SIM_BMS_IVT_T_PERIOD;
+            sendFrames(sendTemperature);
+
+            lastFrames = now;
+            if (sendTemperature) {
+                lastTemperature = now;
+            }
+        }
+
+        Task::delay_until(&prev, SIM_BMS_STEP);
+    }
+}
+
+void SimBMS::setState(ContactorStates newState) {
+    if (newState != state) {
+        state = newState;
+        stateChange_us = (uint32_t)hostMicros();
+    }
+}
+
+void SimBMS::updateState() {
+    bool ignition = hostGetPin(BMS_IGNITION_PIN) == HIGH;
+
+    if (fault && state != ContactorStates::Init) {
+        setState(ContactorStates::Error);
+        return;
+    }
+
+    switch (state) {
+    case ContactorStates::Ready:
+        if (ignition) {
+            setState(ContactorStates::AwaitActive);
+            prechargeStart = Task::millis();
+        }
+        break;
+
+    case ContactorStates::AwaitActive:
+        if (!ignition) {
+            setState(ContactorStates::Ready);
+        } else if (linkVoltage >= SIM_BMS_PRECHARGE_DONE * getPackVoltage()) {
+            setState(ContactorStates::Active);
+        } else if (Task::millis() - prechargeStart > SIM_BMS_PRECHARGE_TIMEOUT) {
+            setState(ContactorStates::Error);
+        }
+        break;
+
+    case ContactorStates::Active:
+        if (!ignition) {
+            setState(ContactorStates::Ready);
+        }
+        break;
+
+    case ContactorStates::Error:
+        // the n-BMS needs the ignition cycled to clear an error
+        if (!fault && !ignition) {
+            setState(ContactorStates::Ready);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+void SimBMS::step(float dt) {
+    float packVoltage = getPackVoltage();
+
+    // precharge charges the DC link through a resistor, and it discharges once the contactors open
+    if (state == ContactorStates::AwaitActive) {
+        linkVoltage += (packVoltage - linkVoltage) * dt * 1000 / SIM_BMS_PRECHARGE_TAU;
+    } else if (state == ContactorStates::Active) {
+        linkVoltage = packVoltage;
+    } else {
+        linkVoltage -= linkVoltage * dt * 1000 / SIM_BMS_DISCHARGE_TAU;
+    }
+
+    if (state != ContactorStates::Active) {
+        terminalCurrent = 0;
+    }
+    chargeUsed += terminalCurrent * dt / 3600;
+}
+
+void SimBMS::sendFrames(bool sendTemperature) {
+    uint8_t data[8];
+
+    battery_bms_batt_status_t status;
+    status.v_sum_of_cells = battery_bms_batt_status_v_sum_of_cells_encode(getPackVoltage());
+    status.so_c = battery_bms_batt_status_so_c_encode(getSoC());
+    status.q_remain_nom = battery_bms_batt_status_q_remain_nom_encode(getSoC() * SIM_BMS_CAPACITY / 100);
+    status.status = (uint8_t)state;
+    battery_bms_batt_status_pack(data, &status, 8);
+    send(BATTERY_BMS_BATT_STATUS_FRAME_ID, BATTERY_BMS_BATT_STATUS_LENGTH, data);
+
+    float cellVoltage = getPackVoltage() / SIM_BMS_CELLS;
+    battery_bms_cell_status_voltages_t voltages;
+    voltages.min_cell_voltage = battery_bms_cell_status_voltages_min_cell_voltage_encode(cellVoltage * 1000 - 10);
+    voltages.max_cell_voltage = battery_bms_cell_status_voltages_max_cell_voltage_encode(cellVoltage * 1000 + 10);
+    voltages.avg_cell_voltage = battery_bms_cell_status_voltages_avg_cell_voltage_encode(cellVoltage * 1000);
+    battery_bms_cell_status_voltages_pack(data, &voltages, 8);
+    send(BATTERY_BMS_CELL_STATUS_VOLTAGES_FRAME_ID, BATTERY_BMS_CELL_STATUS_VOLTAGES_LENGTH, data);
+
+    battery_bms_cell_status_temperatures_t temperatures;
+    temperatures.min_cell_temp = battery_bms_cell_status_temperatures_min_cell_temp_encode(cellTemp - 1);
+    temperatures.max_cell_temp = battery_bms_cell_status_temperatures_max_cell_temp_encode(cellTemp + 1);
+    temperatures.avg_cell_temp = battery_bms_cell_status_temperatures_avg_cell_temp_encode(cellTemp);
+    battery_bms_cell_status_temperatures_pack(data, &temperatures, 8);
+    send(BATTERY_BMS_CELL_STATUS_TEMPERATURES_FRAME_ID, BATTERY_BMS_CELL_STATUS_TEMPERATURES_LENGTH, data);
+
+    battery_bms_avail_current_t current;
+    current.max_discharge = battery_bms_avail_current_max_discharge_encode(SIM_BMS_MAX_DISCHARGE);
+    current.max_charge = battery_bms_avail_current_max_charge_encode(SIM_BMS_MAX_CHARGE);
+    battery_bms_avail_current_pack(data, &current, 8);
+    send(BATTERY_BMS_AVAIL_CURRENT_FRAME_ID, BATTERY_BMS_AVAIL_CURRENT_LENGTH, data);
+
+    battery_imd_info_t imd;
+    imd.imd_vifc_status = battery_imd_info_imd_vifc_status_encode(0);
+    imd.imd_imc_status = battery_imd_info_imd_imc_status_encode(0);
+    imd.imd_r_iso = battery_imd_info_imd_r_iso_encode(isolation);
+    battery_imd_info_pack(data, &imd, 8);
+    send(BATTERY_IMD_INFO_FRAME_ID, BATTERY_IMD_INFO_LENGTH, data);
+
+    // the IVT counts current into the pack as positive, so driving is negative, as TractiveSystem expects
+    battery_ivt_msg_result_i_t i = { battery_ivt_msg_result_i_ivt_result_i_encode(-terminalCurrent) };
+    battery_ivt_msg_result_i_pack(data, &i, 8);
+    send(BATTERY_IVT_MSG_RESULT_I_FRAME_ID, BATTERY_IVT_MSG_RESULT_I_LENGTH, data);
+
+    battery_ivt_msg_result_u1_t u1 = { battery_ivt_msg_result_u1_ivt_result_u1_encode(getPackVoltage()) };
+    battery_ivt_msg_result_u1_pack(data, &u1, 8);
+    send(BATTERY_IVT_MSG_RESULT_U1_FRAME_ID, BATTERY_IVT_MSG_RESULT_U1_LENGTH, data);
+
+    battery_ivt_msg_result_u2_t u2 = { battery_ivt_msg_result_u2_ivt_result_u2_encode(linkVoltage) };
+    battery_ivt_msg_result_u2_pack(data, &u2, 8);
+    send(BATTERY_IVT_MSG_RESULT_U2_FRAME_ID, BATTERY_IVT_MSG_RESULT_U2_LENGTH, data);
+
+    battery_ivt_msg_result_u3_t u3 = { battery_ivt_msg_result_u3_ivt_result_u3_encode(linkVoltage) };
+    battery_ivt_msg_result_u3_pack(data, &u3, 8);
+    send(BATTERY_IVT_MSG_RESULT_U3_FRAME_ID, BATTERY_IVT_MSG_RESULT_U3_LENGTH, data);
+
+    battery_ivt_msg_result_w_t w = { battery_ivt_msg_result_w_ivt_result_w_encode(getPackVoltage() * -terminalCurrent) };
+    battery_ivt_msg_result_w_pack(data, &w, 8);
+    send(BATTERY_IVT_MSG_RESULT_W_FRAME_ID, BATTERY_IVT_MSG_RESULT_W_LENGTH, data);
+
+    if (sendTemperature) {
+        battery_ivt_msg_result_t_t t = { battery_ivt_msg_result_t_ivt_result_t_encode(cellTemp) };
+        battery_ivt_msg_result_t_pack(data, &t, 8);
+        send(BATTERY_IVT_MSG_RESULT_T_FRAME_ID, BATTERY_IVT_MSG_RESULT_T_LENGTH, data);
+    }
+}
+
+void SimBMS::send(uint32_t id, uint8_t len, const uint8_t* data) {
+    CANMessage msg;
+    msg.id = id;
+    msg.len = len;
+    memcpy(msg.data, data, len);
+    can->send(msg);
+}
+
+ContactorStates SimBMS::getState() {
+    return state;
+}
+
+uint32_t SimBMS::getStateChangeTime() {
+    return stateChange_us;
+}
+
+float SimBMS::getCellVoltage() {
+    return SIM_BMS_CELL_EMPTY + (SIM_BMS_CELL_FULL - SIM_BMS_CELL_EMPTY) * getSoC() / 100;
+}
+
+float SimBMS::getPackVoltage() {
+    return SIM_BMS_CELLS * (getCellVoltage() - terminalCurrent * SIM_BMS_CELL_RESISTANCE);
+}
+
+float SimBMS::getLinkVoltage() {
+    return linkVoltage;
+}
+
+float SimBMS::getSoC() {
+    return std::clamp(initialSoC - 100 * chargeUsed / SIM_BMS_CAPACITY, 0.0f, 100.0f);
+}
+
+}
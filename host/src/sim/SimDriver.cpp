@@ -0,0 +1,76 @@
+#include "sim/SimDriver.hpp"
+#include "constants.hpp"
+#include "host.hpp"
+#include "pins.hpp"
+#include <algorithm>
+
+namespace wrvcu {
+
+/**
+ * @brief The ADC counts an APPS sensor reads with its pedal pressed a fraction of its travel, APPS's sums backwards.
+ *
+ */
+static uint16_t appsCounts(float fraction, float angleOffset, float angleRange) {
+    float processedAngle = fraction * (1 - APPS_IGNORE_FRACTION) * angleRange;
+    float angle = processedAngle + angleOffset + angleRange * APPS_IGNORE_FRACTION;
+    float voltage = angle * abs(APPS_END_FRACTION - APPS_START_FRACTION) * APPS_MAX_VOLTAGE / APPS_MAX_ANGLE + APPS_START_FRACTION * APPS_MAX_VOLTAGE;
+    return (uint16_t)lroundf(voltage * ADC_RESOLUTION / APPS_MAX_VOLTAGE);
+}
+
+/**
+ * @brief The ADC counts a brake pressure sensor reads with a fraction of full pressure.
+ *
+ */
+static uint16_t brakeCounts(float fraction, uint16_t averageStart, uint16_t range) {
+    return (uint16_t)lroundf(averageStart + std::clamp(fraction, 0.0f, 1.0f) * range);
+}
+
+void applyDriverInputs(DriverInputs const& inputs, SimVehicle* vehicle) {
+    hostSetPin(SCMON_PIN, inputs.sdcClosed ? HIGH : LOW);
+    hostSetPin(TSAS_PIN, inputs.tsas ? HIGH : LOW);
+    hostSetPin(START_BUTTON_PIN, inputs.start ? HIGH : LOW);
+
+    hostSetADC(APPS1_CHANNEL, appsCounts(inputs.throttle, APPS1_ANGLE_OFFSET, APPS1_ANGLE_RANGE));
+    hostSetADC(APPS2_CHANNEL, appsCounts(inputs.throttle, APPS2_ANGLE_OFFSET, APPS2_ANGLE_RANGE));
+    hostSetADC(BRAKEPRESSURE1_CHANNEL, brakeCounts(inputs.brake, BRAKEPRESSURE1_AVERAGE_START, BRAKEPRESSURE1_RANGE));
+    hostSetADC(BRAKEPRESSURE2_CHANNEL, brakeCounts(inputs.brake, BRAKEPRESSURE2_AVERAGE_START, BRAKEPRESSURE2_RANGE));
+
+    if (vehicle != nullptr) {
+        vehicle->brake = inputs.brake;
+    }
+}
+
+DriverInputs driverStartUp(uint32_t t) {
+    DriverInputs inputs;
+
+    if (t >= 1000 && t < 1500) {
+        inputs.tsas = true;
+    } else if (t >= 5000 && t < 6000) {
+        inputs.brake = SIM_DRIVER_START_BRAKE;
+        inputs.start = t < 5500;
+    }
+
+    return inputs;
+}
+
+const char* tsStateName(TSStates state) {
+    switch (state) {
+    case TSStates::Error:
+        return "Error";
+    case TSStates::Idle:
+        return "Idle";
+    case TSStates::CloseContactors:
+        return "CloseContactors";
+    case TSStates::WaitR2D:
+        return "WaitR2D";
+    case TSStates::StartInverter:
+        return "StartInverter";
+    case TSStates::Buzzer:
+        return "Buzzer";
+    case TSStates::Driving:
+        return "Driving";
+    }
+    return "?";
+}
+
+}
@@ -0,0 +1,282 @@
+#include "sim/SimInverter.hpp"
+#include "host.hpp"
+#include "rtos/task.hpp"
+#include <algorithm>
+
+namespace wrvcu {
+
+void SimInverter::init(AbstractCANController* ican, uint8_t inodeID, uint32_t task_priority, SimVehicle* ivehicle, SimBMS* ibattery) {
+    can = ican;
+    nodeID = inodeID;
+    vehicle = ivehicle;
+    battery = ibattery;
+
+    rxQueue.init();
+
+    can->subscribe(NMT_COB_ID, &rxQueue);
+    can->subscribe(0x80, &rxQueue); // SYNC
+    can->subscribe(SDO_REQUEST_COB_ID + nodeID, &rxQueue);
+    can->subscribe(INVERTER_RPDO1 + nodeID, &rxQueue);
+
+    task.start(
+        [this] { loop(); }, task_priority, "SimInverter_Task");
+}
+
+void SimInverter::loop() {
+    // boot up
+    sendHeartbeat();
+    nmtState = NMTState::PreOperational;
+
+    uint32_t lastStep = Task::millis();
+    uint32_t lastHeartbeat = lastStep;
+
+    while (true) {
+        uint32_t now = Task::millis();
+        uint32_t nextStep = lastStep + SIM_INVERTER_STEP;
+        uint32_t nextHeartbeat = lastHeartbeat + SIM_INVERTER_HEARTBEAT_PERIOD;
+        uint32_t next = std::min(nextStep, nextHeartbeat);
+
+        CANMessage msg;
+        if (rxQueue.dequeue(msg, next > now ? next - now : 0)) {
+            receive(msg);
+        }
+
+        now = Task::millis();
+        if (now - lastStep >= SIM_INVERTER_STEP) {
+            step((now - lastStep) / 1000.0f);
+            lastStep = now;
+        }
+        if (now - lastHeartbeat >= SIM_INVERTER_HEARTBEAT_PERIOD) {
+            sendHeartbeat();
+            lastHeartbeat = now;
+        }
+    }
+}
+
+void SimInverter::receive(CANMessage const& msg) {
+    if (msg.id == NMT_COB_ID) {
+        handleNMT(msg);
+    } else if (msg.id == 0x80) {
+        if (nmtState == NMTState::Operational) {
+            sendTPDOs();
+        }
+    } else if (msg.id == (uint32_t)(SDO_REQUEST_COB_ID + nodeID)) {
+        handleSDO(msg);
+    } else if (msg.id == (uint32_t)(INVERTER_RPDO1 + nodeID)) {
+        if (nmtState == NMTState::Operational) {
+            torqueCommand = (int16_t)(msg.data[0] | (msg.data[1] << 8));
+            lastTorque = Task::millis();
+            torqueRx_us = (uint32_t)hostMicros();
+        }
+    }
+}
+
+void SimInverter::handleNMT(CANMessage const& msg) {
+    if (msg.len < 2 || (msg.data[1] != 0 && msg.data[1] != nodeID)) {
+        return;
+    }
+
+    switch ((NMTCommand)msg.data[0]) {
+    case NMTCommand::Operational:
+        nmtState = NMTState::Operational;
+        break;
+
+    case NMTCommand::Stopped:
+        nmtState = NMTState::Stopped;
+        break;
+
+    case NMTCommand::PreOperational:
+        nmtState = NMTState::PreOperational;
+        break;
+
+    case NMTCommand::Reset:
+    case NMTCommand::ResetComms:
+        // reboot, clearing any fault, and say so with a boot up message
+        controlword = 0;
+        errorCode = 0;
+        nmtState = NMTState::Boot;
+        sendHeartbeat();
+        nmtState = NMTState::PreOperational;
+        break;
+    }
+
+    // leaving operational stops the motor
+    if (nmtState != NMTState::Operational) {
+        torqueCommand = 0;
+    }
+}
+
+void SimInverter::handleSDO(CANMessage const& msg) {
+    if (nmtState != NMTState::PreOperational && nmtState != NMTState::Operational) {
+        return;
+    }
+
+    uint8_t ccs = msg.data[0] >> 5;
+    uint16_t index = msg.data[1] | (msg.data[2] << 8);
+    uint8_t subindex = msg.data[3];
+
+    if (index != INVERTER_CONTROLWORD_INDEX || subindex != INVERTER_CONTROLWORD_SUBINDEX) {
+        sendSDOResponse(0x80, index, subindex, 0x06020000); // abort, the object does not exist
+        return;
+    }
+
+    if (ccs == 1) {
+        // expedited download
+        controlword = msg.data[4] | (msg.data[5] << 8);
+        if (controlword & 0x80) {
+            errorCode = 0; // fault reset
+        }
+        sendSDOResponse(0x60, index, subindex, 0);
+    } else if (ccs == 2) {
+        // upload, of two bytes
+        sendSDOResponse(0x4b, index, subindex, controlword);
+    } else {
+        sendSDOResponse(0x80, index, subindex, 0x05040001); // abort, unknown command specifier
+    }
+}
+
+void SimInverter::sendHeartbeat() {
+    CANMessage msg;
+    msg.id = HEARTBEAT_COB_ID + nodeID;
+    msg.len = 1;
+    msg.data[0] = (uint8_t)nmtState;
+    can->send(msg);
+}
+
+void SimInverter::sendSDOResponse(uint8_t command, uint16_t index, uint8_t subindex, uint32_t data) {
+    CANMessage msg;
+    msg.id = SDO_RESPONSE_COB_ID + nodeID;
+    msg.len = 8;
+    msg.data[0] = command;
+    msg.data[1] = index & 0xff;
+    msg.data[2] = index >> 8;
+    msg.data[3] = subindex;
+    for (int i = 0; i < 4; i++) {
+        msg.data[4 + i] = (data >> (8 * i)) & 0xff;
+    }
+    can->send(msg);
+}
+
+void SimInverter::sendTPDOs() {
+    CANMessage msg;
+    msg.len = 8;
+
+    msg.id = INVERTER_TPDO1 + nodeID;
+    msg.data[2] = errorCode & 0xff;
+    msg.data[3] = errorCode >> 8;
+    can->send(msg);
+
+    int16_t motor = (int16_t)motorTemp;
+    int16_t controller = (int16_t)controllerTemp;
+    msg.id = INVERTER_TPDO2 + nodeID;
+    msg.data[0] = motor & 0xff;
+    msg.data[1] = (motor >> 8) & 0xff;
+    msg.data[2] = controller & 0xff;
+    msg.data[3] = (controller >> 8) & 0xff;
+    can->send(msg);
+
+    sentRPM = (int32_t)vehicle->getMotorSpeed();
+    rpmTx_us = (uint32_t)hostMicros();
+    int32_t rpm = sentRPM * polarityFactor;
+    msg.id = INVERTER_TPDO4 + nodeID;
+    msg.data[0] = 0;
+    for (int i = 0; i < 4; i++) {
+        msg.data[1 + i] = (rpm >> (8 * i)) & 0xff;
+    }
+    can->send(msg);
+}
+
+void SimInverter::fault(uint16_t code) {
+    if (errorCode == 0) {
+        faults++;
+    }
+    errorCode = code;
+}
+
+void SimInverter::step(float dt) {
+    float linkVoltage = battery != nullptr ? battery->getLinkVoltage() : MAX_BATTERY_VOLTAGE;
+
+    if (isEnabled()) {
+        if (linkVoltage < SIM_INVERTER_MIN_DC_VOLTAGE) {
+            fault(SIM_INVERTER_ERROR_UNDERVOLTAGE);
+        } else if (Task::millis() - lastTorque > SIM_INVERTER_RPDO_TIMEOUT) {
+            fault(SIM_INVERTER_ERROR_RPDO_TIMEOUT);
+        }
+    }
+
+    float rpm = vehicle->getMotorSpeed();
+    float command = isEnabled() ? torqueCommand * polarityFactor * INVERTER_NM_PER_UNIT : 0.0f;
+    float limit = maxTorque(rpm, linkVoltage);
+    torque = std::clamp(command, -limit, limit);
+
+    vehicle->step(torque, dt);
+    float omega = rpm * RPM_TO_RADS_FACTOR;
+
+    // copper losses heat the motor, and a little less the controller
+    float heating = SIM_INVERTER_MOTOR_HEATING * torque * torque;
+    motorTemp += (heating - (motorTemp - SIM_INVERTER_AMBIENT_TEMP) / SIM_INVERTER_COOLING_TIME) * dt;
+    controllerTemp += (heating / 2 - (controllerTemp - SIM_INVERTER_AMBIENT_TEMP) / SIM_INVERTER_COOLING_TIME) * dt;
+
+    if (battery != nullptr) {
+        float power = torque * omega;
+        power = power > 0 ? power / SIM_INVERTER_EFFICIENCY : power * SIM_INVERTER_EFFICIENCY;
+        battery->terminalCurrent = linkVoltage > SIM_INVERTER_MIN_DC_VOLTAGE ? power / linkVoltage : 0;
+    }
+}
+
+NMTState SimInverter::getNMTState() {
+    return nmtState;
+}
+
+bool SimInverter::isEnabled() {
+    return nmtState == NMTState::Operational && controlword == INVERTER_CW_ENABLE_PWM && errorCode == 0;
+}
+
+float SimInverter::maxTorque(float rpm, float linkVoltage) {
+    if (rpm >= SIM_INVERTER_MAX_SPEED) {
+        return 0;
+    }
+
+    // the back EMF leaves less of the DC link to drive current with, so a sagging pack gives less power
+    float power = SIM_INVERTER_PEAK_POWER * std::min(linkVoltage / SIM_INVERTER_NOMINAL_VOLTAGE, 1.0f);
+    float limit = SIM_INVERTER_PEAK_TORQUE;
+    if (rpm > 0) {
+        limit = std::min(limit, power / (rpm * (float)RPM_TO_RADS_FACTOR));
+    }
+    if (rpm > SIM_INVERTER_FADE_SPEED) {
+        limit *= (SIM_INVERTER_MAX_SPEED - rpm) / (SIM_INVERTER_MAX_SPEED - SIM_INVERTER_FADE_SPEED);
+    }
+    return limit;
+}
+
+float SimInverter::getTorque() {
+    return torque;
+}
+
+int16_t SimInverter::getTorqueCommand(uint32_t* rx_us) {
+    if (rx_us != nullptr) {
+        *rx_us = torqueRx_us;
+    }
+    return torqueCommand;
+}
+
+int32_t SimInverter::getSentRPM(uint32_t* tx_us) {
+    if (tx_us != nullptr) {
+        *tx_us = rpmTx_us;
+    }
+    return sentRPM;
+}
+
+float SimInverter::getMotorTemp() {
+    return motorTemp;
+}
+
+uint16_t SimInverter::getErrorCode() {
+    return errorCode;
+}
+
+uint32_t SimInverter::getFaults() {
+    return faults;
+}
+
+}
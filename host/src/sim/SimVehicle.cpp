@@ -0,0 +1,40 @@
+#include "sim/SimVehicle.hpp"
+#include "constants.hpp"
+#include <algorithm>
+
+namespace wrvcu {
+
+void SimVehicle::step(float motorTorque, float dt) {
+    float drive = motorTorque * SIM_VEHICLE_GEAR_RATIO / SIM_VEHICLE_WHEEL_RADIUS;
+
+    // resistance only ever holds the car still, it can't push it backwards
+    float resistance = 0.5f * SIM_VEHICLE_AIR_DENSITY * SIM_VEHICLE_DRAG_AREA * speed * speed;
+    resistance += SIM_VEHICLE_ROLLING * SIM_VEHICLE_MASS * SIM_VEHICLE_GRAVITY;
+    resistance += std::clamp(brake, 0.0f, 1.0f) * SIM_VEHICLE_BRAKE_FORCE;
+
+    // the rotor spins up with the car, so it adds to the mass the motor accelerates
+    float reduction = SIM_VEHICLE_GEAR_RATIO / SIM_VEHICLE_WHEEL_RADIUS;
+    float mass = SIM_VEHICLE_MASS + SIM_VEHICLE_MOTOR_INERTIA * reduction * reduction;
+
+    if (speed <= 0 && drive <= resistance) {
+        speed = 0;
+        return;
+    }
+
+    speed = std::max(0.0f, speed + (drive - resistance) / mass * dt);
+    distance += speed * dt;
+}
+
+float SimVehicle::getSpeed() {
+    return speed;
+}
+
+float SimVehicle::getMotorSpeed() {
+    return speed / SIM_VEHICLE_WHEEL_RADIUS * SIM_VEHICLE_GEAR_RATIO / RPM_TO_RADS_FACTOR;
+}
+
+float SimVehicle::getDistance() {
+    return distance;
+}
+
+}
@@ -2,6 +2,9 @@
 
 #include "constants.hpp"
 
+// Stack depth in words of the tractive system task
+#define TRACTIVE_SYSTEM_TASK_STACK_DEPTH TASK_STACK_DEPTH_DEFAULT
+
 namespace wrvcu {
 
 enum class TSStates {
@@ -24,7 +27,7 @@ protected:
     bool regenButtonHeld = false;
 
     Mutex mutex;
-    Task task;
+    StaticTask<TRACTIVE_SYSTEM_TASK_STACK_DEPTH> task;
 
     bool sdcIsClosed;
 
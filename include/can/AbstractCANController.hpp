@@ -1,27 +1,325 @@
 #pragma once
 
+#include <can/CANDispatchTable.hpp>
+#include <can/CANFilter.hpp>
+#include <can/CANFramePool.hpp>
 #include <can/CANMessage.hpp>
-#include <map>
+#include <can/CANStats.hpp>
 #include <memory>
 #include <rtos/defs.hpp>
+#include <rtos/mailbox.hpp>
 #include <rtos/queue.hpp>
 
+// The maximum number of CAN IDs a controller can dispatch to subscribers
+#define CAN_MAX_SUBSCRIPTIONS 32
+
+// The maximum number of ranges a forwarder can ask a controller's hardware filters to accept
+#define CAN_MAX_FORWARD_RANGES 16
+
+// The size of a buffer for compile_acceptance_filters()
+#define CAN_MAX_FILTER_RANGES (CAN_MAX_SUBSCRIPTIONS + CAN_MAX_FORWARD_RANGES)
+
+// The maximum number of CAN IDs which can be given a transmit priority other than the default
+#define CAN_MAX_TX_PRIORITIES 16
+
 namespace wrvcu {
+
+/**
+ * @brief Counts of frames which reached the CPU. Frames rejected by hardware filters never reach the CPU, and FlexCAN
+ * does not count them, so the filter coverage is reported instead: the fewer IDs the hardware accepts beyond those
+ * subscribed, the less unsubscribed traffic costs.
+ *
+ */
+struct CANRxCounters {
+    uint32_t received = 0;            // frames passed to post()
+    uint32_t dispatched = 0;          // frames delivered to a subscriber
+    uint32_t dropped = 0;             // frames lost to full subscriber queues, across all IDs
+    uint32_t softwareRejected = 0;    // frames with no subscriber, which the hardware filters let through
+    uint32_t forwarded = 0;           // frames handed to the controller's forwarder
+    uint32_t hwFilterRanges = 0;      // filter slots in use, 0 if hardware filtering is off
+    uint32_t hwFilterAcceptedIds = 0; // IDs the hardware filters let through
+};
+
+/**
+ * @brief What post() does when a subscriber's queue is full. The CAN task never waits for a subscriber, so one slow
+ * consumer cannot stall reception for every other node on the bus.
+ *
+ */
+enum class CANOverflowPolicy {
+    DropNewest,      // discard the new frame, keeping what is already queued
+    OverwriteOldest, // discard the oldest queued frame to make room for the new one
+    LatestValue      // the queue only ever holds the newest frame. Only for queues subscribed to a single ID.
+};
+
+/**
+ * @brief A subscriber to one CAN ID. Frames go to a queue of copies or a queue of CANFramePool handles, for events,
+ * or a mailbox, for state.
+ *
+ */
+struct CANSubscription {
+    Queue<CANMessage, 256>* queue = nullptr;
+    Queue<CANFrameRef, 256>* refQueue = nullptr;
+    Mailbox<CANMessage>* mailbox = nullptr;
+    CANOverflowPolicy policy = CANOverflowPolicy::DropNewest;
+    CANIdStats stats;
+};
+
+/**
+ * @brief How urgently a sent frame should reach the bus. Frames of a higher priority are always handed to the hardware
+ * before those of a lower one, and frames of the same priority go out in the order they were sent.
+ *
+ */
+enum class CANTxPriority {
+    Critical, // safety-critical frames such as torque commands and NMT. May use mailboxes kept free of other traffic.
+    High,
+    Normal, // the default for any ID without a priority set
+    Low     // logging and other traffic which can wait
+};
+
+#define CAN_TX_NUM_PRIORITIES 4
+
+class AbstractCANController;
+
+/**
+ * @brief Something which takes received frames from a controller regardless of its subscriptions, such as a gateway
+ * passing them on to another bus. It is called from the controller's task, so must not block.
+ *
+ */
+class CANForwarder {
+public:
+    /**
+     * @brief Whether frames with an ID received on a controller should be forwarded.
+     *
+     */
+    virtual bool accepts(AbstractCANController* source, uint32_t id) = 0;
+
+    /**
+     * @brief Take a received frame. Frames are still delivered to the controller's subscribers too.
+     *
+     * @param rx_us When the frame arrived, in microseconds.
+     */
+    virtual void forward(AbstractCANController* source, CANMessage const& message, uint32_t rx_us) = 0;
+
+    /**
+     * @brief Get the ranges of IDs the controller's hardware filters must accept, on top of its subscriptions.
+     *
+     * @return int The number of ranges written, at most maxRanges
+     */
+    virtual int get_accept_ranges(AbstractCANController* source, CANFilterRange* ranges, int maxRanges) = 0;
+};
+
 class AbstractCANController {
 protected:
-    std::map<uint32_t, Queue<CANMessage, 256>*> _subscribers;
+    CANDispatchTable<CANSubscription, CAN_MAX_SUBSCRIPTIONS> _subscribers;
+    CANDispatchTable<CANTxPriority, CAN_MAX_TX_PRIORITIES> _txPriorities;
+
+    CANRxCounters _rxCounters;
+
+    CANForwarder* _forwarder = nullptr;
+
+    uint32_t _baudRate = 0;
+
+    // running counts of bit times on the bus, each written by a single task
+    uint32_t _rxBits = 0;
+    uint32_t _txBits = 0;
 
     /**
      * @brief Puts a received message into the right queue.
      *
      * @param message The message to post.
+     * @param rx_us When the message arrived, in microseconds.
      */
-    void post(CANMessage const& message) {
-        if (_subscribers.find(message.id) == _subscribers.end())
+    void post(CANMessage const& message, uint32_t rx_us) {
+        post(message.id, [&message](CANMessage& out) { out = message; }, rx_us);
+    };
+
+    /**
+     * @brief Puts a received message into the right queue, writing it only once.
+     * The message is only built after the subscriber is found, and subscribers taking CANFramePool handles get it
+     * written straight into the pool.
+     *
+     * @param id The ID of the received message.
+     * @param fill Callable writing the message into the CANMessage it is given.
+     * @param rx_us When the message arrived, in microseconds.
+     */
+    template <class F>
+    void post(uint32_t id, F&& fill, uint32_t rx_us) {
+        postTo(_subscribers.find(id), id, fill, rx_us);
+    };
+
+    /**
+     * @brief Puts a received message into the queue of a subscriber which has already been looked up.
+     *
+     * @param sub The subscriber to the message's ID, or nullptr if there is none.
+     */
+    template <class F>
+    void postTo(CANSubscription* sub, uint32_t id, F&& fill, uint32_t rx_us) {
+        _rxCounters.received++;
+
+        if (_forwarder != nullptr && _forwarder->accepts(this, id)) {
+            CANMessage message;
+            fill(message);
+            _forwarder->forward(this, message, rx_us);
+            _rxCounters.forwarded++;
+
+            if (sub == nullptr) {
+                _rxBits += canFrameBitsNominal(message);
+                return; // forwarded only
+            }
+        }
+
+        if (sub == nullptr) {
+            _rxCounters.softwareRejected++;
+
+            // still on the bus, so still counts towards the load
+            CANMessage message;
+            fill(message);
+            _rxBits += canFrameBitsNominal(message);
             return; // no subscriber for this ID, so skip
+        }
+
+        uint32_t drops = 0;
+        bool delivered = false;
+
+        if (sub->refQueue != nullptr) {
+            CANFrameRef ref = canFramePool.allocate();
+            if (!ref.isValid()) {
+                CANMessage message; // pool exhausted, fill a copy only for the statistics
+                fill(message);
+                record(sub, message, rx_us);
+                drops = 1;
+            } else {
+                CANMessage& message = canFramePool.get(ref);
+                fill(message);
+                record(sub, message, rx_us);
+                delivered = enqueueWithPolicy(sub->refQueue, ref, sub->policy, drops, [](CANFrameRef old) { canFramePool.release(old); });
+            }
+        } else {
+            CANMessage message;
+            fill(message);
+            record(sub, message, rx_us);
+
+            if (sub->mailbox != nullptr) {
+                sub->mailbox->post(message); // never full, the old value is simply replaced
+                delivered = true;
+            } else {
+                delivered = enqueueWithPolicy(sub->queue, message, sub->policy, drops, [](CANMessage const& old) {});
+            }
+        }
+
+        if (delivered) {
+            _rxCounters.dispatched++;
+        }
+        sub->stats.drops += drops;
+        _rxCounters.dropped += drops;
+    };
+
+    /**
+     * @brief Count a received message in the per-ID and bus statistics.
+     *
+     */
+    void record(CANSubscription* sub, CANMessage const& message, uint32_t rx_us) {
+        sub->stats.add(message.len, rx_us);
+        _rxBits += canFrameBitsNominal(message);
+    };
+
+    /**
+     * @brief Enqueue without blocking, applying an overflow policy if the queue is full.
+     *
+     * @param drops Incremented for every item which is dropped, including the new item if it does not fit.
+     * @param discard Called with every item which is dropped.
+     * @return bool Whether the new item was enqueued.
+     */
+    template <typename T, class D>
+    static bool enqueueWithPolicy(Queue<T, 256>* queue, T const& item, CANOverflowPolicy policy, uint32_t& drops, D&& discard) {
+        T old;
+
+        switch (policy) {
+        case CANOverflowPolicy::DropNewest:
+            break;
+
+        case CANOverflowPolicy::OverwriteOldest:
+            if (queue->enqueue(item, 0)) {
+                return true;
+            }
+            if (queue->dequeue(old, 0)) { // no room, so throw away the oldest item
+                discard(old);
+                drops++;
+            }
+            break;
 
-        auto&& queue = _subscribers.at(message.id);
-        queue->enqueue(message, TIMEOUT_MAX); // enqueue the message
+        case CANOverflowPolicy::LatestValue:
+            while (queue->dequeue(old, 0)) { // anything still queued has been superseded
+                discard(old);
+                drops++;
+            }
+            break;
+        }
+
+        if (!queue->enqueue(item, 0)) {
+            discard(item);
+            drops++;
+            return false;
+        }
+
+        return true;
+    };
+
+    /**
+     * @brief Compile the subscribed IDs, and any IDs the forwarder takes, into hardware acceptance ranges, merging
+     * ranges if there are more than the hardware has filter slots for.
+     *
+     * @param ranges Output array of at least CAN_MAX_FILTER_RANGES ranges
+     * @param maxRanges The number of filter slots available
+     * @return int The number of ranges to program
+     */
+    int compile_acceptance_filters(CANFilterRange* ranges, int maxRanges) {
+        uint32_t ids[CAN_MAX_SUBSCRIPTIONS];
+        for (int i = 0; i < _subscribers.size(); i++) {
+            ids[i] = _subscribers.idAt(i); // already sorted
+        }
+
+        // runs of subscribed IDs, not reduced yet so the forwarded ranges can be merged in
+        int numRanges = compileFilterRanges(ids, _subscribers.size(), ranges, CAN_MAX_SUBSCRIPTIONS);
+
+        if (_forwarder != nullptr) {
+            numRanges += _forwarder->get_accept_ranges(this, ranges + numRanges, CAN_MAX_FORWARD_RANGES);
+        }
+
+        numRanges = reduceFilterRanges(ranges, numRanges, maxRanges);
+
+        _rxCounters.hwFilterRanges = numRanges;
+        _rxCounters.hwFilterAcceptedIds = filterRangeWidth(ranges, numRanges);
+
+        return numRanges;
+    };
+
+    /**
+     * @brief Stop accepting new subscriptions. Called by the controller before it starts dispatching messages.
+     *
+     */
+    void freeze_subscriptions() {
+        _subscribers.freeze();
+        _txPriorities.freeze();
+    };
+
+    /**
+     * @brief Get the transmit priority of an ID.
+     *
+     */
+    CANTxPriority tx_priority(uint32_t id) {
+        CANTxPriority* priority = _txPriorities.find(id);
+        return priority != nullptr ? *priority : CANTxPriority::Normal;
+    };
+
+    void addSubscription(uint16_t id, CANSubscription const& sub) {
+        if (_subscribers.isFrozen() || _subscribers.isFull()) {
+            printf("WARNING: CAN subscription to ID 0x%x made after start or with a full table!\n", id);
+            configASSERT(0); // assert error
+        } else if (!_subscribers.insert(id, sub)) {
+            printf("WARNING: CAN ID 0x%x already has a subscriber.\n", id);
+        } else { // ok
+        };
     };
 
 public:
@@ -42,17 +340,163 @@ public:
      * @brief Send a CAN Message
      *
      * @param message The message to send
+     * @return bool Whether the message was accepted. Controllers with a transmit queue return false if it was full
+     * and the message was dropped.
+     */
+    virtual bool send(CANMessage const& message) = 0;
+
+    /**
+     * @brief Set the priority frames with a given ID are sent with. IDs without one are sent with CANTxPriority::Normal.
+     * Like subscriptions, this must be done before the scheduler starts. Setting the same ID twice keeps the latest priority.
+     *
+     * @param id The ID to prioritise
+     * @param priority The priority to send it with
+     */
+    void set_tx_priority(uint16_t id, CANTxPriority priority) {
+        CANTxPriority* existing = _txPriorities.find(id);
+
+        if (existing != nullptr) {
+            *existing = priority;
+        } else if (_txPriorities.isFrozen() || !_txPriorities.insert(id, priority)) {
+            printf("WARNING: CAN TX priority for ID 0x%x set after start or with a full table!\n", id);
+            configASSERT(0); // assert error
+        } else { // ok
+        };
+    };
+
+    /**
+     * @brief Hand received frames to a forwarder as well as to subscribers. A controller has at most one forwarder.
+     * Must be set before the scheduler starts, so the hardware filters accept the forwarded IDs.
+     *
+     * @param forwarder The forwarder
+     */
+    void set_forwarder(CANForwarder* forwarder) {
+        if (_subscribers.isFrozen()) {
+            printf("WARNING: CAN forwarder set after start!\n");
+            configASSERT(0); // assert error
+        } else {
+            _forwarder = forwarder;
+        };
+    };
+
+    /**
+     * @brief Get counts of received, dispatched and rejected frames.
+     *
+     */
+    CANRxCounters get_rx_counters() {
+        return _rxCounters;
+    };
+
+    /**
+     * @brief Get the number of frames with a given ID which were dropped because the subscriber's queue was full.
+     *
+     * @param id The subscribed ID
+     * @return uint32_t The number of dropped frames, or 0 if nothing subscribes to the ID
+     */
+    uint32_t get_drop_count(uint16_t id) {
+        CANSubscription* sub = _subscribers.find(id);
+        return sub != nullptr ? sub->stats.drops : 0;
+    };
+
+    /**
+     * @brief Get the traffic statistics for a subscribed ID.
+     *
+     * @param id The subscribed ID
+     * @return CANIdStats The statistics, or empty statistics if nothing subscribes to the ID
+     */
+    CANIdStats get_id_stats(uint16_t id) {
+        CANSubscription* sub = _subscribers.find(id);
+        return sub != nullptr ? sub->stats : CANIdStats();
+    };
+
+    /**
+     * @brief Get the number of subscribed IDs, for iterating over them with get_subscribed_id().
+     *
+     */
+    int get_num_subscribed_ids() {
+        return _subscribers.size();
+    };
+
+    /**
+     * @brief Get a subscribed ID by index, in ascending order.
+     *
+     */
+    uint32_t get_subscribed_id(int i) {
+        return _subscribers.idAt(i);
+    };
+
+    /**
+     * @brief Get a running count of bit times used by frames sent and received, from canFrameBitsNominal(), so without
+     * stuff bits. Frames rejected by the hardware filters are not seen, so turn filtering off to measure the load of the
+     * whole bus.
+     * Use a CANBusLoadMeter to turn this into a load.
+     *
+     */
+    uint32_t get_bus_bits() {
+        return _rxBits + _txBits;
+    };
+
+    /**
+     * @brief Get the bit rate the controller was started with.
+     *
+     */
+    uint32_t get_baud_rate() {
+        return _baudRate;
+    };
+
+    /**
+     * @brief Get the controller's error counters and fault confinement state.
+     * Controllers without hardware behind them have no errors to report.
+     *
      */
-    virtual void send(CANMessage const& message) = 0;
+    virtual CANErrorCounters get_error_counters() {
+        return CANErrorCounters();
+    };
 
     /**
      * @brief Subscribes to CAN messages with a given ID. Messages are put in the provided queue.
+     * Subscriptions must be made before the scheduler starts, as the controller freezes its dispatch table when its task starts.
      *
      * @param id The ID to subscribe to.
      * @param queue The queue where new messages will be put.
+     * @param policy What to do with new messages when the queue is full.
      */
-    void subscribe(uint16_t id, Queue<CANMessage, 256>* queue) {
-        _subscribers.emplace(id, queue);
+    void subscribe(uint16_t id, Queue<CANMessage, 256>* queue, CANOverflowPolicy policy = CANOverflowPolicy::DropNewest) {
+        CANSubscription sub;
+        sub.queue = queue;
+        sub.policy = policy;
+
+        addSubscription(id, sub);
+    };
+
+    /**
+     * @brief Subscribes to CAN messages with a given ID. Messages are written once into the CANFramePool, and handles to
+     * them are put in the provided queue. Whoever dequeues a handle must release it back to the pool.
+     *
+     * @param id The ID to subscribe to.
+     * @param queue The queue where handles to new messages will be put.
+     * @param policy What to do with new messages when the queue is full.
+     */
+    void subscribe(uint16_t id, Queue<CANFrameRef, 256>* queue, CANOverflowPolicy policy = CANOverflowPolicy::DropNewest) {
+        CANSubscription sub;
+        sub.refQueue = queue;
+        sub.policy = policy;
+
+        addSubscription(id, sub);
+    };
+
+    /**
+     * @brief Subscribes to CAN messages with a given ID, keeping only the latest message in the provided mailbox.
+     * Use this for frames carrying state rather than events.
+     *
+     * @param id The ID to subscribe to.
+     * @param mailbox The mailbox where the latest message will be put.
+     */
+    void subscribe(uint16_t id, Mailbox<CANMessage>* mailbox) {
+        CANSubscription sub;
+        sub.mailbox = mailbox;
+
+        addSubscription(id, sub);
     };
 };
 
@@ -9,21 +9,176 @@
 #define CAN_MAX_READS 15
 #define CAN_BAUD_RATE 500000
 
+// Number of FlexCAN FIFO ID filters available with the default FIFO configuration
+#define CAN_HW_FILTER_SLOTS 8
+
+// Number of frames buffered between the receive interrupt and the CAN task in interrupt mode
+#define CAN_RX_RING_SIZE 256
+
+// Default stack depths in words of the CAN task and the TX task, see stack_report.py. Each controller's tasks are
+// named after its bus, so a busy bus can be given deeper stacks through the template parameters.
+#define CAN_RX_TASK_STACK_DEPTH TASK_STACK_DEPTH_DEFAULT
+#define CAN_TX_TASK_STACK_DEPTH TASK_STACK_DEPTH_DEFAULT
+
+// FlexCAN mailboxes used for transmitting. The FIFO and its filters take MB0-MB7.
+#define CAN_TX_FIRST_MB 8
+#define CAN_TX_LAST_MB 15
+// The last mailboxes are kept for CANTxPriority::Critical frames, so other traffic can never hold up a torque command
+#define CAN_TX_RESERVED_MBS 2
+
+// Frames buffered per priority waiting for a free mailbox
+#define CAN_TX_QUEUE_SIZE 32
+// How often the TX task retries when every mailbox is busy and no TX complete interrupt arrives, e.g. when bus-off
+#define CAN_TX_RETRY_MS 1
+
 namespace wrvcu {
 
+/**
+ * @brief How a controller gets received frames off the hardware.
+ *
+ */
+enum class CANRxMode {
+    Polling,  // the CAN task polls the FlexCAN buffers every few milliseconds
+    Interrupt // the receive interrupt wakes the CAN task only when frames arrive
+};
+
+/**
+ * @brief Transmit statistics for one priority.
+ *
+ */
+struct CANTxStats {
+    uint32_t queued = 0;   // frames accepted by send()
+    uint32_t sent = 0;     // frames written into a mailbox
+    uint32_t dropped = 0;  // frames lost because the priority's queue was full
+    CANLatencyStats delay; // time from send() to the frame being written into a mailbox
+};
+
 // templated class, so needs to be defined in the header :(
-template <CAN_DEV_TABLE BUS>
+template <CAN_DEV_TABLE BUS, uint32_t RX_STACK_DEPTH = CAN_RX_TASK_STACK_DEPTH, uint32_t TX_STACK_DEPTH = CAN_TX_TASK_STACK_DEPTH>
 class CANController_T4 : public AbstractCANController {
 
     FlexCAN_T4<BUS, RX_SIZE_256, TX_SIZE_16> can;
-    Task task;
+    StaticTask<RX_STACK_DEPTH> task;
+
+    // named after the bus, so the stack report tells the controllers apart
+    static constexpr const char* rxTaskName = BUS == CAN1 ? "CAN1_Task" : BUS == CAN2 ? "CAN2_Task" : "CAN3_Task";
+    static constexpr const char* txTaskName = BUS == CAN1 ? "CAN1_TX_Task" : BUS == CAN2 ? "CAN2_TX_Task" : "CAN3_TX_Task";
+
     Mutex mutex;
 
+    CANRxMode rxMode = CANRxMode::Polling;
+    bool hwFiltering = true;
+
+    // A frame captured by the receive interrupt, with the time it arrived
+    struct RxFrame {
+        CAN_message_t msg;
+        uint32_t rx_us;
+    };
+
+    // Single producer (the receive interrupt), single consumer (the CAN task) ring
+    RxFrame rxRing[CAN_RX_RING_SIZE];
+    volatile uint16_t rxHead = 0;
+    volatile uint16_t rxTail = 0;
+    volatile uint32_t rxOverruns = 0;
+
+    CANLatencyStats rxLatency;
+
+    // A frame waiting to be transmitted, with the time it was sent
+    struct TxRequest {
+        CANMessage msg;
+        uint32_t queued_us;
+    };
+
+    // Frames are queued per priority by send(), and only the TX task writes them into mailboxes
+    StaticTask<TX_STACK_DEPTH> txTask;
+    Queue<TxRequest, CAN_TX_QUEUE_SIZE> txQueues[CAN_TX_NUM_PRIORITIES];
+
+    // The frame at the head of each priority, taken off its queue but not yet in a mailbox
+    TxRequest txPending[CAN_TX_NUM_PRIORITIES];
+    bool txHasPending[CAN_TX_NUM_PRIORITIES] = {};
+
+    CANTxStats txStats[CAN_TX_NUM_PRIORITIES];
+    volatile uint32_t txCompleted = 0;
+
+    uint32_t errorReads = 0;
+
+    // FlexCAN callbacks are plain function pointers, so the ISR finds the controller for its bus through here
+    static inline CANController_T4* isrInstance = nullptr;
+
+    /**
+     * @brief Convert a FlexCAN message into our message type, writing it straight into its destination.
+     *
+     */
+    static void convertInto(CAN_message_t const& msg, CANMessage& wr_msg) {
+        wr_msg.id = msg.id;
+        wr_msg.len = msg.len;
+        wr_msg.timestamp = msg.timestamp;
+
+        wr_msg.flags.extended = msg.flags.extended;
+        wr_msg.flags.remote = msg.flags.remote;
+        wr_msg.flags.overrun = msg.flags.overrun;
+        wr_msg.flags.reserved = msg.flags.reserved;
+
+        memcpy(wr_msg.data, msg.buf, sizeof(wr_msg.data));
+    }
+
+    /**
+     * @brief Hand a received FlexCAN message to its subscriber. The message is only converted once, into wherever the
+     * subscriber takes it from.
+     *
+     */
+    void dispatch(CAN_message_t const& msg, uint32_t rx_us) {
+        post(msg.id, [&msg](CANMessage& out) { convertInto(msg, out); }, rx_us);
+    }
+
+    /**
+     * @brief Called by FlexCAN from the receive interrupt. Buffers the frame and wakes the CAN task.
+     *
+     */
+    static void rxISR(CAN_message_t const& msg) {
+        isrInstance->receiveFromISR(msg);
+    }
+
+    /**
+     * @brief Called by FlexCAN from the interrupt when a TX mailbox has finished sending. Wakes the TX task to refill it.
+     *
+     */
+    static void txISR(CAN_message_t const& msg) {
+        isrInstance->txCompleted = isrInstance->txCompleted + 1;
+        isrInstance->txTask.notify_from_isr();
+    }
+
+    void receiveFromISR(CAN_message_t const& msg) {
+        uint16_t next = (rxHead + 1) % CAN_RX_RING_SIZE;
+
+        if (next == rxTail) {
+            rxOverruns = rxOverruns + 1; // ring full, drop the frame
+            return;
+        }
+
+        rxRing[rxHead].msg = msg;
+        rxRing[rxHead].rx_us = micros();
+        rxHead = next;
+
+        task.notify_from_isr();
+    }
+
     /**
      * @brief The function run in the controller's task. This listens to CAN messages, and puts them in the correct queues.
      *
      */
     void loop() {
+        // all subscriptions are made during init, before the scheduler starts
+        freeze_subscriptions();
+
+        if (hwFiltering) {
+            applyAcceptanceFilters();
+        }
+
+        if (rxMode == CANRxMode::Interrupt) {
+            interruptLoop();
+        }
+
         while (true) {
             int reads = 0;
             CAN_message_t msg;
@@ -37,22 +192,8 @@ class CANController_T4 : public AbstractCANController {
             while (can.read(msg) && reads < CAN_MAX_READS) {
                 reads++;
 
-                // convert message types
-                CANMessage wr_msg{
-                    .id = msg.id,
-                    .len = msg.len,
-                    .timestamp = msg.timestamp,
-
-                    .flags = {
-                              .extended = msg.flags.extended,
-                              .remote = msg.flags.remote,
-                              .overrun = msg.flags.overrun,
-                              .reserved = msg.flags.reserved}
-                };
-                memcpy(wr_msg.data, msg.buf, sizeof(wr_msg.data));
-
                 // put into the right queue
-                post(wr_msg);
+                dispatch(msg, micros());
             }
             mutex.give();
 
@@ -62,7 +203,159 @@ class CANController_T4 : public AbstractCANController {
         };
     }
 
+    /**
+     * @brief Program the FIFO filters so only subscribed IDs are received.
+     *
+     */
+    void applyAcceptanceFilters() {
+        CANFilterRange ranges[CAN_MAX_FILTER_RANGES];
+        int numRanges = compile_acceptance_filters(ranges, CAN_HW_FILTER_SLOTS);
+
+        mutex.take();
+        can.setFIFOFilter(REJECT_ALL);
+        for (int i = 0; i < numRanges; i++) {
+            if (ranges[i].low == ranges[i].high) {
+                can.setFIFOFilter(i, ranges[i].low, STD);
+            } else {
+                can.setFIFOFilterRange(i, ranges[i].low, ranges[i].high, STD);
+            }
+        }
+        mutex.give();
+    }
+
+    /**
+     * @brief The task loop in interrupt mode. Sleeps until the receive interrupt notifies it, then drains every buffered frame.
+     * The hardware is not touched here, so the send mutex is not needed.
+     *
+     */
+    void interruptLoop() {
+        while (true) {
+            Task::notify_take(true, TIMEOUT_MAX);
+
+            while (rxTail != rxHead) {
+                RxFrame& frame = rxRing[rxTail];
+
+                dispatch(frame.msg, frame.rx_us);
+                rxLatency.add(micros() - frame.rx_us);
+
+                rxTail = (rxTail + 1) % CAN_RX_RING_SIZE;
+            }
+        }
+    }
+
+    /**
+     * @brief Convert our message type into a FlexCAN message.
+     *
+     */
+    static CAN_message_t convertOut(CANMessage const& message) {
+        CAN_message_t msg{
+            .id = message.id,
+            .flags = {
+                      .extended = message.flags.extended,
+                      .remote = message.flags.remote,
+                      .overrun = message.flags.overrun,
+                      .reserved = message.flags.reserved},
+
+            .len = message.len,
+        };
+        memcpy(msg.buf, message.data, sizeof(msg.buf));
+
+        return msg;
+    }
+
+    /**
+     * @brief Write a frame into the first free mailbox in a range.
+     *
+     * @return true if a mailbox was free
+     */
+    bool writeMailbox(CAN_message_t const& msg, int firstMB, int lastMB) {
+        for (int mb = firstMB; mb <= lastMB; mb++) {
+            if (can.write(static_cast<FLEXCAN_MAILBOX>(mb), msg)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Hand queued frames to free mailboxes, highest priority first.
+     * A priority's frames only go out once every higher priority is empty, so when the shared mailboxes are full nothing
+     * of a lower priority can overtake a waiting frame.
+     *
+     * @return true if frames are still waiting for a mailbox
+     */
+    bool serviceTx() {
+        const int firstReservedMB = CAN_TX_LAST_MB - CAN_TX_RESERVED_MBS + 1;
+
+        mutex.take();
+        for (int p = 0; p < CAN_TX_NUM_PRIORITIES; p++) {
+            while (true) {
+                if (!txHasPending[p]) {
+                    txHasPending[p] = txQueues[p].dequeue(txPending[p], 0);
+                    if (!txHasPending[p]) {
+                        break; // nothing queued at this priority
+                    }
+                }
+
+                CAN_message_t msg = convertOut(txPending[p].msg);
+
+                bool written;
+                if (p == static_cast<int>(CANTxPriority::Critical)) {
+                    // reserved mailboxes first, and the shared ones if those are still busy
+                    written = writeMailbox(msg, firstReservedMB, CAN_TX_LAST_MB) || writeMailbox(msg, CAN_TX_FIRST_MB, firstReservedMB - 1);
+                } else {
+                    written = writeMailbox(msg, CAN_TX_FIRST_MB, firstReservedMB - 1);
+                }
+
+                if (!written) {
+                    mutex.give();
+                    return true; // wait for a mailbox to free up
+                }
+
+                txStats[p].sent++;
+                _txBits += canFrameBitsNominal(txPending[p].msg);
+                txStats[p].delay.add(micros() - txPending[p].queued_us);
+                txHasPending[p] = false;
+            }
+        }
+        mutex.give();
+
+        return false;
+    }
+
+    /**
+     * @brief The function run in the TX task. Sleeps until a frame is sent or a mailbox finishes transmitting.
+     *
+     */
+    void txLoop() {
+        bool waiting = false;
+
+        while (true) {
+            Task::notify_take(true, waiting ? CAN_TX_RETRY_MS : TIMEOUT_MAX);
+            waiting = serviceTx();
+        }
+    }
+
 public:
+    /**
+     * @brief Choose how received frames are read. Must be called before init.
+     *
+     * @param mode The receive mode
+     */
+    void set_rx_mode(CANRxMode mode) {
+        rxMode = mode;
+    };
+
+    /**
+     * @brief Choose whether subscriptions are compiled into hardware acceptance filters. On by default. Must be called before init.
+     * With filtering off every frame on the bus reaches the CPU, which is useful to measure how much traffic the filters save.
+     *
+     * @param enable True to filter in hardware
+     */
+    void set_hw_filtering(bool enable) {
+        hwFiltering = enable;
+    };
+
     /**
      * @brief Start the CAN Controller.
      *
@@ -70,14 +363,48 @@ public:
     void init(uint32_t task_priority) override {
         can.begin();
         can.setBaudRate(CAN_BAUD_RATE);
+        _baudRate = CAN_BAUD_RATE;
 
         mutex.init();
 
+        // acceptance filters and the receive interrupt both work on the FIFO
+        if (hwFiltering || rxMode == CANRxMode::Interrupt) {
+            can.enableFIFO();
+        }
+
+        for (int p = 0; p < CAN_TX_NUM_PRIORITIES; p++) {
+            txQueues[p].init();
+        }
+
+        for (int mb = CAN_TX_FIRST_MB; mb <= CAN_TX_LAST_MB; mb++) {
+            can.setMB(static_cast<FLEXCAN_MAILBOX>(mb), TX);
+        }
+
         task.start(
             [this] {
                 loop();
             },
-            task_priority, "CAN_Task");
+            task_priority, rxTaskName);
+
+        txTask.start(
+            [this] {
+                txLoop();
+            },
+            task_priority, txTaskName);
+
+        // The interrupts notify the tasks, so they are only turned on once both tasks exist, as nodes on the bus are
+        // already sending at boot. There is no call to can.events(), so FlexCAN fires callbacks directly from the interrupt.
+        isrInstance = this;
+
+        if (rxMode == CANRxMode::Interrupt) {
+            can.enableFIFOInterrupt();
+            can.onReceive(FIFO, rxISR);
+        }
+
+        for (int mb = CAN_TX_FIRST_MB; mb <= CAN_TX_LAST_MB; mb++) {
+            can.enableMBInterrupt(static_cast<FLEXCAN_MAILBOX>(mb));
+        }
+        can.onTransmit(txISR);
     };
 
     /**
@@ -87,30 +414,91 @@ public:
      */
     void set_baud_rate(uint32_t baud_rate) override {
         can.setBaudRate(baud_rate);
+        _baudRate = baud_rate;
     };
 
     /**
-     * @brief Send a CAN Message
+     * @brief Queue a CAN Message to be sent with the priority set for its ID. Never blocks on the bus or the hardware.
      *
      * @param message The message to send
+     * @return bool Whether the message was queued, false if its priority's queue was full
      */
-    void send(CANMessage const& message) override {
-        CAN_message_t msg{
-            .id = message.id,
-            .flags = {
-                      .extended = message.flags.extended,
-                      .remote = message.flags.remote,
-                      .overrun = msg.flags.overrun,
-                      .reserved = msg.flags.reserved},
+    bool send(CANMessage const& message) override {
+        int p = static_cast<int>(tx_priority(message.id));
+        TxRequest request = { message, micros() };
 
-            .len = message.len,
-        };
-        memcpy(msg.buf, message.data, sizeof(msg.buf));
+        if (!txQueues[p].enqueue(request, 0)) {
+            txStats[p].dropped++;
+            return false;
+        }
 
-        mutex.take();
-        can.write(msg);
-        mutex.give();
+        txStats[p].queued++;
+        txTask.notify();
+        return true;
+    };
+
+    /**
+     * @brief Get the receive-to-dispatch latency of frames handled in interrupt mode.
+     *
+     */
+    CANLatencyStats get_rx_latency() {
+        return rxLatency;
+    };
+
+    /**
+     * @brief Get the number of frames dropped because the interrupt ring was full.
+     *
+     */
+    uint32_t get_rx_overruns() {
+        return rxOverruns;
+    };
+
+    /**
+     * @brief Get the transmit statistics for one priority.
+     *
+     */
+    CANTxStats get_tx_stats(CANTxPriority priority) {
+        return txStats[static_cast<int>(priority)];
+    };
+
+    /**
+     * @brief Read the FlexCAN error counters and the error flags latched since the last read.
+     *
+     */
+    CANErrorCounters get_error_counters() override {
+        uint32_t ecr = FLEXCANb_ECR(BUS);
+        uint32_t esr1 = FLEXCANb_ESR1(BUS); // reading clears the error flags
+
+        CANErrorCounters counters;
+        counters.txErrors = ecr & 0xff;
+        counters.rxErrors = (ecr >> 8) & 0xff;
+
+        uint32_t faultConfinement = (esr1 >> 4) & 0x3;
+        if (faultConfinement == 0) {
+            counters.state = CANFaultState::ErrorActive;
+        } else if (faultConfinement == 1) {
+            counters.state = CANFaultState::ErrorPassive;
+        } else {
+            counters.state = CANFaultState::BusOff;
+        }
+
+        // STFERR, FRMERR, CRCERR, ACKERR, BIT0ERR and BIT1ERR are bits 10-15, in the order of CAN_ERROR_FLAG_*
+        counters.errorFlags = (esr1 >> 10) & 0x3f;
+        if (counters.errorFlags != 0) {
+            errorReads++;
+        }
+        counters.errorReads = errorReads;
+
+        return counters;
+    };
+
+    /**
+     * @brief Get the number of frames the hardware has finished transmitting.
+     *
+     */
+    uint32_t get_tx_completed() {
+        return txCompleted;
     };
 };
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+
+namespace wrvcu {
+
+/**
+ * @brief A flat lookup table from CAN ID to a value, kept sorted by ID.
+ * IDs are inserted during initialisation, after which the table is frozen. Lookups are a binary search over a
+ * contiguous array, so they are bounded in time and never allocate or chase pointers.
+ *
+ * @tparam V The type stored against each ID
+ * @tparam CAPACITY The maximum number of IDs the table can hold
+ */
+template <typename V, int CAPACITY>
+class CANDispatchTable {
+    uint32_t ids[CAPACITY];
+    V values[CAPACITY];
+    int count = 0;
+    bool frozen = false;
+
+    /**
+     * @brief Find the index of the first ID which is not less than the given ID.
+     */
+    int lowerBound(uint32_t id) const {
+        int lo = 0;
+        int hi = count;
+
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (ids[mid] < id) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+
+        return lo;
+    }
+
+public:
+    CANDispatchTable() = default;
+
+    /**
+     * @brief Add an ID to the table. Must be called before the table is frozen.
+     *
+     * @param id The CAN ID
+     * @param value The value stored against the ID
+     * @return true if the ID was added, false if the table is frozen, full, or already contains the ID.
+     */
+    bool insert(uint32_t id, V const& value) {
+        if (frozen || count >= CAPACITY) {
+            return false;
+        }
+
+        int pos = lowerBound(id);
+        if (pos < count && ids[pos] == id) {
+            return false; // keep the existing entry
+        }
+
+        // shift the tail up by one to keep the table sorted
+        for (int i = count; i > pos; i--) {
+            ids[i] = ids[i - 1];
+            values[i] = values[i - 1];
+        }
+
+        ids[pos] = id;
+        values[pos] = value;
+        count++;
+
+        return true;
+    }
+
+    /**
+     * @brief Look up the value stored against an ID.
+     *
+     * @param id The CAN ID
+     * @return A pointer to the value, or nullptr if the ID is not in the table.
+     */
+    V* find(uint32_t id) {
+        int pos = lowerBound(id);
+        if (pos < count && ids[pos] == id) {
+            return &values[pos];
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * @brief Prevent any more IDs being inserted.
+     */
+    void freeze() {
+        frozen = true;
+    }
+
+    bool isFrozen() const {
+        return frozen;
+    }
+
+    bool isFull() const {
+        return count >= CAPACITY;
+    }
+
+    /**
+     * @brief Get the number of IDs in the table.
+     */
+    int size() const {
+        return count;
+    }
+
+    /**
+     * @brief Get the ID at a position in the table. IDs are stored in ascending order.
+     */
+    uint32_t idAt(int index) const {
+        return ids[index];
+    }
+
+    /**
+     * @brief Get the value at a position in the table.
+     */
+    V& valueAt(int index) {
+        return values[index];
+    }
+};
+
+}
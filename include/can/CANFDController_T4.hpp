@@ -0,0 +1,269 @@
+#pragma once
+
+#include "logging/log.hpp"
+#include <FlexCAN_T4.h>
+#include <can/AbstractCANController.hpp>
+#include <can/CANController_T4.hpp>
+#include <can/CANFDMessage.hpp>
+#include <rtos/rtos.hpp>
+
+// The bit rate of the data phase of frames sent with bit rate switching
+#define CAN_FD_DATA_RATE 2000000
+
+// The number of frames each FD subscriber's queue holds. FD frames are large, so these are kept short.
+#define CAN_FD_QUEUE_LENGTH 32
+
+// Stack depth in words of the CAN FD task
+#define CAN_FD_TASK_STACK_DEPTH TASK_STACK_DEPTH_DEFAULT
+
+namespace wrvcu {
+
+/**
+ * @brief A subscriber to CAN FD frames with one ID.
+ *
+ */
+struct CANFDSubscription {
+    Queue<CANFDMessage, CAN_FD_QUEUE_LENGTH>* queue = nullptr;
+    CANIdStats stats;
+};
+
+/**
+ * @brief A controller for a CAN FD bus. Only CAN3 on the Teensy 4.1 supports FD.
+ * Classic frames, and FD frames of up to 8 bytes, are handed to subscribers of CANMessage like on any other controller,
+ * so existing devices work unchanged. Frames with IDs subscribed to with subscribeFD() are delivered whole.
+ *
+ */
+template <CAN_DEV_TABLE BUS>
+class CANFDController_T4 : public AbstractCANController {
+    static_assert(BUS == CAN3, "Only CAN3 supports CAN FD");
+
+    FlexCAN_T4FD<BUS, RX_SIZE_256, TX_SIZE_16> can;
+    StaticTask<CAN_FD_TASK_STACK_DEPTH> task;
+    Mutex mutex;
+
+    uint32_t dataRate = CAN_FD_DATA_RATE;
+
+    CANDispatchTable<CANFDSubscription, CAN_MAX_SUBSCRIPTIONS> _fdSubscribers;
+
+    /**
+     * @brief Hand a received frame to its subscriber.
+     *
+     */
+    void dispatch(CANFD_message_t const& msg, uint32_t rx_us) {
+        CANFDSubscription* sub = _fdSubscribers.find(msg.id);
+
+        if (sub != nullptr) {
+            CANFDMessage wr_msg;
+            wr_msg.id = msg.id;
+            wr_msg.len = msg.len;
+            wr_msg.timestamp = msg.timestamp;
+            wr_msg.flags.extended = msg.flags.extended;
+            wr_msg.flags.brs = msg.brs;
+            wr_msg.flags.esi = msg.esi;
+            wr_msg.flags.overrun = msg.flags.overrun;
+            memcpy(wr_msg.data, msg.buf, msg.len);
+
+            _rxCounters.received++;
+            _rxBits += canFDFrameBitsNominal(wr_msg, _baudRate, dataRate);
+
+            sub->stats.add(msg.len, rx_us);
+
+            if (sub->queue->enqueue(wr_msg, 0)) {
+                _rxCounters.dispatched++;
+            } else {
+                sub->stats.drops++;
+                _rxCounters.dropped++;
+            }
+            return;
+        }
+
+        if (msg.len > 8) {
+            // an FD frame nobody takes whole, so it cannot be passed on as a CANMessage
+            _rxCounters.received++;
+            _rxCounters.softwareRejected++;
+            return;
+        }
+
+        auto fill = [&msg](CANMessage& out) {
+            out.id = msg.id;
+            out.len = msg.len;
+            out.timestamp = msg.timestamp;
+            out.flags.extended = msg.flags.extended;
+            out.flags.overrun = msg.flags.overrun;
+            memcpy(out.data, msg.buf, sizeof(out.data));
+        };
+        post(msg.id, fill, rx_us);
+    }
+
+    /**
+     * @brief The function run in the controller's task. This listens to CAN messages, and puts them in the correct queues.
+     *
+     */
+    void loop() {
+        // all subscriptions are made during init, before the scheduler starts
+        freeze_subscriptions();
+        _fdSubscribers.freeze();
+
+        while (true) {
+            int reads = 0;
+            CANFD_message_t msg;
+
+            mutex.take();
+
+            // read a burst of messages to increase throughput
+            // but limit max reads in one burst to prevent hogging
+            while (can.read(msg) && reads < CAN_MAX_READS) {
+                reads++;
+                dispatch(msg, micros());
+            }
+            mutex.give();
+
+            if (reads >= CAN_MAX_READS)
+                WARN("Too many CAN FD messages! Max reads exceeded.\n");
+            Task::delay(5);
+        };
+    }
+
+    /**
+     * @brief Write a frame to the hardware.
+     *
+     * @param bits The bit times the frame takes on the bus
+     */
+    bool write(CANFD_message_t const& msg, uint32_t bits) {
+        mutex.take();
+        bool written = can.write(msg);
+        if (written) {
+            _txBits += bits;
+        }
+        mutex.give();
+
+        return written;
+    }
+
+    /**
+     * @brief Program the nominal and data bit rates.
+     *
+     */
+    void applyBaudRate() {
+        CANFD_timings_t config;
+        config.clock = CLK_24MHz;
+        config.baudrate = _baudRate;
+        config.baudrateFD = dataRate;
+        config.propdelay = 190;
+        config.bus_length = 1;
+        config.sample = 75;
+        can.setBaudRate(config);
+    }
+
+public:
+    /**
+     * @brief Set the bit rate of the data phase. Must be called before init.
+     *
+     * @param rate The data bit rate
+     */
+    void set_data_rate(uint32_t rate) {
+        dataRate = rate;
+    };
+
+    /**
+     * @brief Start the CAN FD Controller.
+     *
+     */
+    void init(uint32_t task_priority) override {
+        can.begin();
+        _baudRate = CAN_BAUD_RATE;
+        applyBaudRate();
+        can.setRegions(64); // every mailbox can hold a 64 byte frame
+
+        mutex.init();
+
+        task.start(
+            [this] {
+                loop();
+            },
+            task_priority, "CAN_FD_Task");
+    };
+
+    /**
+     * @brief Set the nominal (arbitration) bit rate
+     *
+     * @param baud_rate The new baud rate
+     */
+    void set_baud_rate(uint32_t baud_rate) override {
+        _baudRate = baud_rate;
+        applyBaudRate();
+    };
+
+    /**
+     * @brief Send a classic CAN Message
+     *
+     * @param message The message to send
+     * @return bool Whether a mailbox was free to take it
+     */
+    bool send(CANMessage const& message) override {
+        CANFD_message_t msg;
+        msg.id = message.id;
+        msg.flags.extended = message.flags.extended;
+        msg.edl = 0; // classic frame
+        msg.brs = 0;
+        msg.len = message.len;
+        memcpy(msg.buf, message.data, sizeof(message.data));
+
+        return write(msg, canFrameBitsNominal(message));
+    };
+
+    /**
+     * @brief Send a CAN FD Message. The payload is padded with zeros up to the next length an FD frame can carry.
+     *
+     * @param message The message to send
+     */
+    void sendFD(CANFDMessage const& message) {
+        uint8_t len = canfdRoundLen(message.len);
+
+        CANFD_message_t msg;
+        msg.id = message.id;
+        msg.flags.extended = message.flags.extended;
+        msg.edl = 1;
+        msg.brs = message.flags.brs;
+        msg.esi = 0;
+        msg.len = len;
+        memset(msg.buf, 0, sizeof(msg.buf));
+        memcpy(msg.buf, message.data, message.len);
+
+        CANFDMessage sent = message;
+        sent.len = len;
+        write(msg, canFDFrameBitsNominal(sent, _baudRate, dataRate));
+    };
+
+    /**
+     * @brief Subscribes to CAN FD messages with a given ID. Messages are put whole in the provided queue, and never
+     * reach subscribers of CANMessage.
+     * Subscriptions must be made before the scheduler starts.
+     *
+     * @param id The ID to subscribe to.
+     * @param queue The queue where new messages will be put.
+     */
+    void subscribeFD(uint16_t id, Queue<CANFDMessage, CAN_FD_QUEUE_LENGTH>* queue) {
+        CANFDSubscription sub;
+        sub.queue = queue;
+
+        if (_fdSubscribers.isFrozen() || _fdSubscribers.isFull()) {
+            printf("WARNING: CAN FD subscription to ID 0x%x made after start or with a full table!\n", id);
+            configASSERT(0); // assert error
+        } else if (!_fdSubscribers.insert(id, sub)) {
+            printf("WARNING: CAN FD ID 0x%x already has a subscriber.\n", id);
+        } else { // ok
+        };
+    };
+
+    /**
+     * @brief Get the traffic statistics for an ID subscribed to with subscribeFD().
+     *
+     */
+    CANIdStats get_fd_id_stats(uint16_t id) {
+        CANFDSubscription* sub = _fdSubscribers.find(id);
+        return sub != nullptr ? sub->stats : CANIdStats();
+    };
+};
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+
+// The largest CAN FD payload
+#define CANFD_MAX_LEN 64
+
+namespace wrvcu {
+struct CANFDMessage {
+    uint32_t id = 0;                     // can identifier
+    uint8_t len = 8;                     // length of data in bytes, one of 0-8, 12, 16, 20, 24, 32, 48 or 64
+    uint8_t data[CANFD_MAX_LEN] = { 0 }; // data
+
+    uint16_t timestamp = 0; // FlexCAN time when message arrived
+    struct {
+        bool extended = 0; // identifier is extended (29-bit)
+        bool brs = 1;      // bit rate switch, the data phase is sent at the faster data rate
+        bool esi = 0;      // error state indicator, set by a transmitter which is error passive
+        bool overrun = 0;  // message overrun
+    } flags;
+};
+
+/**
+ * @brief Convert a payload length in bytes to its CAN FD DLC code.
+ * Lengths with no exact code round up to the next length that has one, and the frame is padded to that length.
+ *
+ */
+inline uint8_t canfdLenToDLC(uint8_t len) {
+    if (len <= 8)
+        return len;
+    if (len <= 12)
+        return 9;
+    if (len <= 16)
+        return 10;
+    if (len <= 20)
+        return 11;
+    if (len <= 24)
+        return 12;
+    if (len <= 32)
+        return 13;
+    if (len <= 48)
+        return 14;
+    return 15;
+}
+
+/**
+ * @brief Convert a CAN FD DLC code to its payload length in bytes.
+ *
+ */
+inline uint8_t canfdDLCToLen(uint8_t dlc) {
+    static const uint8_t lengths[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64 };
+    return lengths[dlc & 0xf];
+}
+
+/**
+ * @brief Round a payload length up to the nearest length a CAN FD frame can carry.
+ *
+ */
+inline uint8_t canfdRoundLen(uint8_t len) {
+    return canfdDLCToLen(canfdLenToDLC(len));
+}
+
+}
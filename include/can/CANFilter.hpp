@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+namespace wrvcu {
+
+/**
+ * @brief An inclusive range of CAN IDs accepted by a hardware filter.
+ *
+ */
+struct CANFilterRange {
+    uint32_t low;
+    uint32_t high;
+};
+
+/**
+ * @brief Reduce a set of acceptance ranges to at most maxRanges.
+ * The ranges are sorted and overlapping or touching ranges joined, then the two neighbouring ranges with the smallest
+ * gap between them are merged until the ranges fit in the filter slots available. Every ID is always covered; merging
+ * only lets extra IDs through, which are then rejected in software.
+ *
+ * @param ranges The ranges, in any order. Reduced in place.
+ * @param numRanges The number of ranges
+ * @param maxRanges The number of filter slots available
+ * @return int The number of ranges left
+ */
+inline int reduceFilterRanges(CANFilterRange* ranges, int numRanges, int maxRanges) {
+    // insertion sort by low ID, there are only ever a few dozen ranges
+    for (int i = 1; i < numRanges; i++) {
+        CANFilterRange range = ranges[i];
+        int j = i - 1;
+        while (j >= 0 && ranges[j].low > range.low) {
+            ranges[j + 1] = ranges[j];
+            j--;
+        }
+        ranges[j + 1] = range;
+    }
+
+    int joined = 0;
+    for (int i = 0; i < numRanges; i++) {
+        if (joined > 0 && ranges[i].low <= ranges[joined - 1].high + 1) {
+            ranges[joined - 1].high = std::max(ranges[joined - 1].high, ranges[i].high);
+        } else {
+            ranges[joined] = ranges[i];
+            joined++;
+        }
+    }
+    numRanges = joined;
+
+    while (numRanges > maxRanges && numRanges > 1) {
+        int closest = 0;
+        for (int r = 1; r < numRanges - 1; r++) {
+            if ((ranges[r + 1].low - ranges[r].high) < (ranges[closest + 1].low - ranges[closest].high)) {
+                closest = r;
+            }
+        }
+
+        ranges[closest].high = ranges[closest + 1].high;
+        for (int r = closest + 1; r < numRanges - 1; r++) {
+            ranges[r] = ranges[r + 1];
+        }
+        numRanges--;
+    }
+
+    return numRanges;
+}
+
+/**
+ * @brief Compile a sorted list of IDs into at most maxRanges acceptance ranges.
+ * Runs of consecutive IDs become one range, then the ranges are reduced with reduceFilterRanges().
+ *
+ * @param ids The IDs to accept, in ascending order
+ * @param count The number of IDs
+ * @param ranges Output array, with space for at least count ranges
+ * @param maxRanges The number of filter slots available
+ * @return int The number of ranges written
+ */
+inline int compileFilterRanges(const uint32_t* ids, int count, CANFilterRange* ranges, int maxRanges) {
+    int numRanges = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (numRanges > 0 && ids[i] <= ranges[numRanges - 1].high + 1) {
+            ranges[numRanges - 1].high = ids[i]; // extends the current run
+        } else {
+            ranges[numRanges] = { ids[i], ids[i] };
+            numRanges++;
+        }
+    }
+
+    return reduceFilterRanges(ranges, numRanges, maxRanges);
+}
+
+/**
+ * @brief The range of IDs matched by an ID and mask, as used by gateway routes. A mask whose set bits are not all
+ * above its clear bits matches IDs that are not contiguous, so the range covers them all and lets some extra IDs through.
+ *
+ */
+inline CANFilterRange maskFilterRange(uint32_t id, uint32_t mask, uint32_t idMask) {
+    return { id & mask & idMask, (id & mask) | (~mask & idMask) };
+}
+
+/**
+ * @brief Count how many IDs a set of ranges lets through.
+ *
+ */
+inline uint32_t filterRangeWidth(const CANFilterRange* ranges, int numRanges) {
+    uint32_t width = 0;
+    for (int i = 0; i < numRanges; i++) {
+        width += ranges[i].high - ranges[i].low + 1;
+    }
+    return width;
+}
+
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <can/CANMessage.hpp>
+#include <cstdint>
+
+// The number of received frames which can be in flight between tasks at once
+#define CAN_FRAME_POOL_SIZE 128
+
+namespace wrvcu {
+
+/**
+ * @brief A handle to a frame in the CANFramePool. This is what gets passed through queues instead of the frame itself.
+ * Handles are plain values, so whoever holds one is responsible for releasing it exactly once.
+ *
+ */
+struct CANFrameRef {
+    uint16_t slot = 0xffff;
+
+    bool isValid() const {
+        return slot != 0xffff;
+    }
+};
+
+/**
+ * @brief A fixed-size, statically allocated pool of received CAN frames with reference counts.
+ * The receive path writes each frame into the pool once, and subscribers are passed small CANFrameRef handles,
+ * so frames are not copied through every queue between the CAN controller and the device that decodes them.
+ *
+ */
+class CANFramePool {
+    CANMessage frames[CAN_FRAME_POOL_SIZE];
+    uint8_t refCounts[CAN_FRAME_POOL_SIZE];
+
+    uint16_t freeSlots[CAN_FRAME_POOL_SIZE];
+    uint16_t numFree;
+
+    uint32_t exhaustedCount = 0;
+
+public:
+    CANFramePool();
+
+    /**
+     * @brief Take a free frame from the pool, with a reference count of 1.
+     *
+     * @return CANFrameRef The frame, or an invalid handle if the pool is empty.
+     */
+    CANFrameRef allocate();
+
+    /**
+     * @brief Add a reference to a frame, for when a handle is shared with another owner.
+     *
+     */
+    void retain(CANFrameRef ref);
+
+    /**
+     * @brief Drop a reference to a frame. The frame returns to the pool when the last reference is released.
+     *
+     */
+    void release(CANFrameRef ref);
+
+    /**
+     * @brief Access the frame behind a handle. Only valid while a reference is held.
+     *
+     */
+    CANMessage& get(CANFrameRef ref) {
+        return frames[ref.slot];
+    }
+
+    /**
+     * @brief Get the number of free frames.
+     *
+     */
+    uint32_t available() {
+        return numFree;
+    }
+
+    /**
+     * @brief Get the number of times a frame was requested while the pool was empty.
+     *
+     */
+    uint32_t getExhaustedCount() {
+        return exhaustedCount;
+    }
+};
+
+// The pool shared by all CAN controllers and their subscribers
+extern CANFramePool canFramePool;
+
+}
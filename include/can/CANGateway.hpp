@@ -0,0 +1,84 @@
+#pragma once
+
+#include "can/AbstractCANController.hpp"
+
+// The maximum number of routes a gateway can hold
+#define CAN_GATEWAY_MAX_ROUTES 16
+
+// Every bit of a standard 11-bit ID, the mask for a route matching a single ID
+#define CAN_STD_ID_MASK 0x7ff
+
+namespace wrvcu {
+
+/**
+ * @brief A rule forwarding frames from one bus to another.
+ *
+ */
+struct CANRoute {
+    AbstractCANController* source = nullptr;
+    uint32_t id = 0;
+    uint32_t mask = CAN_STD_ID_MASK; // the bits of the ID which must match
+    AbstractCANController* destination = nullptr;
+    uint32_t minInterval_ms = 0; // rate limit for the route as a whole, 0 forwards every frame
+    int32_t remapOffset = 0;     // added to the ID on the destination bus
+};
+
+/**
+ * @brief Forwarding statistics for one route.
+ *
+ */
+struct CANRouteStats {
+    uint32_t forwarded = 0;   // frames the destination accepted
+    uint32_t bytes = 0;
+    uint32_t rateLimited = 0; // matching frames not forwarded because of the rate limit
+    uint32_t dropped = 0;     // frames the destination's transmit queue was too full to take
+    CANLatencyStats latency;  // time from the frame arriving on the source bus to it being queued on the destination
+};
+
+/**
+ * @brief Forwards frames between CAN buses using a static route table.
+ * Routes are checked in the order they were added, and a frame is forwarded by every route it matches. Frames are
+ * forwarded from the source controller's task, and sending never blocks, so a slow destination cannot stall the source.
+ *
+ */
+class CANGateway : public CANForwarder {
+    CANRoute routes[CAN_GATEWAY_MAX_ROUTES];
+    CANRouteStats stats[CAN_GATEWAY_MAX_ROUTES];
+    uint32_t lastForward_us[CAN_GATEWAY_MAX_ROUTES];
+    int numRoutes = 0;
+
+    static bool matches(CANRoute const& route, AbstractCANController* source, uint32_t id) {
+        return route.source == source && (id & route.mask) == (route.id & route.mask);
+    }
+
+public:
+    /**
+     * @brief Add a route. Must be called before the scheduler starts.
+     *
+     * @param source The bus frames are received on
+     * @param id The ID to match
+     * @param mask The bits of the ID which must match, CAN_STD_ID_MASK for a single ID
+     * @param destination The bus frames are sent on
+     * @param minInterval_ms The minimum time between forwarded frames, 0 for no limit
+     * @param remapOffset Added to the ID of forwarded frames
+     */
+    void addRoute(AbstractCANController* source, uint32_t id, uint32_t mask, AbstractCANController* destination,
+        uint32_t minInterval_ms = 0, int32_t remapOffset = 0);
+
+    bool accepts(AbstractCANController* source, uint32_t id) override;
+
+    void forward(AbstractCANController* source, CANMessage const& message, uint32_t rx_us) override;
+
+    int get_accept_ranges(AbstractCANController* source, CANFilterRange* ranges, int maxRanges) override;
+
+    int getNumRoutes();
+
+    /**
+     * @brief Get the forwarding statistics of a route.
+     *
+     * @param route The index of the route, in the order routes were added
+     */
+    CANRouteStats getRouteStats(int route);
+};
+
+}
@@ -9,6 +9,12 @@
 #define SDO_RESPONSE_COB_ID 0x580
 #define NMT_COB_ID 0x000
 
+// The most frames the device task takes from its queue at once
+#define CANOPEN_RX_BATCH 16
+
+// Stack depth in words of the device task
+#define CANOPEN_DEVICE_TASK_STACK_DEPTH TASK_STACK_DEPTH_DEFAULT
+
 namespace wrvcu {
 
 enum class NMTCommand {
@@ -44,15 +50,21 @@ protected:
 
     NMTState nmtState = NMTState::Boot;
 
-    Queue<PDOMessage, 256>* pdoQueue;
-    Queue<SDOMessage, 256>* sdoQueue;
+    SPSCQueue<CANFrameRef, 256>* pdoQueue = nullptr; // the device task is the only producer, and the inverter task the only consumer
+    SPSCQueue<SDOMessage, 256>* sdoQueue = nullptr;
 
-    Queue<CANMessage, 256> canQueue;
+    Queue<CANFrameRef, 256> canQueue;
 
-    Task task;
+    StaticTask<CANOPEN_DEVICE_TASK_STACK_DEPTH> task;
 
     void loop();
 
+    /**
+     * @brief Pass PDOs on to the PDO queue together, releasing any the queue wouldn't take.
+     *
+     */
+    void sendPDOs(CANFrameRef* refs, int count);
+
 public:
     /**
      * @brief Initialise the CANOpen Device
@@ -89,18 +101,19 @@ public:
     void sendPDO(uint32_t cob_id, uint8_t data[8]);
 
     /**
-     * @brief Subscribe to PDOs from the device
+     * @brief Subscribe to PDOs from the device. PDO frames are passed on as CANFramePool handles without being copied,
+     * so the reader must release each one. The COB ID of a frame is its ID minus getNodeID().
      *
-     * @param pdoQueue The queue of PDO messages
+     * @param pdoQueue The queue of PDO frame handles
      */
-    void addPDOQueue(Queue<PDOMessage, 256>* pdoQueue);
+    void addPDOQueue(SPSCQueue<CANFrameRef, 256>* pdoQueue);
 
     /**
      * @brief Subscribe to the results from SDO reads
      *
      * @param sdoQueue The queue of SDO messages that will be written to
      */
-    void addSDOQueue(Queue<SDOMessage, 256>* sdoQueue);
+    void addSDOQueue(SPSCQueue<SDOMessage, 256>* sdoQueue);
 
     /**
      * @brief Add a COB ID to be subscribed to
@@ -110,6 +123,8 @@ public:
     void subscribePDO(uint32_t cob_id);
 
     NMTState getNMTState();
+
+    uint8_t getNodeID();
 };
 
 }
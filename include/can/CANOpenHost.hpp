@@ -3,13 +3,16 @@
 #include "can/AbstractCANController.hpp"
 #include "rtos/task.hpp"
 
+// Stack depth in words of the host task
+#define CANOPEN_HOST_TASK_STACK_DEPTH TASK_STACK_DEPTH_DEFAULT
+
 namespace wrvcu {
 
 class CANOpenHost {
 protected:
     AbstractCANController* can;
 
-    Task task;
+    StaticTask<CANOPEN_HOST_TASK_STACK_DEPTH> task;
 
     void loop();
 
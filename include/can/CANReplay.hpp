@@ -0,0 +1,192 @@
+#pragma once
+
+#include "Stream.h"
+#include "can/AbstractCANController.hpp"
+#include "rtos/rtos.hpp"
+
+// The longest log line which is parsed, longer lines are skipped
+#define CAN_REPLAY_MAX_LINE 160
+
+// Stack depth in words of the replay task
+#define CAN_REPLAY_TASK_STACK_DEPTH TASK_STACK_DEPTH_DEFAULT
+
+namespace wrvcu {
+
+/**
+ * @brief Where a replay reads its log from, one line at a time.
+ *
+ */
+class CANLineSource {
+public:
+    /**
+     * @brief Read the next line, without the line ending.
+     *
+     * @param line Buffer for the line, always null terminated
+     * @param maxLen The size of the buffer
+     * @return true A line was read
+     * @return false The end of the log has been reached
+     */
+    virtual bool readLine(char* line, int maxLen) = 0;
+
+    /**
+     * @brief Go back to the start of the log.
+     *
+     * @return false The source cannot be rewound
+     */
+    virtual bool rewind() { return false; };
+};
+
+/**
+ * @brief Reads lines from a log held in memory, e.g. a capture compiled into the firmware.
+ *
+ */
+class CANBufferLineSource : public CANLineSource {
+    const char* buffer;
+    const char* position;
+
+public:
+    CANBufferLineSource(const char* text) : buffer(text), position(text) {};
+
+    bool readLine(char* line, int maxLen) override;
+
+    bool rewind() override;
+};
+
+/**
+ * @brief Reads lines from a stream, e.g. a File on the SD card.
+ *
+ */
+class CANStreamLineSource : public CANLineSource {
+    Stream* stream;
+
+public:
+    CANStreamLineSource(Stream* istream) : stream(istream) {};
+
+    bool readLine(char* line, int maxLen) override;
+};
+
+enum class CANLogFormat {
+    Auto,    // decided by the first frame in the log
+    Candump, // candump -l, "(1436509052.249713) can0 123#DEADBEEF", or candump -ta
+    ASC,     // Vector ASCII logs, "0.012345 1 123 Rx d 8 DE AD BE EF 00 00 00 00"
+};
+
+enum class CANLogLine {
+    Frame,   // a classic CAN frame
+    Skipped, // a header, comment, CAN FD or error frame, or a frame on another channel
+    Error,   // a line which could not be parsed
+};
+
+/**
+ * @brief Parse one candump line.
+ *
+ * @param line The line to parse
+ * @param message The parsed frame
+ * @param timestamp_us The time the frame was recorded
+ * @param channel The interface the frame was recorded on, nullptr for any
+ */
+CANLogLine parseCandumpLine(const char* line, CANMessage& message, uint64_t& timestamp_us, const char* channel = nullptr);
+
+/**
+ * @brief Parse one line of a Vector ASC log. Header lines, error frames and CAN FD frames are not parsed.
+ *
+ * @param line The line to parse
+ * @param message The parsed frame
+ * @param timestamp_us The time the frame was recorded
+ * @param channel The channel number the frame was recorded on, nullptr for any
+ * @param hexIDs Whether IDs are written in hex, as set by the "base" header line
+ */
+CANLogLine parseASCLine(const char* line, CANMessage& message, uint64_t& timestamp_us, const char* channel = nullptr, bool hexIDs = true);
+
+/**
+ * @brief Statistics of a replay so far.
+ *
+ */
+struct CANReplayStats {
+    uint32_t frames = 0;       // frames posted to subscribers
+    uint32_t skippedLines = 0; // headers, comments and frames on other channels
+    uint32_t parseErrors = 0;  // lines which looked like frames but could not be parsed
+    uint32_t late = 0;         // frames posted more than a millisecond after they were due
+    uint32_t sent = 0;         // frames sent to the controller, which go nowhere
+    uint64_t recorded_us = 0;  // log time covered
+    uint64_t elapsed_us = 0;   // real time taken
+    uint64_t ingest_us = 0;    // time spent parsing and dispatching, excluding waiting for frames to be due
+};
+
+/**
+ * @brief A CAN controller which plays back a recorded log instead of receiving from hardware.
+ * Devices subscribe to it like any other controller, and frames are posted from the replay task at the time they were
+ * recorded, a multiple of it, or as fast as they can be parsed. This is allocated statically, so MUST be in global scope.
+ *
+ */
+class CANReplayController : public AbstractCANController {
+    CANLineSource* source = nullptr;
+    CANLogFormat format = CANLogFormat::Auto;
+    const char* channel = nullptr;
+    bool hexIDs = true;
+
+    float speed = 1.0f;
+    bool looping = false;
+
+    StaticTask<CAN_REPLAY_TASK_STACK_DEPTH> task;
+    CANReplayStats stats;
+    volatile bool finished = false;
+
+    void loop();
+
+    /**
+     * @brief Parse a line in the log's format, detecting the format if needed.
+     *
+     */
+    CANLogLine parseLine(const char* line, CANMessage& message, uint64_t& timestamp_us);
+
+public:
+    /**
+     * @brief Set the log to replay. Must be called before init.
+     *
+     * @param isource Where to read the log from
+     * @param iformat The format of the log
+     * @param ichannel Only replay frames recorded on this channel, nullptr for all
+     */
+    void set_source(CANLineSource* isource, CANLogFormat iformat = CANLogFormat::Auto, const char* ichannel = nullptr);
+
+    /**
+     * @brief Set the replay speed. 1 replays at the recorded timing, 10 ten times faster, and 0 as fast as possible.
+     *
+     */
+    void set_speed(float ispeed);
+
+    /**
+     * @brief Start the log again once the end is reached, if the source can be rewound.
+     *
+     */
+    void set_looping(bool iloop);
+
+    /**
+     * @brief Start the replay.
+     *
+     */
+    void init(uint32_t task_priority) override;
+
+    /**
+     * @brief The log decides the timing, so this does nothing.
+     *
+     */
+    void set_baud_rate(const uint32_t baud_rate) override;
+
+    /**
+     * @brief There is nothing to send to, so sent frames are only counted.
+     *
+     */
+    bool send(CANMessage const& message) override;
+
+    CANReplayStats get_replay_stats();
+
+    /**
+     * @brief Whether the end of the log has been reached.
+     *
+     */
+    bool is_finished();
+};
+
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "can/CANSignalStore.hpp"
+#include "rtos/rtos.hpp"
+
+// The maximum number of signal stores a monitor can watch
+#define CAN_SIGNAL_MONITOR_MAX_STORES 4
+
+// The maximum number of signals in a watched store
+#define CAN_SIGNAL_MONITOR_MAX_SIGNALS 128
+
+// The maximum number of queues a monitor can send events to
+#define CAN_SIGNAL_MONITOR_MAX_SUBSCRIBERS 4
+
+// How often the stores are scanned, in ms. Staleness is noticed at most this late.
+#define CAN_SIGNAL_MONITOR_PERIOD_MS 10
+
+#define CAN_SIGNAL_EVENT_QUEUE_LENGTH 32
+
+// The log queue only holds pointers, so event messages are written into a ring of this many buffers. A message is
+// only overwritten once this many more events have been logged.
+#define CAN_SIGNAL_MONITOR_LOG_MESSAGES 32
+#define CAN_SIGNAL_MONITOR_LOG_MESSAGE_LENGTH 64
+
+// Stack depth in words of the scan task
+#define CAN_SIGNAL_MONITOR_TASK_STACK_DEPTH TASK_STACK_DEPTH_DEFAULT
+
+namespace wrvcu {
+
+/**
+ * @brief A signal becoming stale, or fresh again.
+ *
+ */
+struct CANSignalEvent {
+    const CANSignalStoreBase* store;
+    int signal;            // the signal's index in the store
+    bool stale;            // true if the signal has timed out, false if it has arrived again
+    uint32_t timestamp_ms; // when the scan noticed
+};
+
+/**
+ * @brief Scans signal stores in the background and reports signals timing out, so consumers don't each need to poll
+ * every signal they use. Signals start stale, and only report going fresh, so a node which never talks raises no events,
+ * but its signals are counted by getStaleSignals. Each scan holds the mutex the store's owner decodes under while it reads the store.
+ *
+ */
+class CANSignalMonitor {
+    const CANSignalStoreBase* stores[CAN_SIGNAL_MONITOR_MAX_STORES];
+    Mutex* mutexes[CAN_SIGNAL_MONITOR_MAX_STORES];
+    uint32_t fresh[CAN_SIGNAL_MONITOR_MAX_STORES][CAN_SIGNAL_MONITOR_MAX_SIGNALS / 32] = { { 0 } };
+    int numStores = 0;
+
+    Queue<CANSignalEvent, CAN_SIGNAL_EVENT_QUEUE_LENGTH>* subscribers[CAN_SIGNAL_MONITOR_MAX_SUBSCRIBERS];
+    int numSubscribers = 0;
+
+    uint32_t staleEvents = 0;
+    uint32_t staleSignals = 0;
+
+    char logMessages[CAN_SIGNAL_MONITOR_LOG_MESSAGES][CAN_SIGNAL_MONITOR_LOG_MESSAGE_LENGTH];
+    int nextLogMessage = 0;
+
+    StaticTask<CAN_SIGNAL_MONITOR_TASK_STACK_DEPTH> task;
+
+    void loop();
+
+    /**
+     * @brief Scan a store, raising events for the signals which changed since the last scan.
+     *
+     * @return uint32_t The number of the store's signals which aren't fresh
+     */
+    uint32_t scan(int store, uint32_t now_ms);
+
+    const char* formatLogMessage(const char* event, const char* name);
+
+    void post(CANSignalEvent const& event);
+
+public:
+    /**
+     * @brief Watch a signal store. Must be called before init.
+     *
+     * @param store The store
+     * @param mutex The mutex the store's owner holds while decoding into it
+     * @return true The store is watched
+     * @return false The monitor is watching too many stores, or the store has too many signals
+     */
+    bool watch(const CANSignalStoreBase* store, Mutex* mutex);
+
+    /**
+     * @brief Send every event to a queue. Must be called before init. Events are dropped if the queue is full.
+     *
+     * @return true The queue is subscribed
+     * @return false The monitor has too many subscribers
+     */
+    bool subscribe(Queue<CANSignalEvent, CAN_SIGNAL_EVENT_QUEUE_LENGTH>* queue);
+
+    void init(uint32_t task_priority);
+
+    /**
+     * @brief Get the number of times a signal has gone stale since init.
+     *
+     */
+    uint32_t getStaleEvents();
+
+    /**
+     * @brief Get the number of watched signals which weren't fresh at the last scan, including those which have never
+     * arrived.
+     *
+     */
+    uint32_t getStaleSignals();
+};
+
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "can/CANMessage.hpp"
+#include <cstdint>
+
+namespace wrvcu {
+
+/**
+ * @brief The latest value of a decoded signal.
+ *
+ */
+struct CANSignal {
+    float value = 0;           // in the signal's DBC unit, with scale and offset applied
+    uint32_t timestamp_ms = 0; // when the frame carrying the signal last arrived
+    bool received = false;     // whether the frame has ever arrived, as 0 is a valid timestamp
+};
+
+/**
+ * @brief Generated description of a signal.
+ *
+ */
+struct CANSignalInfo {
+    const char* name;   // "Message.Signal", as in the DBC
+    uint32_t period_ms; // the frame's GenMsgCycleTime, 0 if it isn't sent periodically
+};
+
+/**
+ * @brief Generated decoder for one frame, writing every signal in the frame into a signal store.
+ *
+ */
+typedef void (*CANFrameDecodeFn)(const uint8_t* data, CANSignal* signals, uint32_t timestamp_ms);
+
+struct CANFrameDecoder {
+    uint32_t id;
+    CANFrameDecodeFn decode;
+};
+
+/**
+ * @brief Find the decoder for a frame in a generated table, which is sorted by ID.
+ *
+ * @return const CANFrameDecoder* The decoder, or nullptr if the table has none for the ID
+ */
+inline const CANFrameDecoder* findFrameDecoder(const CANFrameDecoder* decoders, int numDecoders, uint32_t id) {
+    int lo = 0;
+    int hi = numDecoders;
+
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (decoders[mid].id < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return (lo < numDecoders && decoders[lo].id == id) ? &decoders[lo] : nullptr;
+}
+
+// A signal is stale once its frame has missed this many periods
+#define CAN_SIGNAL_TIMEOUT_PERIODS 3
+
+/**
+ * @brief The part of a signal store which doesn't depend on the number of signals, so code like CANSignalMonitor can
+ * look at stores from any DBC.
+ *
+ */
+class CANSignalStoreBase {
+protected:
+    CANSignal* signals;
+    int numSignals;
+
+    const CANFrameDecoder* decoders;
+    int numDecoders;
+
+    const CANSignalInfo* info;
+
+    CANSignalStoreBase(CANSignal* isignals, int inumSignals, const CANFrameDecoder* idecoders, int inumDecoders, const CANSignalInfo* iinfo)
+        : signals(isignals), numSignals(inumSignals), decoders(idecoders), numDecoders(inumDecoders), info(iinfo) {};
+
+public:
+    /**
+     * @brief Decode a frame into the store.
+     *
+     * @param message The frame
+     * @param timestamp_ms When the frame arrived
+     * @return true The frame was decoded
+     * @return false The DBC has no such frame
+     */
+    bool decode(CANMessage const& message, uint32_t timestamp_ms) {
+        const CANFrameDecoder* decoder = findFrameDecoder(decoders, numDecoders, message.id);
+        if (decoder == nullptr) {
+            return false;
+        }
+
+        decoder->decode(message.data, signals, timestamp_ms);
+        return true;
+    }
+
+    /**
+     * @brief Get the latest value of a signal.
+     *
+     */
+    float get(int signal) const {
+        return signals[signal].value;
+    }
+
+    /**
+     * @brief Get the latest value of a signal, with when it arrived.
+     *
+     */
+    CANSignal getSignal(int signal) const {
+        return signals[signal];
+    }
+
+    /**
+     * @brief Check a signal has arrived, and hasn't missed CAN_SIGNAL_TIMEOUT_PERIODS of its frame's period.
+     * Signals in frames with no cycle time in the DBC are fresh once they have arrived.
+     *
+     * @param signal The signal's index
+     * @param now_ms The current time, on the same clock as the timestamps passed to decode
+     */
+    bool isFresh(int signal, uint32_t now_ms) const {
+        if (!signals[signal].received) {
+            return false;
+        }
+
+        uint32_t period_ms = info[signal].period_ms;
+        return period_ms == 0 || now_ms - signals[signal].timestamp_ms <= period_ms * CAN_SIGNAL_TIMEOUT_PERIODS;
+    }
+
+    const CANSignalInfo& getInfo(int signal) const {
+        return info[signal];
+    }
+
+    int getNumSignals() const {
+        return numSignals;
+    }
+
+    int getNumDecoders() const {
+        return numDecoders;
+    }
+
+    /**
+     * @brief Get the ID of a frame in the table, in order of ID.
+     *
+     */
+    uint32_t getDecoderID(int index) const {
+        return decoders[index].id;
+    }
+};
+
+/**
+ * @brief Holds the latest value of every signal in a DBC, decoded with the tables generated from it by dbc_registry.py.
+ * Decoding a frame is a lookup in the frame table and a call to the frame's decoder, so adding a message to the DBC
+ * needs no code. Signals are read by the indices generated alongside the tables, e.g. BATTERY_BMS_BATT_STATUS_SO_C_SIGNAL.
+ *
+ * @tparam NUM_SIGNALS The number of signals in the DBC, e.g. BATTERY_NUM_SIGNALS
+ */
+template <int NUM_SIGNALS>
+class CANSignalStore : public CANSignalStoreBase {
+    CANSignal storage[NUM_SIGNALS];
+
+public:
+    CANSignalStore(const CANFrameDecoder* idecoders, int inumDecoders, const CANSignalInfo* iinfo)
+        : CANSignalStoreBase(storage, NUM_SIGNALS, idecoders, inumDecoders, iinfo) {};
+};
+
+}
@@ -0,0 +1,338 @@
+#pragma once
+
+#include <can/CANFDMessage.hpp>
+#include <can/CANMessage.hpp>
+#include <algorithm>
+#include <cstdint>
+
+namespace wrvcu {
+
+/**
+ * @brief Traffic statistics for one received CAN ID.
+ *
+ */
+struct CANIdStats {
+    uint32_t frames = 0;
+    uint32_t bytes = 0;            // data bytes, not counting the frame overhead
+    uint32_t drops = 0;            // frames which never reached the subscriber
+    uint32_t lastTimestamp_us = 0; // when the last frame arrived
+    uint32_t minInterval_us = UINT32_MAX;
+    uint32_t maxInterval_us = 0;
+    uint64_t totalInterval_us = 0;
+
+    void add(uint8_t len, uint32_t rx_us) {
+        if (frames > 0) {
+            uint32_t interval = rx_us - lastTimestamp_us;
+
+            totalInterval_us += interval;
+            if (interval < minInterval_us)
+                minInterval_us = interval;
+            if (interval > maxInterval_us)
+                maxInterval_us = interval;
+        }
+
+        frames++;
+        bytes += len;
+        lastTimestamp_us = rx_us;
+    }
+
+    uint32_t avgInterval_us() const {
+        return frames > 1 ? (uint32_t)(totalInterval_us / (frames - 1)) : 0;
+    }
+};
+
+/**
+ * @brief A running summary of latencies, such as the time from a frame arriving in the receive interrupt to it being
+ * dispatched to its subscriber.
+ *
+ */
+struct CANLatencyStats {
+    uint32_t count = 0;
+    uint32_t min_us = UINT32_MAX;
+    uint32_t max_us = 0;
+    uint64_t total_us = 0;
+
+    void add(uint32_t latency_us) {
+        count++;
+        total_us += latency_us;
+        min_us = std::min(min_us, latency_us);
+        max_us = std::max(max_us, latency_us);
+    }
+
+    uint32_t avg_us() const {
+        return count > 0 ? (uint32_t)(total_us / count) : 0;
+    }
+};
+
+/**
+ * @brief The fault confinement state of a CAN controller, from its error counters.
+ *
+ */
+enum class CANFaultState {
+    ErrorActive = 0,
+    ErrorPassive = 1,
+    BusOff = 2
+};
+
+/**
+ * @brief The controller's own view of bus errors.
+ *
+ */
+struct CANErrorCounters {
+    uint8_t txErrors = 0; // transmit error counter, TEC
+    uint8_t rxErrors = 0; // receive error counter, REC
+    CANFaultState state = CANFaultState::ErrorActive;
+    uint8_t errorFlags = 0;  // errors seen since the last read, see CAN_ERROR_FLAG_*
+    uint32_t errorReads = 0; // reads which found at least one error flag set
+};
+
+#define CAN_ERROR_FLAG_STUFF (1 << 0)
+#define CAN_ERROR_FLAG_FORM (1 << 1)
+#define CAN_ERROR_FLAG_CRC (1 << 2)
+#define CAN_ERROR_FLAG_ACK (1 << 3)
+#define CAN_ERROR_FLAG_BIT0 (1 << 4)
+#define CAN_ERROR_FLAG_BIT1 (1 << 5)
+
+/**
+ * @brief Count the bits a frame takes on the bus, including stuff bits and the inter-frame space.
+ * The stuffed part of the frame (start of frame to the end of the CRC) is built bit by bit and the CRC15 computed over
+ * it, so the stuff bits are exact for the frame's actual ID and data rather than a worst case estimate.
+ *
+ * @param msg The frame
+ * @return uint32_t The number of bit times the frame occupies
+ */
+inline uint32_t canFrameBits(CANMessage const& msg) {
+    uint8_t dataLen = msg.flags.remote ? 0 : (msg.len > 8 ? 8 : msg.len);
+
+    // 1 + 29 + 3 + 3 + 4 + 64 + 15 bits at most
+    uint8_t bits[128];
+    int n = 0;
+
+    auto push = [&](uint32_t value, int width) {
+        for (int i = width - 1; i >= 0; i--) {
+            bits[n++] = (value >> i) & 1;
+        }
+    };
+
+    push(0, 1); // start of frame
+    if (msg.flags.extended) {
+        push(msg.id >> 18, 11);
+        push(1, 1); // SRR
+        push(1, 1); // IDE
+        push(msg.id & 0x3ffff, 18);
+        push(msg.flags.remote, 1);
+        push(0, 2); // r1, r0
+    } else {
+        push(msg.id, 11);
+        push(msg.flags.remote, 1);
+        push(0, 2); // IDE, r0
+    }
+    push(msg.len, 4);
+    for (int i = 0; i < dataLen; i++) {
+        push(msg.data[i], 8);
+    }
+
+    uint16_t crc = 0;
+    for (int i = 0; i < n; i++) {
+        bool crcNext = bits[i] ^ ((crc >> 14) & 1);
+        crc = (crc << 1) & 0x7fff;
+        if (crcNext)
+            crc ^= 0x4599;
+    }
+    push(crc, 15);
+
+    // a stuff bit follows every 5 identical bits, and itself starts the next run
+    int stuffBits = 0;
+    int run = 1;
+    uint8_t last = bits[0];
+    for (int i = 1; i < n; i++) {
+        if (bits[i] == last) {
+            run++;
+        } else {
+            last = bits[i];
+            run = 1;
+        }
+
+        if (run == 5) {
+            stuffBits++;
+            last = !last;
+            run = 1;
+        }
+    }
+
+    // CRC delimiter, ACK slot, ACK delimiter, end of frame and inter-frame space are never stuffed
+    return n + stuffBits + 1 + 1 + 1 + 7 + 3;
+}
+
+/**
+ * @brief Estimate the bits a frame takes on the bus from its format and length alone, leaving out stuff bits. Cheap
+ * enough for the controllers to count every frame they send and receive; canFrameBits() walks the frame for the exact
+ * count, and is for simulation and off-line use. Stuffing adds a few percent on typical traffic and at most about a
+ * fifth, so loads counted this way read slightly low.
+ *
+ * @param msg The frame
+ * @return uint32_t The number of bit times the frame occupies, without stuff bits
+ */
+inline uint32_t canFrameBitsNominal(CANMessage const& msg) {
+    // SOF to the end of the CRC, then CRC delimiter, ACK slot, ACK delimiter, end of frame and inter-frame space
+    static const uint8_t standardBits[9] = { 47, 55, 63, 71, 79, 87, 95, 103, 111 };
+    static const uint8_t extendedBits[9] = { 67, 75, 83, 91, 99, 107, 115, 123, 131 };
+
+    uint8_t dataLen = msg.flags.remote ? 0 : (msg.len > 8 ? 8 : msg.len);
+    return msg.flags.extended ? extendedBits[dataLen] : standardBits[dataLen];
+}
+
+/**
+ * @brief Count the time a CAN FD frame takes on the bus, in bit times at the nominal (arbitration) rate.
+ * The dynamically stuffed part (start of frame to the end of the data) is built bit by bit so its stuff bits are exact.
+ * The CRC field has a fixed stuff bit every 4 bits regardless of its value, so the CRC itself is not needed.
+ * With bit rate switching the bits from ESI to the end of the CRC are sent at the data rate and scaled down to match.
+ *
+ * @param msg The frame
+ * @param nominalRate The arbitration bit rate
+ * @param dataRate The data phase bit rate
+ * @return uint32_t The number of nominal bit times the frame occupies
+ */
+inline uint32_t canFDFrameBits(CANFDMessage const& msg, uint32_t nominalRate, uint32_t dataRate) {
+    uint8_t dlc = canfdLenToDLC(msg.len);
+    uint8_t dataLen = canfdDLCToLen(dlc);
+
+    // 1 + 29 + 8 + 4 + 512 bits at most
+    uint8_t bits[560];
+    int n = 0;
+
+    auto push = [&](uint32_t value, int width) {
+        for (int i = width - 1; i >= 0; i--) {
+            bits[n++] = (value >> i) & 1;
+        }
+    };
+
+    push(0, 1); // start of frame
+    if (msg.flags.extended) {
+        push(msg.id >> 18, 11);
+        push(1, 1); // SRR
+        push(1, 1); // IDE
+        push(msg.id & 0x3ffff, 18);
+        push(0, 1); // RRS
+    } else {
+        push(msg.id, 11);
+        push(0, 1); // RRS
+        push(0, 1); // IDE
+    }
+    push(1, 1); // FDF
+    push(0, 1); // res
+    int arbitrationEnd = n;
+    push(msg.flags.brs, 1);
+    push(msg.flags.esi, 1);
+    push(dlc, 4);
+    for (int i = 0; i < dataLen; i++) {
+        push(i < msg.len ? msg.data[i] : 0, 8);
+    }
+
+    // stuff bits, counted separately for the nominal and data rate parts of the frame
+    int nominalStuff = 0;
+    int dataStuff = 0;
+    int run = 1;
+    uint8_t last = bits[0];
+    for (int i = 1; i < n; i++) {
+        if (bits[i] == last) {
+            run++;
+        } else {
+            last = bits[i];
+            run = 1;
+        }
+
+        if (run == 5) {
+            if (i <= arbitrationEnd) {
+                nominalStuff++;
+            } else {
+                dataStuff++;
+            }
+            last = !last;
+            run = 1;
+        }
+    }
+
+    // stuff count and CRC, with a fixed stuff bit at the start and after every 4 bits
+    int crcBits = 4 + (dataLen <= 16 ? 17 : 21);
+    crcBits += 1 + (crcBits - 1) / 4;
+
+    // SOF to res, and BRS itself, are at the nominal rate; ESI to the end of the CRC at the data rate
+    uint32_t nominalBits = arbitrationEnd + 1 + nominalStuff;
+    uint32_t dataBits = (n - arbitrationEnd - 1) + dataStuff + crcBits;
+
+    // CRC delimiter, ACK slot, ACK delimiter, end of frame and inter-frame space
+    nominalBits += 1 + 1 + 1 + 7 + 3;
+
+    if (!msg.flags.brs || dataRate == 0) {
+        return nominalBits + dataBits;
+    }
+    return nominalBits + (uint32_t)((uint64_t)dataBits * nominalRate / dataRate);
+}
+
+/**
+ * @brief Estimate the time a CAN FD frame takes on the bus from its format and length alone, in bit times at the
+ * nominal rate. Only the dynamic stuff bits are left out, as in canFrameBitsNominal(); the fixed stuff bits of the CRC
+ * field are counted. canFDFrameBits() gives the exact count.
+ *
+ * @param msg The frame
+ * @param nominalRate The arbitration bit rate
+ * @param dataRate The data phase bit rate
+ * @return uint32_t The number of nominal bit times the frame occupies, without dynamic stuff bits
+ */
+inline uint32_t canFDFrameBitsNominal(CANFDMessage const& msg, uint32_t nominalRate, uint32_t dataRate) {
+    uint8_t dataLen = canfdDLCToLen(canfdLenToDLC(msg.len));
+
+    int crcBits = 4 + (dataLen <= 16 ? 17 : 21);
+    crcBits += 1 + (crcBits - 1) / 4;
+
+    // SOF to res, and BRS, then CRC delimiter, ACK slot, ACK delimiter, end of frame and inter-frame space
+    uint32_t nominalBits = (msg.flags.extended ? 35 : 16) + 1 + 13;
+    // ESI, DLC, data and CRC
+    uint32_t dataBits = 1 + 4 + 8 * dataLen + crcBits;
+
+    if (!msg.flags.brs || dataRate == 0) {
+        return nominalBits + dataBits;
+    }
+    return nominalBits + (uint32_t)((uint64_t)dataBits * nominalRate / dataRate);
+}
+
+/**
+ * @brief Turns a running count of bus bits into a load figure. Each consumer keeps its own meter, and the load is
+ * averaged over the time between its samples.
+ *
+ */
+class CANBusLoadMeter {
+    uint32_t lastBits = 0;
+    uint32_t last_us = 0;
+    bool started = false;
+
+public:
+    /**
+     * @brief Measure the bus load since the last sample.
+     *
+     * @param totalBits The controller's running count of bits, from get_bus_bits()
+     * @param now_us The current time in microseconds
+     * @param baudRate The bus bit rate
+     * @return uint16_t The bus load in tenths of a percent, 0 on the first sample
+     */
+    uint16_t sample(uint32_t totalBits, uint32_t now_us, uint32_t baudRate) {
+        uint32_t bits = totalBits - lastBits;
+        uint32_t elapsed_us = now_us - last_us;
+        bool first = !started;
+
+        lastBits = totalBits;
+        last_us = now_us;
+        started = true;
+
+        if (first || elapsed_us == 0 || baudRate == 0) {
+            return 0;
+        }
+
+        // bit times available in the interval = elapsed_us * baudRate / 1e6
+        uint64_t load = (uint64_t)bits * 1000 * 1000000 / ((uint64_t)elapsed_us * baudRate);
+        return load > 1000 ? 1000 : (uint16_t)load;
+    }
+};
+
+}
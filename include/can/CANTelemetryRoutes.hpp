@@ -0,0 +1,17 @@
+#pragma once
+
+#include "can/CANGateway.hpp"
+
+namespace wrvcu {
+
+/**
+ * @brief Add the car's routes forwarding powertrain telemetry to the telemetry bus. Shared by the firmware, the host
+ * build and the gateway test, so they all forward the same frames.
+ *
+ * @param gateway The gateway to add the routes to, before the scheduler starts
+ * @param powertrain The bus the inverter, BMS and IVT are on
+ * @param telemetry The bus the loggers are on
+ */
+void addTelemetryRoutes(CANGateway* gateway, AbstractCANController* powertrain, AbstractCANController* telemetry);
+
+}
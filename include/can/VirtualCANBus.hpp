@@ -0,0 +1,169 @@
+#pragma once
+
+#include "can/AbstractCANController.hpp"
+#include "rtos/rtos.hpp"
+
+// The maximum number of controllers on one virtual bus
+#define VIRTUAL_CAN_MAX_NODES 8
+
+// Frames each virtual controller buffers waiting to win arbitration
+#define VIRTUAL_CAN_TX_QUEUE_SIZE 64
+
+#define VIRTUAL_CAN_DEFAULT_BIT_RATE 500000
+
+// Stack depth in words of the bus task
+#define VIRTUAL_CAN_TASK_STACK_DEPTH TASK_STACK_DEPTH_DEFAULT
+
+namespace wrvcu {
+
+class VirtualCANBus;
+
+/**
+ * @brief A CAN controller attached to a VirtualCANBus instead of hardware. Devices use it like any other controller.
+ * Received frames are posted from the bus task, which plays the part of the CAN task.
+ *
+ */
+class VirtualCANController : public AbstractCANController {
+    friend class VirtualCANBus;
+
+    VirtualCANBus* bus = nullptr;
+    Queue<CANMessage, VIRTUAL_CAN_TX_QUEUE_SIZE> txQueue;
+
+    uint32_t txDropped = 0;
+    uint32_t arbitrationLosses = 0;
+
+    /**
+     * @brief Called by the bus when another node's frame has been sent.
+     *
+     */
+    void receive(CANMessage const& message, uint32_t rx_us);
+
+public:
+    /**
+     * @brief Start the controller. The controller must be attached to a bus first.
+     *
+     */
+    void init(uint32_t task_priority) override;
+
+    /**
+     * @brief The bit rate is set on the bus, so this only records it.
+     *
+     */
+    void set_baud_rate(const uint32_t baud_rate) override;
+
+    /**
+     * @brief Queue a message to be sent once it wins arbitration. Never blocks.
+     *
+     * @param message The message to send
+     * @return bool Whether the message was queued, false if the queue was full
+     */
+    bool send(CANMessage const& message) override;
+
+    /**
+     * @brief Get the number of frames dropped because the transmit queue was full.
+     *
+     */
+    uint32_t get_tx_dropped();
+
+    /**
+     * @brief Get the number of times this controller's next frame lost arbitration to another node's.
+     *
+     */
+    uint32_t get_arbitration_losses();
+};
+
+/**
+ * @brief Bus-wide statistics.
+ *
+ */
+struct VirtualCANBusStats {
+    uint32_t frames = 0;       // frames sent by attached controllers
+    uint32_t fillerFrames = 0; // frames of simulated background load
+    uint64_t bits = 0;         // bit times used, including stuff bits and the inter-frame space
+    uint64_t busTime_us = 0;   // simulated time since the bus started
+};
+
+/**
+ * @brief An in-process CAN bus connecting VirtualCANControllers. This is allocated statically, so MUST be in global scope.
+ * Whenever the bus is free, the pending frame with the lowest ID across all controllers wins arbitration, takes the
+ * time its bits need at the bus bit rate, and is then received by every other controller.
+ * Background load can be simulated with filler frames which compete for the bus like any other traffic.
+ *
+ */
+class VirtualCANBus {
+    VirtualCANController* nodes[VIRTUAL_CAN_MAX_NODES];
+    int numNodes = 0;
+
+    uint32_t bitRate = VIRTUAL_CAN_DEFAULT_BIT_RATE;
+    float timeScale = 1.0f;
+
+    // filler frames for background load
+    float fillerLoad = 0;
+    uint16_t fillerID = 0x7ff;
+    uint64_t nextFiller_us = 0;
+
+    VirtualCANBusStats stats;
+
+    StaticTask<VIRTUAL_CAN_TASK_STACK_DEPTH> task;
+
+    void loop();
+
+    /**
+     * @brief Pick the frame which wins arbitration, counting the losses of every other node with a frame waiting.
+     *
+     * @return int The index of the winning node, -1 for a filler frame, or -2 if nothing is waiting
+     */
+    int arbitrate(uint64_t now_us);
+
+    /**
+     * @brief The frame which is compared in arbitration. The base ID is sent first, and on equal base IDs a standard
+     * frame beats an extended one, as its IDE bit is dominant.
+     *
+     */
+    static uint32_t arbitrationKey(CANMessage const& message);
+
+public:
+    /**
+     * @brief Attach a controller to the bus. Must be called before the controller's init.
+     *
+     */
+    void attach(VirtualCANController* controller);
+
+    /**
+     * @brief Set the bus bit rate. Any rate can be used, including faster than real CAN. Must be called before init.
+     *
+     */
+    void setBitRate(uint32_t rate);
+
+    /**
+     * @brief Set how fast bus time runs relative to real time. 1 is real time, 2 twice as fast, and 0 as fast as possible.
+     *
+     */
+    void setTimeScale(float scale);
+
+    /**
+     * @brief Simulate other traffic on the bus.
+     *
+     * @param load The fraction of bus time taken by filler frames, from 0 to 1
+     * @param id The ID filler frames are sent with, which decides which traffic they beat in arbitration
+     */
+    void setBackgroundLoad(float load, uint16_t id);
+
+    /**
+     * @brief Start the bus.
+     *
+     */
+    void init(uint32_t task_priority);
+
+    /**
+     * @brief Wake the bus to arbitrate new frames. Called by controllers when they queue a frame.
+     *
+     */
+    void notify();
+
+    uint32_t getBitRate();
+
+    VirtualCANBusStats getStats();
+};
+
+}
@@ -8,11 +8,14 @@
 #define TRACTIVE_SYSTEM_TASK_PRIORITY (TASK_PRIORITY_DEFAULT + 2)
 #define BATTERY_TASK_PRIORITY (TASK_PRIORITY_DEFAULT + 1)
 #define CANOPEN_HOST_TASK_PRIORITY (TASK_PRIORITY_DEFAULT)
+#define CAN_SIGNAL_MONITOR_TASK_PRIORITY (TASK_PRIORITY_DEFAULT)
 #define DISPLAY_TASK_PRIORITY (TASK_PRIORITY_DEFAULT - 1)
 #define IMU_TASK_PRIORITY (TASK_PRIORITY_DEFAULT)
 // #define DATALOGGER_TASK_PRIORITY (TASK_PRIORITY_DEFAULT)
 #define DISTANCE_TASK_PRIORITY (TASK_PRIORITY_DEFAULT - 2)
 
+#define TS_PERIOD 10 // ms, the tractive system loop
+
 #define INVERTER_SEND_PERIOD 500
 #define BMS_NMT_SEND_PERIOD 500
 
@@ -80,6 +83,7 @@
 #define INV_CW_SUBINDEX 0x00
 
 #define ADC_FREQUENCY 1000000
+#define ADC_NUM_CHANNELS 4 // on the MAX22530, swept together once a TS cycle
 
 #define APPS1_CHANNEL 0
 #define APPS1_ANGLE_OFFSET 174.4
@@ -99,11 +103,15 @@
 #define APPS_START_FRACTION 0.1
 #define APPS_END_FRACTION 0.9
 
+// The pedals are sampled once per TS cycle, so the moving averages are sized in time. 60 ms smooths ADC noise and
+// pedal chatter, while its 30 ms lag is well inside APPS_TIMEOUT.
 #define APPS_USE_SMOOTH true
-#define APPS_WINDOW 6
+#define APPS_FILTER_TIME 60 // ms
+#define APPS_WINDOW (APPS_FILTER_TIME / TS_PERIOD)
 
 #define BRAKE_USE_SMOOTH true
-#define BRAKE_WINDOW 6
+#define BRAKE_FILTER_TIME 60 // ms
+#define BRAKE_WINDOW (BRAKE_FILTER_TIME / TS_PERIOD)
 
 #define MAX_APPS_REGEN_FRACTION 0.15
 #define MAX_ACCELERATION_REGEN_FRACTION 1.0
@@ -12,6 +12,13 @@ public:
     void init(bool crc_enable);
     int read(int channel);
 
+    /**
+     * @brief Read every channel under one hold of the bus, so they're sampled together.
+     *
+     * @param counts Where the ADC_NUM_CHANNELS readings go, indexed by channel
+     */
+    void readAll(uint16_t* counts);
+
 protected:
     MAX22530 adc;
     Mutex mutex;
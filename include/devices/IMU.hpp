@@ -5,13 +5,16 @@
 #include <MPU6050_light.h>
 #include <Wire.h>
 
+// Stack depth in words of the IMU task
+#define IMU_TASK_STACK_DEPTH TASK_STACK_DEPTH_DEFAULT
+
 namespace wrvcu {
 
 class IMU {
 protected:
     MPU6050 mpu6050;
     Mutex mutex;
-    Task task;
+    StaticTask<IMU_TASK_STACK_DEPTH> task;
 
     float accX, accY, accZ, gyroX, gyroY, gyroZ;
     void printData();
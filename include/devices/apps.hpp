@@ -8,7 +8,7 @@ namespace wrvcu {
 
 class APPS {
 protected:
-    uint16_t window_total = 0;
+    uint32_t window_total = 0; // wide enough for any window of 12-bit samples
     int window_index = 0;             // the index of the current reading
     uint16_t window_array[APPS_WINDOW];     // the window_array from the analog input
 
@@ -19,23 +19,29 @@ protected:
     float angle_offset;
     float angle_range;
 
-    ADC* adc;
-
     int adc_channel;
 
 public:
-    void init(ADC* adc_o, int adc_chan, float angle_offset_o, float angle_range_o);
+    void init(int adc_chan, float angle_offset_o, float angle_range_o);
+
+    int getChannel();
 
-    uint16_t read();
+    /**
+     * @brief Add a reading to the moving average, once per sample.
+     *
+     * @param val ADC counts as read
+     * @return The smoothed counts, which the rest of the functions convert
+     */
+    uint16_t filter(uint16_t val);
 
-    float getVoltage();
-    float getAngle();
-    float getSaturatedFraction();
-    float getProcessedAngle();
+    float getVoltage(uint16_t counts);
+    float getAngle(uint16_t counts);
+    float getSaturatedFraction(uint16_t counts);
+    float getProcessedAngle(uint16_t counts);
 
-    float getRegenFraction();
+    float getRegenFraction(uint16_t counts);
 
-    bool isConnected();
+    bool isConnected(uint16_t counts);
 };
 
 }
\ No newline at end of file
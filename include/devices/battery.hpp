@@ -1,10 +1,36 @@
 #pragma once
 
 #include "battery.h"
+#include "battery_signals.hpp"
 #include "can/CANOpenDevice.hpp"
+#include "can/CANSignalMonitor.hpp"
+#include "can/CANSignalStore.hpp"
 #include "pins.hpp"
+#include "rtos/mailbox.hpp"
 #include "rtos/mutex.hpp"
 
+// The signals the rest of the car reads from the battery
+#define BATTERY_MAX_DISCHARGE_CURRENT BATTERY_BMS_AVAIL_CURRENT_MAX_DISCHARGE_SIGNAL      // Amps
+#define BATTERY_MAX_CHARGE_CURRENT BATTERY_BMS_AVAIL_CURRENT_MAX_CHARGE_SIGNAL            // Amps
+#define BATTERY_CHARGE_REMAINING BATTERY_BMS_BATT_STATUS_Q_REMAIN_NOM_SIGNAL              // Ah
+#define BATTERY_SOC BATTERY_BMS_BATT_STATUS_SO_C_SIGNAL                                   // %
+#define BATTERY_STATUS BATTERY_BMS_BATT_STATUS_STATUS_SIGNAL                              // ContactorStates
+#define BATTERY_CELL_AVG_TEMP BATTERY_BMS_CELL_STATUS_TEMPERATURES_AVG_CELL_TEMP_SIGNAL   // deg C
+#define BATTERY_CELL_MAX_TEMP BATTERY_BMS_CELL_STATUS_TEMPERATURES_MAX_CELL_TEMP_SIGNAL   // deg C
+#define BATTERY_CELL_MIN_TEMP BATTERY_BMS_CELL_STATUS_TEMPERATURES_MIN_CELL_TEMP_SIGNAL   // deg C
+#define BATTERY_CELL_AVG_VOLTAGE BATTERY_BMS_CELL_STATUS_VOLTAGES_AVG_CELL_VOLTAGE_SIGNAL // mV
+#define BATTERY_CELL_MAX_VOLTAGE BATTERY_BMS_CELL_STATUS_VOLTAGES_MAX_CELL_VOLTAGE_SIGNAL // mV
+#define BATTERY_CELL_MIN_VOLTAGE BATTERY_BMS_CELL_STATUS_VOLTAGES_MIN_CELL_VOLTAGE_SIGNAL // mV
+#define BATTERY_IMD_ISO_RES BATTERY_IMD_INFO_IMD_R_ISO_SIGNAL                             // kOhms
+#define BATTERY_TERMINAL_CURRENT BATTERY_IVT_MSG_RESULT_I_IVT_RESULT_I_SIGNAL             // Amps
+#define BATTERY_PACK_VOLTAGE BATTERY_IVT_MSG_RESULT_U1_IVT_RESULT_U1_SIGNAL               // Volts
+#define BATTERY_PRE_FUSE_VOLTAGE BATTERY_IVT_MSG_RESULT_U2_IVT_RESULT_U2_SIGNAL           // Volts
+#define BATTERY_POST_FUSE_VOLTAGE BATTERY_IVT_MSG_RESULT_U3_IVT_RESULT_U3_SIGNAL          // Volts
+#define BATTERY_POWER BATTERY_IVT_MSG_RESULT_W_IVT_RESULT_W_SIGNAL                        // Watts
+
+// Stack depth in words of the battery task
+#define BATTERY_TASK_STACK_DEPTH TASK_STACK_DEPTH_DEFAULT
+
 namespace wrvcu {
 
 enum class ContactorStates {
@@ -19,9 +45,13 @@ class Battery {
 protected:
     AbstractCANController* can;
 
-    Queue<CANMessage, 256> canQueue;
+    // Every BMS and IVT frame carries state, so only the latest of each is kept
+    Mailbox<CANMessage> canMailboxes[BATTERY_NUM_DECODED_FRAMES];
+    uint32_t lastSequence[BATTERY_NUM_DECODED_FRAMES] = { 0 };
+
+    CANSignalStore<BATTERY_NUM_SIGNALS> signals{ battery_frame_decoders, BATTERY_NUM_DECODED_FRAMES, battery_signal_info };
 
-    Task task;
+    StaticTask<BATTERY_TASK_STACK_DEPTH> task;
 
     Mutex mutex;
     bool enable = false;
@@ -34,32 +64,37 @@ protected:
     void updateState(uint8_t status);
 
 public:
-    float maxDischargeCurrent = 0; // Amps
-    float maxChargeCurrent = 0;    // Amps
-
     ContactorStates contactorState = ContactorStates::Init;
-    float chargeRemaining = 0; // Ah
-    float SoC = 0;             // %
-    // float voltsSumOfCells = 0; // ignore
-
-    float cellAvgTemp = 0; // deg C
-    float cellMaxTemp = 0; // deg C
-    float cellMinTemp = 0; // deg C
-
-    float cellAvgVoltage = 0; // mV
-    float cellMaxVoltage = 0; // mV
-    float cellMinVoltage = 0; // mV
-
-    float imdIsoRes = 0; // kOhms
-
-    float terminalCurrent = 0; // Amps
-    float packVoltage = 0;     // Volts
-    float preFuseVoltage = 0;  // Volts
-    float postFuseVoltage = 0; // Volts
-    float power = 0;           // Watts
 
     void init(AbstractCANController* ican);
 
+    /**
+     * @brief Get the latest value of a signal from the BMS or IVT.
+     *
+     * @param signal The signal, e.g. BATTERY_PACK_VOLTAGE, or any signal generated from battery.dbc
+     */
+    float get(int signal);
+
+    /**
+     * @brief Get the latest value of a signal from the BMS or IVT, with when it arrived.
+     *
+     */
+    CANSignal getSignal(int signal);
+
+    /**
+     * @brief Check a signal from the BMS or IVT is still arriving at its DBC cycle time.
+     *
+     */
+    bool isFresh(int signal);
+
+    /**
+     * @brief Have a monitor watch every signal, under the mutex the battery decodes with.
+     *
+     * @return true The monitor is watching the signals
+     * @return false The monitor has no room for them
+     */
+    bool watchSignals(CANSignalMonitor* monitor);
+
     void closeContactors();
     void openContactors();
 };
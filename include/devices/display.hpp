@@ -24,11 +24,14 @@
 #include "rtos/mutex.hpp"
 #include "rtos/task.hpp"
 
+// Stack depth in words of the display task
+#define DISPLAY_TASK_STACK_DEPTH TASK_STACK_DEPTH_DEFAULT
+
 namespace wrvcu {
 
 class Display {
 protected:
-    Task task;
+    StaticTask<DISPLAY_TASK_STACK_DEPTH> task;
     Mutex mutex;
     void writeVar_16Bit(byte PacketAddress, byte lByte, byte hByte);
     void writeVar_128Bit(byte PacketAddress1, byte PacketAddress2, String DisplayText);
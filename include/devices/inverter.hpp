@@ -3,6 +3,9 @@
 #include "can/CANOpenDevice.hpp"
 #include "rtos/mutex.hpp"
 
+// Stack depth in words of the inverter task
+#define INVERTER_TASK_STACK_DEPTH TASK_STACK_DEPTH_DEFAULT
+
 namespace wrvcu {
 
 enum class InverterStates {
@@ -20,10 +23,10 @@ protected:
     CANOpenDevice device;
     uint8_t nodeID;
 
-    Queue<PDOMessage, 256> pdoQueue;
-    Queue<SDOMessage, 256> sdoQueue;
+    SPSCQueue<CANFrameRef, 256> pdoQueue;
+    SPSCQueue<SDOMessage, 256> sdoQueue;
 
-    Task task;
+    StaticTask<INVERTER_TASK_STACK_DEPTH> task;
 
     Mutex mutex;
     bool enable = false;
@@ -1,11 +1,30 @@
 #pragma once
 
 #include "apps.hpp"
+#include "rtos/mailbox.hpp"
 
 namespace wrvcu {
 
+/**
+ * @brief The pedal sensors as sampled once in a TS cycle, in ADC counts after smoothing. Every check in that cycle reads
+ * the same snapshot, and it's posted for other tasks, e.g. the CAN logger, to read.
+ *
+ */
+struct PedalSnapshot {
+    uint16_t apps1 = 0;
+    uint16_t apps2 = 0;
+    uint16_t brakePressure1 = 0;
+    uint16_t brakePressure2 = 0;
+    float throttleFraction = 0; // as getThrottleFraction
+};
+
 class ThrottleManager {
 protected:
+    ADC* adc = nullptr;
+
+    PedalSnapshot snapshot;
+    Mailbox<PedalSnapshot> snapshots;
+
     bool plausibilityTimerStarted = false;
     ulong currentAPPSMillis = 0;
     ulong prevAPPSMillis = 0;
@@ -20,9 +39,11 @@ protected:
 
     float lastAPPSFraction = 0;
 
-    uint16_t brake_1_window_total = 0;
+    uint32_t brake_1_window_total = 0; // wide enough for any window of 12-bit samples
     int brake_1_window_index = 0;               // the index of the current reading
-    uint16_t brake_1_window_array[APPS_WINDOW]; // the window_array from the analog input
+    uint16_t brake_1_window_array[BRAKE_WINDOW]; // the window_array from the analog input
+
+    uint16_t filterBrakePressure1(uint16_t val);
 
     void checkAPPSConnected();
     void checkAPPSPlausibility();
@@ -43,6 +64,20 @@ public:
     bool brakePlausibilityError = false;
     bool hardBrakeError = false;
 
+    /**
+     * @brief Sweep the ADC once and take a new snapshot, which every function below reads until the next sample. Call
+     * once a cycle, from the TS task, before any of the checks.
+     *
+     */
+    void sample();
+
+    /**
+     * @brief Get the latest snapshot from any task.
+     *
+     * @return false if nothing has been sampled yet
+     */
+    bool getLatestSnapshot(PedalSnapshot& out);
+
     float getTorqueRequestFraction();
     float getBrakeRegenFraction();
     bool brakesOn();
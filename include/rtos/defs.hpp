@@ -19,6 +19,12 @@
 // The minimal stack size for a task.
 #define TASK_STACK_DEPTH_MIN configMINIMAL_STACK_SIZE
 
+// The maximum number of tasks listed by Task::print_stack_report
+#define TASK_MAX_REPORTED 32
+
+// The space in a Task for the callable it is started with, in bytes. Enough for a lambda capturing four pointers.
+#define TASK_FUNCTION_SIZE (4 * sizeof(void*))
+
 // The maximum number of characters allowed in a task's name.
 // #define TASK_NAME_MAX_LEN 32
 #define TASK_NAME_MAX_LEN configMAX_TASK_NAME_LEN
@@ -38,6 +44,14 @@ typedef void (*task_fn_t)(void*);
  */
 void startScheduler();
 
+/**
+ * @brief Block the calling task for a time which needn't be a whole number of ticks. The target's tick is the finest
+ * a task can sleep, so there the remainder is spent waiting on the CPU; the host wakes the task on the microsecond.
+ *
+ * @param us The time to wait in microseconds
+ */
+void delayMicros(uint32_t us);
+
 /**
  * @brief Checks whether a pointer is on the stack.
  *
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "rtos/defs.hpp"
+#include <cstdint>
+#include <memory>
+
+namespace wrvcu {
+
+/**
+ * @brief A thread-safe single-slot mailbox holding the latest value of some state. This is allocated statically, so MUST be in global scope. This MUST NOT be created inside a function.
+ * Posting overwrites the previous value, so readers always see the freshest value and never have a backlog to drain.
+ * Each value is stamped with a sequence number and the time it was posted, so readers can tell whether it has changed since they last looked.
+ * Intended for a single writer, such as the CAN task.
+ *
+ * @tparam T The type of the value
+ */
+template <typename T>
+class Mailbox {
+public:
+    /**
+     * @brief A value with its sequence number and timestamp.
+     *
+     */
+    struct Item {
+        T value;
+        uint32_t sequence;  // 1 for the first value posted, incrementing with each post
+        uint32_t timestamp; // milliseconds since the scheduler started, when the value was posted
+    };
+
+private:
+    QueueHandle_t queue;
+    StaticQueue_t staticQueue;
+    uint8_t queueStorageArea[sizeof(Item)];
+
+    volatile uint32_t sequence = 0;
+
+public:
+    Mailbox() = default;
+
+    /**
+     * @brief Initialises the mailbox. This must be called before use.
+     *
+     */
+    void init() {
+        if (isOnStack((void*)this)) {
+            printf("WARNING: Static mailbox allocated on the stack! This WILL cause severe problems.\n");
+            configASSERT(0); // assert error
+        } else {
+            /* ok*/
+        };
+
+        queue = xQueueCreateStatic(1, sizeof(Item), queueStorageArea, &staticQueue);
+
+        if (queue == NULL) {
+            printf("Mailbox was not created!\n");
+            configASSERT(queue);
+        } else { // ok
+        };
+    }
+
+    /**
+     * Replace the value in the mailbox. Never blocks.
+     * \param value
+     *      The new value, which is copied into the mailbox.
+     */
+    void post(T const& value) {
+        sequence++;
+        Item item = { value, sequence, pdTICKS_TO_MS(xTaskGetTickCount()) };
+        xQueueOverwrite(queue, &item);
+    }
+
+    /**
+     * Replace the value in the mailbox from an interrupt service routine.
+     * \param value
+     *      The new value, which is copied into the mailbox.
+     */
+    void postFromISR(T const& value) {
+        BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+        sequence++;
+        Item item = { value, sequence, pdTICKS_TO_MS(xTaskGetTickCountFromISR()) };
+        xQueueOverwriteFromISR(queue, &item, &higherPriorityTaskWoken);
+
+        portYIELD_FROM_ISR(higherPriorityTaskWoken);
+    }
+
+    /**
+     * Read the latest value without removing it.
+     * \param item
+     *      Where the value, sequence number and timestamp are copied to.
+     * \param timeout
+     *      Time to wait for a first value to be posted. A timeout of 0 can be used to read without blocking. TIMEOUT_MAX can be used to block indefinitely.
+     *
+     * \return true if there was a value, false if nothing has been posted yet
+     */
+    bool read(Item& item, uint32_t timeout) {
+        return xQueuePeek(queue, &item, pdMS_TO_TICKS(timeout));
+    }
+
+    /**
+     * Read the latest value only if it is newer than one already seen.
+     * \param item
+     *      Where the value, sequence number and timestamp are copied to.
+     * \param lastSequence
+     *      The sequence number of the last value seen, or 0 if none has been.
+     *
+     * \return true if there was a newer value, false otherwise
+     */
+    bool readIfNewer(Item& item, uint32_t lastSequence) {
+        if (sequence == lastSequence) {
+            return false;
+        }
+
+        return read(item, 0) && item.sequence != lastSequence;
+    }
+
+    /**
+     * Get the sequence number of the latest value.
+     *
+     * \return the sequence number, or 0 if nothing has been posted yet
+     */
+    uint32_t getSequence() {
+        return sequence;
+    }
+};
+
+} // namespace wrvcu
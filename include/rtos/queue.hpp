@@ -1,5 +1,6 @@
 #pragma once
 
+#include "rtos/defs.hpp"
 #include <cstdint>
 #include <memory>
 
@@ -94,6 +95,177 @@ public:
         return item;
     };
 
+    /**
+     * Get an item from the queue, reporting whether there was one.
+     * \param item
+     *      Where the received item is copied to.
+     * \param timeout
+     *      Time to wait for an item to become available. A timeout of 0 can be used to attempt to receive without blocking. TIMEOUT_MAX can be used to block indefinitely.
+     *
+     * \return true if an item was received, false if the timeout expired
+     */
+    bool dequeue(T& item, uint32_t timeout) {
+        return xQueueReceive(queue, &item, pdMS_TO_TICKS(timeout));
+    };
+
+    /**
+     * Get up to n items from the queue. Only the first item is waited for, the rest are taken if already queued.
+     * The scheduler is suspended while the rest are taken, so a sender woken by the space is switched to once per
+     * batch rather than once per item, and nothing checks size() first.
+     * \param out
+     *      Where the received items are copied to, with room for n items.
+     * \param n
+     *      The maximum number of items to receive.
+     * \param timeout
+     *      Time to wait for the first item to become available. A timeout of 0 can be used to attempt to receive without blocking. TIMEOUT_MAX can be used to block indefinitely.
+     *
+     * \return the number of items received, 0 if the timeout expired
+     */
+    int dequeueMany(T* out, int n, uint32_t timeout) {
+        if (n <= 0 || !xQueueReceive(queue, &out[0], pdMS_TO_TICKS(timeout))) {
+            return 0;
+        }
+
+        int received = 1;
+
+        vTaskSuspendAll();
+        while (received < n && xQueueReceive(queue, &out[received], 0)) {
+            received++;
+        }
+        xTaskResumeAll();
+
+        return received;
+    };
+
+    /**
+     * Post up to n items to the end of a queue, in order. Items that fit are posted with the scheduler suspended, so a
+     * receiver is switched to once per batch rather than once per item. Only an item which doesn't fit waits for space.
+     * \param items
+     *      The items to post, which are queued by copy.
+     * \param n
+     *      The number of items to post.
+     * \param timeout
+     *      Time to wait for space for each item that doesn't fit. A timeout of 0 can be used to attempt to post without blocking. TIMEOUT_MAX can be used to block indefinitely.
+     *
+     * \return the number of items enqueued, from the start of items
+     */
+    int enqueueMany(T const* items, int n, uint32_t timeout) {
+        int sent = 0;
+
+        while (sent < n) {
+            vTaskSuspendAll();
+            while (sent < n && xQueueSendToBack(queue, &items[sent], 0)) {
+                sent++;
+            }
+            xTaskResumeAll();
+
+            // full, so wait for space with the scheduler running
+            if (sent < n) {
+                if (timeout == 0 || !xQueueSendToBack(queue, &items[sent], pdMS_TO_TICKS(timeout))) {
+                    break;
+                }
+                sent++;
+            }
+        }
+
+        return sent;
+    };
+
+    /**
+     * Remove every item currently in the queue, passing each to a callback. Items are taken in batches of BATCH with
+     * dequeueMany, and the callback is run outside the batch, so it may block.
+     * \param callback
+     *      Called with each item, in order.
+     * \param timeout
+     *      Time to wait for the first item to become available. A timeout of 0 can be used to drain without blocking. TIMEOUT_MAX can be used to block indefinitely.
+     *
+     * \return the number of items drained
+     */
+    template <int BATCH = 8, typename F>
+    int drainInto(F&& callback, uint32_t timeout = 0) {
+        T batch[BATCH];
+        int drained = 0;
+
+        int received = dequeueMany(batch, BATCH, timeout);
+        while (received > 0) {
+            for (int i = 0; i < received; i++) {
+                callback(batch[i]);
+            }
+            drained += received;
+
+            if (received < BATCH) {
+                break; // the queue was emptied
+            }
+            received = dequeueMany(batch, BATCH, 0);
+        }
+
+        return drained;
+    };
+
+    /**
+     * Post an item to the end of a queue from an interrupt service routine. Never blocks.
+     * \param item
+     *      A reference to the item that will be placed on the queue.
+     *
+     * \return true if the item was enqueued, false if the queue was full
+     */
+    bool enqueueFromISR(T const& item) {
+        BaseType_t higherPriorityTaskWoken = pdFALSE;
+        bool sent = xQueueSendToBackFromISR(queue, &item, &higherPriorityTaskWoken);
+
+        portYIELD_FROM_ISR(higherPriorityTaskWoken);
+        return sent;
+    };
+
+    /**
+     * Post up to n items to the end of a queue from an interrupt service routine, yielding at most once. Never blocks.
+     *
+     * \return the number of items enqueued, from the start of items
+     */
+    int enqueueManyFromISR(T const* items, int n) {
+        BaseType_t higherPriorityTaskWoken = pdFALSE;
+        int sent = 0;
+
+        while (sent < n && xQueueSendToBackFromISR(queue, &items[sent], &higherPriorityTaskWoken)) {
+            sent++;
+        }
+
+        portYIELD_FROM_ISR(higherPriorityTaskWoken);
+        return sent;
+    };
+
+    /**
+     * Get an item from the queue from an interrupt service routine. Never blocks.
+     * \param item
+     *      Where the received item is copied to.
+     *
+     * \return true if an item was received, false if the queue was empty
+     */
+    bool dequeueFromISR(T& item) {
+        BaseType_t higherPriorityTaskWoken = pdFALSE;
+        bool received = xQueueReceiveFromISR(queue, &item, &higherPriorityTaskWoken);
+
+        portYIELD_FROM_ISR(higherPriorityTaskWoken);
+        return received;
+    };
+
+    /**
+     * Get up to n items from the queue from an interrupt service routine, yielding at most once. Never blocks.
+     *
+     * \return the number of items received
+     */
+    int dequeueManyFromISR(T* out, int n) {
+        BaseType_t higherPriorityTaskWoken = pdFALSE;
+        int received = 0;
+
+        while (received < n && xQueueReceiveFromISR(queue, &out[received], &higherPriorityTaskWoken)) {
+            received++;
+        }
+
+        portYIELD_FROM_ISR(higherPriorityTaskWoken);
+        return received;
+    };
+
     /**
      * Get the number of items stored in the queue
      *
@@ -3,7 +3,9 @@
 // Most of this code is just a wrapper around FreeRTOS functions
 
 #include "rtos/defs.hpp"
+#include "rtos/mailbox.hpp"
 #include "rtos/mutex.hpp"
 #include "rtos/queue.hpp"
 #include "rtos/semaphore.hpp"
+#include "rtos/spsc_queue.hpp"
 #include "rtos/task.hpp"
@@ -0,0 +1,301 @@
+#pragma once
+
+#include "rtos/defs.hpp"
+#include <atomic>
+#include <cstdint>
+
+namespace wrvcu {
+
+/**
+ * @brief A wait-free queue between exactly one producer task and one consumer task. This is allocated statically, so MUST be in global scope. This MUST NOT be created inside a function.
+ * Has the same interface as Queue, so can replace one wherever a single task sends and a single task receives, e.g.
+ * CANOpenDevice to Inverter. Sending and receiving are a copy and an atomic index update, with no critical section.
+ * A task that has to wait blocks on its task notification, and is woken by the other side only when it is waiting.
+ * Waiting uses the task's notification value, so a task blocking on an SPSCQueue must not wait on notifications for anything else.
+ *
+ * @tparam T The type of the queue items
+ * @tparam LEN The length of the queue, which must be a power of 2
+ */
+template <typename T, int LEN>
+class SPSCQueue {
+    static_assert(LEN > 0 && (LEN & (LEN - 1)) == 0, "SPSCQueue length must be a power of 2");
+
+    T buffer[LEN];
+
+    // free running, so head - tail is the number of items, even when they wrap
+    std::atomic<uint32_t> head{ 0 }; // written by the producer
+    std::atomic<uint32_t> tail{ 0 }; // written by the consumer
+
+    // the task blocked on each side, if any
+    std::atomic<TaskHandle_t> waitingProducer{ nullptr };
+    std::atomic<TaskHandle_t> waitingConsumer{ nullptr };
+
+    static void wake(std::atomic<TaskHandle_t>& waiter) {
+        TaskHandle_t task = waiter.load();
+        if (task != nullptr) {
+            xTaskNotifyGive(task);
+        }
+    }
+
+    static void wakeFromISR(std::atomic<TaskHandle_t>& waiter, BaseType_t* higherPriorityTaskWoken) {
+        TaskHandle_t task = waiter.load();
+        if (task != nullptr) {
+            vTaskNotifyGiveFromISR(task, higherPriorityTaskWoken);
+        }
+    }
+
+    /**
+     * @brief Block until ready() or the timeout. The waiter is published before ready() is checked again, so a wake
+     * from the other side between the two can't be missed.
+     *
+     */
+    template <typename F>
+    static bool wait(std::atomic<TaskHandle_t>& waiter, F&& ready, uint32_t timeout) {
+        if (ready()) {
+            return true;
+        }
+        if (timeout == 0) {
+            return false;
+        }
+
+        TimeOut_t timeOut;
+        TickType_t ticks = pdMS_TO_TICKS(timeout);
+        if (timeout == TIMEOUT_MAX) {
+            ticks = portMAX_DELAY;
+        }
+        vTaskSetTimeOutState(&timeOut);
+
+        waiter.store(xTaskGetCurrentTaskHandle());
+
+        bool ok = ready();
+        while (!ok && xTaskCheckForTimeOut(&timeOut, &ticks) == pdFALSE) {
+            ulTaskNotifyTake(pdTRUE, ticks);
+            ok = ready();
+        }
+
+        waiter.store(nullptr);
+        return ok;
+    }
+
+    bool push(T const& item) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= (uint32_t)LEN) {
+            return false;
+        }
+
+        buffer[h & (LEN - 1)] = item;
+        head.store(h + 1);
+        return true;
+    }
+
+    bool pop(T& item) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (head.load(std::memory_order_acquire) == t) {
+            return false;
+        }
+
+        item = buffer[t & (LEN - 1)];
+        tail.store(t + 1);
+        return true;
+    }
+
+public:
+    SPSCQueue() = default;
+
+    /**
+     * @brief Initialises the queue. This must be called before use.
+     *
+     */
+    void init() {
+        if (isOnStack((void*)this)) {
+            printf("WARNING: Static SPSC queue allocated on the stack! This WILL cause severe problems.\n");
+            configASSERT(0); // assert error
+        } else {
+            /* ok*/
+        };
+
+        reset();
+    }
+
+    /**
+     * Posts an item to the end of the queue. Only the producer task may call this.
+     * \param item
+     *      A reference to the item that will be placed on the queue.
+     * \param timeout
+     *      Time to wait for space to become available. A timeout of 0 can be used to attempt to post without blocking. TIMEOUT_MAX can be used to block indefinitely.
+     *
+     * \return true if the item was enqueued, false otherwise
+     */
+    bool enqueue(T const& item, uint32_t timeout) {
+        auto hasSpace = [this] { return head.load(std::memory_order_relaxed) - tail.load() < (uint32_t)LEN; };
+        if (!wait(waitingProducer, hasSpace, timeout)) {
+            return false;
+        }
+
+        push(item);
+        wake(waitingConsumer);
+        return true;
+    }
+
+    /**
+     * Posts an item to the end of the queue from an interrupt service routine, when the ISR is the producer. Never blocks.
+     *
+     * \return true if the item was enqueued, false if the queue was full
+     */
+    bool enqueueFromISR(T const& item) {
+        BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+        bool sent = push(item);
+        if (sent) {
+            wakeFromISR(waitingConsumer, &higherPriorityTaskWoken);
+        }
+
+        portYIELD_FROM_ISR(higherPriorityTaskWoken);
+        return sent;
+    }
+
+    /**
+     * Post up to n items to the end of the queue, in order, waking the consumer once. Only the producer task may call this.
+     * \param timeout
+     *      Time to wait for space for each item that doesn't fit. A timeout of 0 can be used to attempt to post without blocking. TIMEOUT_MAX can be used to block indefinitely.
+     *
+     * \return the number of items enqueued, from the start of items
+     */
+    int enqueueMany(T const* items, int n, uint32_t timeout) {
+        int sent = 0;
+
+        while (sent < n) {
+            while (sent < n && push(items[sent])) {
+                sent++;
+            }
+            wake(waitingConsumer);
+
+            // full, so wait for space
+            if (sent < n) {
+                if (!enqueue(items[sent], timeout)) {
+                    break;
+                }
+                sent++;
+            }
+        }
+
+        return sent;
+    }
+
+    /**
+     * Get an item from the queue, reporting whether there was one. Only the consumer task may call this.
+     * \param item
+     *      Where the received item is copied to.
+     * \param timeout
+     *      Time to wait for an item to become available. A timeout of 0 can be used to attempt to receive without blocking. TIMEOUT_MAX can be used to block indefinitely.
+     *
+     * \return true if an item was received, false if the timeout expired
+     */
+    bool dequeue(T& item, uint32_t timeout) {
+        auto hasItem = [this] { return head.load() != tail.load(std::memory_order_relaxed); };
+        if (!wait(waitingConsumer, hasItem, timeout)) {
+            return false;
+        }
+
+        pop(item);
+        wake(waitingProducer);
+        return true;
+    }
+
+    /**
+     * Get an item from the queue. Only the consumer task may call this.
+     * \param timeout
+     *      Time to wait for an item to become available. A timeout of 0 can be used to attempt to receive without blocking. TIMEOUT_MAX can be used to block indefinitely.
+     *
+     * \return the received item
+     */
+    T dequeue(uint32_t timeout) {
+        T item;
+        dequeue(item, timeout);
+        return item;
+    }
+
+    /**
+     * Get an item from the queue from an interrupt service routine, when the ISR is the consumer. Never blocks.
+     *
+     * \return true if an item was received, false if the queue was empty
+     */
+    bool dequeueFromISR(T& item) {
+        BaseType_t higherPriorityTaskWoken = pdFALSE;
+
+        bool received = pop(item);
+        if (received) {
+            wakeFromISR(waitingProducer, &higherPriorityTaskWoken);
+        }
+
+        portYIELD_FROM_ISR(higherPriorityTaskWoken);
+        return received;
+    }
+
+    /**
+     * Get up to n items from the queue, waking the producer once. Only the first item is waited for. Only the consumer task may call this.
+     * \param timeout
+     *      Time to wait for the first item to become available. A timeout of 0 can be used to attempt to receive without blocking. TIMEOUT_MAX can be used to block indefinitely.
+     *
+     * \return the number of items received, 0 if the timeout expired
+     */
+    int dequeueMany(T* out, int n, uint32_t timeout) {
+        if (n <= 0 || !dequeue(out[0], timeout)) {
+            return 0;
+        }
+
+        int received = 1;
+        while (received < n && pop(out[received])) {
+            received++;
+        }
+        wake(waitingProducer);
+
+        return received;
+    }
+
+    /**
+     * Remove every item currently in the queue, passing each to a callback. Only the consumer task may call this.
+     * Items are popped one at a time, so unlike Queue::drainInto there is no batch copy.
+     * \param timeout
+     *      Time to wait for the first item to become available. A timeout of 0 can be used to drain without blocking. TIMEOUT_MAX can be used to block indefinitely.
+     *
+     * \return the number of items drained
+     */
+    template <typename F>
+    int drainInto(F&& callback, uint32_t timeout = 0) {
+        T item;
+        if (!dequeue(item, timeout)) {
+            return 0;
+        }
+
+        int drained = 0;
+        do {
+            callback(item);
+            drained++;
+        } while (pop(item));
+        wake(waitingProducer);
+
+        return drained;
+    }
+
+    /**
+     * Get the number of items stored in the queue
+     *
+     * \return the number of items in the queue
+     */
+    uint32_t size() {
+        return head.load() - tail.load();
+    }
+
+    /**
+     * Reset the queue to its original empty state. Neither side may be using the queue.
+     */
+    void reset() {
+        head.store(0);
+        tail.store(0);
+        waitingProducer.store(nullptr);
+        waitingConsumer.store(nullptr);
+    }
+};
+
+} // namespace wrvcu
@@ -1,13 +1,28 @@
 #pragma once
 
 #include "rtos/rtos.hpp"
+#include <cstddef>
 #include <cstdint>
-#include <memory>
+#include <new>
+#include <type_traits>
 
 namespace wrvcu {
 
 /**
- * @brief This is allocated statically, so MUST be in global scope. This MUST NOT be created inside a function.
+ * @brief A task's share of the CPU over a sample, see Task::sample_run_stats.
+ *
+ */
+struct TaskRunStats {
+    const char* name;
+    std::uint32_t load_permille; // time running over the sample, in tenths of a percent
+    std::uint32_t run_us;        // time running over the sample
+    std::uint32_t switches;      // times switched in over the sample
+    std::uint32_t maxRun_us;     // longest time running before switching out, over the sample
+};
+
+/**
+ * @brief A handle to a task, and the functions for controlling the current one. Tasks are started from a StaticTask,
+ * which holds the stack; a Task on its own, e.g. from Task::current(), has none, so start is only public on StaticTask.
  * A task executes within its own context with no coincidental dependency on other tasks within the system or the RTOS scheduler itself.
  * See the FreeRTOS website for more info (https://www.freertos.org/taskandcr.html).
  */
@@ -24,106 +39,19 @@ public:
      */
     Task(TaskHandle_t task);
 
-    /**
-     * Creates a new task and add it to the list of tasks that are ready to run.
-     *
-     * This function uses the following values of errno when an error state is
-     * reached:
-     * ENOMEM - The stack cannot be used as the TCB was not created.
-     *
-     * \param function
-     *        Pointer to the task entry function
-     * \param parameters
-     *        Pointer to memory that will be used as a parameter for the task
-     *        being created. This memory should not typically come from stack,
-     *        but rather from dynamically (i.e., malloc'd) or statically
-     *        allocated memory.
-     * \param prio
-     *        The priority at which the task should run.
-     *        TASK_PRIO_DEFAULT plus/minus 1 or 2 is typically used.
-     * \param name
-     *        A descriptive name for the task.  This is mainly used to facilitate
-     *        debugging. The name may be up to 32 characters long.
-     *
-     */
-    void start(task_fn_t function, void* parameters, uint32_t prio, const char* name);
-
-    /**
-     * Creates a new task and add it to the list of tasks that are ready to run.
-     *
-     * This function uses the following values of errno when an error state is
-     * reached:
-     * ENOMEM - The stack cannot be used as the TCB was not created.
-     *
-     * \param function
-     *        Pointer to the task entry function
-     * \param parameters
-     *        Pointer to memory that will be used as a parameter for the task
-     *        being created. This memory should not typically come from stack,
-     *        but rather from dynamically (i.e., malloc'd) or statically
-     *        allocated memory.
-     * \param name
-     *        A descriptive name for the task.  This is mainly used to facilitate
-     *        debugging. The name may be up to 32 characters long.
-     *
-     */
-    void start(task_fn_t function, void* parameters, const char* name);
-
-    /**
-     * Creates a new task and add it to the list of tasks that are ready to run.
-     *
-     * This function uses the following values of errno when an error state is
-     * reached:
-     * ENOMEM - The stack cannot be used as the TCB was not created.
-     *
-     * \param function
-     *        Callable object to use as entry function
-     * \param prio
-     *        The priority at which the task should run.
-     *        TASK_PRIO_DEFAULT plus/minus 1 or 2 is typically used.
-     * \param name
-     *        A descriptive name for the task.  This is mainly used to facilitate
-     *        debugging. The name may be up to 32 characters long.
-     *
-     */
-    template <class F>
-    void start(F&& function, uint32_t prio, const char* name) {
-        // Wizardry from https://github.com/purduesigbots/pros/blob/1e7513d4f110d2eac625b6300dbbb8c086ab6c0c/include/pros/rtos.hpp#L107
-        static_assert(std::is_invocable_r_v<void, F>);
-
-        start( // Create task with a lambda that executes a function given through a parameter.
-            [](void* parameters) {
-                std::unique_ptr<std::function<void()>> ptr{ static_cast<std::function<void()>*>(parameters) };
-                (*ptr)();
-            },
-            new std::function<void()>(std::forward<F>(function)), prio, name);
-    }
-
-    /**
-     * Creates a new task and add it to the list of tasks that are ready to run.
-     *
-     * This function uses the following values of errno when an error state is
-     * reached:
-     * ENOMEM - The stack cannot be used as the TCB was not created.
-     *
-     * \param function
-     *        Callable object to use as entry function
-     * \param name
-     *        A descriptive name for the task.  This is mainly used to facilitate
-     *        debugging. The name may be up to 32 characters long.
-     *
-     */
-    template <class F>
-    void start(F&& function, const char* name) {
-        start(std::forward<F>(function), TASK_PRIORITY_DEFAULT, TASK_STACK_DEPTH_DEFAULT, name);
-    };
-
     /**
      * Sends a simple notification to task and increments the notification
      * counter.
      */
     void notify();
 
+    /**
+     * Sends a simple notification to task from an interrupt service routine,
+     * yielding on exit if the notified task has a higher priority than the one
+     * that was interrupted.
+     */
+    void notify_from_isr();
+
     /**
      * Waits for a notification to be nonzero.
      *
@@ -246,10 +174,177 @@ public:
      */
     std::uint32_t get_state();
 
+    /**
+     * Gets the size of the task's stack.
+     *
+     * \return The stack depth in words, or 0 if the task wasn't started from a StaticTask
+     */
+    std::uint32_t get_stack_depth();
+
+    /**
+     * Gets the least free stack the task has had since it started.
+     *
+     * \return The high water mark in words. The stack used at its deepest is the depth minus this.
+     */
+    std::uint32_t get_stack_high_water_mark();
+
+    /**
+     * Prints the stack depth and peak usage of every task started, one "STACK" line per task, for stack_report.py.
+     */
+    static void print_stack_report();
+
+    /**
+     * Samples the run time of every task started since the last sample, from the scheduler's trace hooks.
+     * Samples must be less than 2^32 CPU cycles apart, about 7 s at 600 MHz, or the load wraps.
+     * Time spent in interrupts and the kernel is charged to the task they interrupted.
+     * Every call starts a new sample, so only one task should take them; the firmware's is the CAN logging task.
+     *
+     * \param stats Filled with one entry per task, in start order
+     * \param maxStats The length of stats
+     *
+     * \return The number of entries filled
+     */
+    static int sample_run_stats(TaskRunStats* stats, int maxStats);
+
+    /**
+     * Samples the run time of every task and prints one "LOAD" line per task, and the total.
+     */
+    static void print_load_report();
+
+protected:
+    Task(StackType_t* istack, std::uint32_t istackDepth) : stack(istack), stackDepth(istackDepth){};
+
+    /**
+     * Creates a new task and add it to the list of tasks that are ready to run.
+     *
+     * This function uses the following values of errno when an error state is
+     * reached:
+     * ENOMEM - The stack cannot be used as the TCB was not created.
+     *
+     * \param function
+     *        Pointer to the task entry function
+     * \param parameters
+     *        Pointer to memory that will be used as a parameter for the task
+     *        being created. This memory should not typically come from stack,
+     *        but rather from dynamically (i.e., malloc'd) or statically
+     *        allocated memory.
+     * \param prio
+     *        The priority at which the task should run.
+     *        TASK_PRIO_DEFAULT plus/minus 1 or 2 is typically used.
+     * \param name
+     *        A descriptive name for the task.  This is mainly used to facilitate
+     *        debugging. The name may be up to 32 characters long.
+     *
+     */
+    void start(task_fn_t function, void* parameters, uint32_t prio, const char* name);
+
+    /**
+     * Creates a new task and add it to the list of tasks that are ready to run.
+     *
+     * This function uses the following values of errno when an error state is
+     * reached:
+     * ENOMEM - The stack cannot be used as the TCB was not created.
+     *
+     * \param function
+     *        Pointer to the task entry function
+     * \param parameters
+     *        Pointer to memory that will be used as a parameter for the task
+     *        being created. This memory should not typically come from stack,
+     *        but rather from dynamically (i.e., malloc'd) or statically
+     *        allocated memory.
+     * \param name
+     *        A descriptive name for the task.  This is mainly used to facilitate
+     *        debugging. The name may be up to 32 characters long.
+     *
+     */
+    void start(task_fn_t function, void* parameters, const char* name);
+
+    /**
+     * Creates a new task and add it to the list of tasks that are ready to run.
+     *
+     * This function uses the following values of errno when an error state is
+     * reached:
+     * ENOMEM - The stack cannot be used as the TCB was not created.
+     *
+     * \param function
+     *        Callable object to use as entry function
+     * \param prio
+     *        The priority at which the task should run.
+     *        TASK_PRIO_DEFAULT plus/minus 1 or 2 is typically used.
+     * \param name
+     *        A descriptive name for the task.  This is mainly used to facilitate
+     *        debugging. The name may be up to 32 characters long.
+     *
+     */
+    template <class F>
+    void start(F&& function, uint32_t prio, const char* name) {
+        typedef std::decay_t<F> Function;
+
+        static_assert(std::is_invocable_r_v<void, Function&>);
+        static_assert(sizeof(Function) <= TASK_FUNCTION_SIZE, "Task function captures too much to be stored in the Task, capture a pointer instead");
+        static_assert(alignof(Function) <= alignof(std::max_align_t), "Task function is over-aligned");
+        static_assert(std::is_trivially_destructible_v<Function>, "Task function must be trivially destructible, it is never destroyed");
+
+        // The callable is kept in the Task rather than on the heap, and the task entry is a plain function which
+        // calls it through the parameter
+        Function* stored = new (function_storage) Function(std::forward<F>(function));
+
+        start(
+            [](void* parameters) {
+                (*static_cast<Function*>(parameters))();
+            },
+            stored, prio, name);
+    }
+
+    /**
+     * Creates a new task and add it to the list of tasks that are ready to run.
+     *
+     * This function uses the following values of errno when an error state is
+     * reached:
+     * ENOMEM - The stack cannot be used as the TCB was not created.
+     *
+     * \param function
+     *        Callable object to use as entry function
+     * \param name
+     *        A descriptive name for the task.  This is mainly used to facilitate
+     *        debugging. The name may be up to 32 characters long.
+     *
+     */
+    template <class F>
+    void start(F&& function, const char* name) {
+        start(std::forward<F>(function), TASK_PRIORITY_DEFAULT, name);
+    };
+
 private:
-    TaskHandle_t task;
-    StackType_t stack[TASK_STACK_DEPTH_DEFAULT];
+    TaskHandle_t task = nullptr;
+    StackType_t* stack = nullptr;
+    std::uint32_t stackDepth = 0;
     StaticTask_t taskBuffer;
+
+    // the callable a task was started with, see start(F&&, ...)
+    alignas(std::max_align_t) unsigned char function_storage[TASK_FUNCTION_SIZE];
+};
+
+/**
+ * @brief A task with its stack. This is allocated statically, so MUST be in global scope. This MUST NOT be created inside a function.
+ * Size the stack from the task's measured peak, see Task::print_stack_report and stack_report.py.
+ *
+ * @tparam STACK_DEPTH The stack depth in words
+ */
+template <std::uint32_t STACK_DEPTH = TASK_STACK_DEPTH_DEFAULT>
+class StaticTask : public Task {
+    static_assert(STACK_DEPTH >= TASK_STACK_DEPTH_MIN, "Task stack is smaller than the FreeRTOS minimum");
+
+    StackType_t stackBuffer[STACK_DEPTH];
+
+public:
+    StaticTask() : Task(stackBuffer, STACK_DEPTH){};
+
+    using Task::start;
+
+    // the stack can't be shared
+    StaticTask(StaticTask const&) = delete;
+    StaticTask& operator=(StaticTask const&) = delete;
 };
 
 } // namespace wrvcu
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+
+// FreeRTOS trace hooks for per-task run time accounting, see Task::sample_run_stats.
+// This is included into every file, FreeRTOS included, by build_flags in platformio.ini, so it must stay plain C.
+// FreeRTOS.h only defines the trace macros if they aren't already defined.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void wrvcu_task_switched_in(void);
+void wrvcu_task_switched_out(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define traceTASK_SWITCHED_IN() wrvcu_task_switched_in()
+#define traceTASK_SWITCHED_OUT() wrvcu_task_switched_out()
@@ -27,11 +27,22 @@ for file_name in pathlib.Path("dbc").glob("*.dbc"):
         ]
     )
 
+    # signal store tables, see dbc_registry.py
+    subprocess.call(
+        [
+            sys.executable,
+            "dbc_registry.py",
+            "-o",
+            ".dbc_gen",
+            file_name,
+        ]
+    )
+
 env.BuildSources(
     os.path.join("$BUILD_DIR", ".dbc_gen"),
     os.path.join("$PROJECT_DIR", ".dbc_gen"),
 )
 
 env.Append(
-    CPPPATH=[".dbc_gen"],
+    CPPPATH=[".dbc_gen", "include"],
 )
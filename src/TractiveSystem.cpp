@@ -23,8 +23,14 @@ void TractiveSystem::loop() {
         // throttle.getTorqueRequestFraction();
         sdcIsClosed = checkSDC();
 
+        // one sweep of the pedal sensors, which every check this cycle reads
+        throttle.sample();
+
+        // contactorState is only as current as the last status frame from the BMS
+        bool bmsIsFresh = battery.isFresh(BATTERY_STATUS);
+
         // If the SDC opens, and the inverter is running, we want to shut down the inverter immediately.
-        if ((inverter.state == InverterStates::Drive) && (!sdcIsClosed || battery.contactorState == ContactorStates::Error)) {
+        if ((inverter.state == InverterStates::Drive) && (!sdcIsClosed || !bmsIsFresh || battery.contactorState == ContactorStates::Error)) {
             // vPortEnterCritical();
             inverter.stop();
             // vPortExitCritical();
@@ -36,6 +42,12 @@ void TractiveSystem::loop() {
             state = TSStates::Error;
         }
 
+        if (!bmsIsFresh && state != TSStates::Idle && state != TSStates::Error) {
+            battery.openContactors();
+            state = TSStates::Error;
+            ERROR("BMS status timed out with the tractive system active!");
+        }
+
         if (!sdcIsClosed) {
             battery.openContactors();
             if (state != TSStates::Error) {
@@ -52,7 +64,7 @@ void TractiveSystem::loop() {
 
         switch (state) {
         case TSStates::Idle:
-            if (battery.contactorState == ContactorStates::Ready && sdcIsClosed && tsasPressed()) {
+            if (battery.contactorState == ContactorStates::Ready && bmsIsFresh && sdcIsClosed && tsasPressed()) {
                 battery.closeContactors();
                 state = TSStates::CloseContactors;
                 contactorCloseStart = millis(); // record when we request contactors to close
@@ -127,19 +139,21 @@ void TractiveSystem::loop() {
 
         mutex.give();
 
-        Task::delay_until(&prev, 10);
+        Task::delay_until(&prev, TS_PERIOD);
     }
 }
 
 void TractiveSystem::DriveSequence() {
     int16_t InverterRequestedTorque = 0;
+
+    // the pedal checks run in getTorqueRequestFraction, so it's called every cycle or an error could never clear
+    float driveTorque = throttle.getTorqueRequestFraction();
+    float brakeTorque = throttle.getBrakeRegenFraction();
+
     if (throttle.isCriticalError()) {
         inverter.sendTorque(0); // Maybe a ramp down here. Necessary only if no load
     } else {
 
-        float driveTorque = throttle.getTorqueRequestFraction();
-        float brakeTorque = throttle.getBrakeRegenFraction();
-
         // int16_t maxDriveTorqueRequest = calculateMaxDriveTorque() / INVERTER_NM_PER_UNIT; // Positive
         // int16_t maxRegenTorqueRequest = calculateMaxRegenTorque() / INVERTER_NM_PER_UNIT; // Negative
 
@@ -276,9 +290,15 @@ float TractiveSystem::calculateMaxRegenTorque() {
         lastTime = Task::millis();
     }
 
+    // without current battery data there is no power limit to trust, so allow no regen
+    if (!battery.isFresh(BATTERY_PACK_VOLTAGE) || !battery.isFresh(BATTERY_TERMINAL_CURRENT) || !battery.isFresh(BATTERY_MAX_CHARGE_CURRENT)) {
+        tLimit = 0.0;
+        return -1.0 * tLimit;
+    }
+
     float inverterSpeed = inverter.rpm * RPM_TO_RADS_FACTOR;
-    float power = battery.packVoltage * battery.terminalCurrent; // positive current is regen
-    float powerLimit = battery.packVoltage * battery.maxChargeCurrent;
+    float power = battery.get(BATTERY_PACK_VOLTAGE) * battery.get(BATTERY_TERMINAL_CURRENT); // positive current is regen
+    float powerLimit = battery.get(BATTERY_PACK_VOLTAGE) * battery.get(BATTERY_MAX_CHARGE_CURRENT);
 
     // Don't divide by 0 or a negative number!
     if (inverter.rpm < REGEN_MIN_RPM) {
@@ -319,9 +339,15 @@ float TractiveSystem::calculateMaxDriveTorque() {
         lastTime = Task::millis();
     }
 
+    // without current battery data there is no power limit to trust, so allow no torque
+    if (!battery.isFresh(BATTERY_PACK_VOLTAGE) || !battery.isFresh(BATTERY_TERMINAL_CURRENT) || !battery.isFresh(BATTERY_MAX_DISCHARGE_CURRENT)) {
+        tLimit = 0.0;
+        return tLimit;
+    }
+
     float inverterSpeed = inverter.rpm * RPM_TO_RADS_FACTOR;
-    float power = battery.packVoltage * -battery.terminalCurrent; // negative current is drive
-    float powerLimit = battery.packVoltage * battery.maxDischargeCurrent;
+    float power = battery.get(BATTERY_PACK_VOLTAGE) * -battery.get(BATTERY_TERMINAL_CURRENT); // negative current is drive
+    float powerLimit = battery.get(BATTERY_PACK_VOLTAGE) * battery.get(BATTERY_MAX_DISCHARGE_CURRENT);
 
     // Don't divide by 0 or a negative number!
     if (inverter.rpm < 10) {
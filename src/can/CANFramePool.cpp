@@ -0,0 +1,54 @@
+#include "can/CANFramePool.hpp"
+
+namespace wrvcu {
+
+CANFramePool canFramePool;
+
+CANFramePool::CANFramePool() {
+    for (uint16_t i = 0; i < CAN_FRAME_POOL_SIZE; i++) {
+        refCounts[i] = 0;
+        freeSlots[i] = i;
+    }
+    numFree = CAN_FRAME_POOL_SIZE;
+}
+
+CANFrameRef CANFramePool::allocate() {
+    CANFrameRef ref;
+
+    taskENTER_CRITICAL();
+    if (numFree > 0) {
+        numFree--;
+        ref.slot = freeSlots[numFree];
+        refCounts[ref.slot] = 1;
+    } else {
+        exhaustedCount++;
+    }
+    taskEXIT_CRITICAL();
+
+    return ref;
+}
+
+void CANFramePool::retain(CANFrameRef ref) {
+    taskENTER_CRITICAL();
+    refCounts[ref.slot]++;
+    taskEXIT_CRITICAL();
+}
+
+void CANFramePool::release(CANFrameRef ref) {
+    if (!ref.isValid()) {
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    if (refCounts[ref.slot] > 0) {
+        refCounts[ref.slot]--;
+
+        if (refCounts[ref.slot] == 0) {
+            freeSlots[numFree] = ref.slot;
+            numFree++;
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+
+}
@@ -0,0 +1,88 @@
+#include "can/CANGateway.hpp"
+
+namespace wrvcu {
+
+void CANGateway::addRoute(AbstractCANController* source, uint32_t id, uint32_t mask, AbstractCANController* destination,
+    uint32_t minInterval_ms, int32_t remapOffset) {
+    if (numRoutes >= CAN_GATEWAY_MAX_ROUTES) {
+        printf("WARNING: CAN gateway route table is full!\n");
+        configASSERT(0); // assert error
+        return;
+    }
+
+    CANRoute& route = routes[numRoutes];
+    route.source = source;
+    route.id = id;
+    route.mask = mask;
+    route.destination = destination;
+    route.minInterval_ms = minInterval_ms;
+    route.remapOffset = remapOffset;
+
+    lastForward_us[numRoutes] = 0;
+    stats[numRoutes] = CANRouteStats();
+    numRoutes++;
+
+    source->set_forwarder(this);
+}
+
+bool CANGateway::accepts(AbstractCANController* source, uint32_t id) {
+    for (int i = 0; i < numRoutes; i++) {
+        if (matches(routes[i], source, id)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void CANGateway::forward(AbstractCANController* source, CANMessage const& message, uint32_t rx_us) {
+    for (int i = 0; i < numRoutes; i++) {
+        CANRoute& route = routes[i];
+        if (!matches(route, source, message.id)) {
+            continue;
+        }
+
+        CANRouteStats& routeStats = stats[i];
+
+        if (route.minInterval_ms > 0 && routeStats.forwarded > 0 && (rx_us - lastForward_us[i]) < route.minInterval_ms * 1000) {
+            routeStats.rateLimited++;
+            continue;
+        }
+
+        CANMessage out = message;
+        out.id = message.id + route.remapOffset;
+
+        // a dropped frame doesn't count towards the rate limit, so the next matching frame can take its place
+        if (!route.destination->send(out)) {
+            routeStats.dropped++;
+            continue;
+        }
+
+        lastForward_us[i] = rx_us;
+        routeStats.forwarded++;
+        routeStats.bytes += message.len;
+        routeStats.latency.add(micros() - rx_us);
+    }
+}
+
+int CANGateway::get_accept_ranges(AbstractCANController* source, CANFilterRange* ranges, int maxRanges) {
+    int numRanges = 0;
+
+    for (int i = 0; i < numRoutes && numRanges < maxRanges; i++) {
+        if (routes[i].source == source) {
+            ranges[numRanges] = maskFilterRange(routes[i].id, routes[i].mask, CAN_STD_ID_MASK);
+            numRanges++;
+        }
+    }
+
+    return numRanges;
+}
+
+int CANGateway::getNumRoutes() {
+    return numRoutes;
+}
+
+CANRouteStats CANGateway::getRouteStats(int route) {
+    return stats[route];
+}
+
+}
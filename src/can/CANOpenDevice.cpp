@@ -11,6 +11,8 @@ void CANOpenDevice::init(AbstractCANController* ican, uint8_t inodeID, uint32_t
     can->subscribe(HEARTBEAT_COB_ID + nodeID, &canQueue);    // sub to heartbeat
     can->subscribe(SDO_RESPONSE_COB_ID + nodeID, &canQueue); // sub to SDO reply
 
+    can->set_tx_priority(NMT_COB_ID, CANTxPriority::Critical); // NMT is used to stop devices
+
     task.start(
         [this] {
             loop();
@@ -85,11 +87,11 @@ void CANOpenDevice::sendPDO(uint32_t cob_id, uint8_t data[8]) {
     can->send(msg);
 };
 
-void CANOpenDevice::addPDOQueue(Queue<PDOMessage, 256>* ipdoQueue) {
+void CANOpenDevice::addPDOQueue(SPSCQueue<CANFrameRef, 256>* ipdoQueue) {
     pdoQueue = ipdoQueue;
 };
 
-void CANOpenDevice::addSDOQueue(Queue<SDOMessage, 256>* isdoQueue) {
+void CANOpenDevice::addSDOQueue(SPSCQueue<SDOMessage, 256>* isdoQueue) {
     sdoQueue = isdoQueue;
 };
 
@@ -98,40 +100,73 @@ void CANOpenDevice::subscribePDO(uint32_t cob_id) {
 }
 
 void CANOpenDevice::loop() {
+    CANFrameRef refs[CANOPEN_RX_BATCH];
+    CANFrameRef pdoRefs[CANOPEN_RX_BATCH];
 
     while (true) {
-        CANMessage canMessage = canQueue.dequeue(TIMEOUT_MAX);
-
-        if (canMessage.id == (SDO_REQUEST_COB_ID + nodeID)) { // SDO Message
-            uint16_t index = (canMessage.data[2] << 8) + canMessage.data[1];
-
-            SDOMessage sdoMessage = {
-                .index = index,
-                .subindex = canMessage.data[3]
-            };
-            memcpy(sdoMessage.data, canMessage.data + 4, 4); // copy last 4 bytes
-
-            sdoQueue->enqueue(sdoMessage, TIMEOUT_MAX);
-
-        } else if (canMessage.id == (HEARTBEAT_COB_ID + nodeID)) { // heartbeat message
-            nmtState = static_cast<NMTState>(canMessage.data[0]);
-        } else { // PDO message
-
-            PDOMessage pdoMessage = {
-                .cobID = canMessage.id - nodeID
-            };
-            memcpy(pdoMessage.data, canMessage.data, 8);
-
-            pdoQueue->enqueue(pdoMessage, TIMEOUT_MAX);
+        int received = canQueue.dequeueMany(refs, CANOPEN_RX_BATCH, TIMEOUT_MAX);
+        int numPDOs = 0;
+
+        for (int i = 0; i < received; i++) {
+            CANFrameRef ref = refs[i];
+            CANMessage& canMessage = canFramePool.get(ref);
+
+            bool isSDO = canMessage.id == (uint32_t)(SDO_RESPONSE_COB_ID + nodeID);
+            bool isHeartbeat = canMessage.id == (uint32_t)(HEARTBEAT_COB_ID + nodeID);
+
+            if (!isSDO && !isHeartbeat) { // PDO message, passed on without copying
+                pdoRefs[numPDOs++] = ref;
+                continue;
+            }
+
+            // PDOs which arrived first are passed on first, so the inverter sees frames in the order they arrived
+            sendPDOs(pdoRefs, numPDOs);
+            numPDOs = 0;
+
+            if (isSDO) { // SDO reply
+                uint16_t index = (canMessage.data[2] << 8) + canMessage.data[1];
+
+                SDOMessage sdoMessage = {
+                    .index = index,
+                    .subindex = canMessage.data[3]
+                };
+                memcpy(sdoMessage.data, canMessage.data + 4, 4); // copy last 4 bytes
+                canFramePool.release(ref);
+
+                if (sdoQueue != nullptr) {
+                    sdoQueue->enqueue(sdoMessage, TIMEOUT_MAX);
+                }
+
+            } else { // heartbeat message
+                nmtState = static_cast<NMTState>(canMessage.data[0]);
+                canFramePool.release(ref);
+            }
         }
 
+        sendPDOs(pdoRefs, numPDOs);
+
         // yield -  we block when reading the can queue anyway so could be 0
         Task::delay(1);
     }
 }
 
+void CANOpenDevice::sendPDOs(CANFrameRef* refs, int count) {
+    if (count == 0) {
+        return;
+    }
+
+    int sent = (pdoQueue == nullptr) ? 0 : pdoQueue->enqueueMany(refs, count, TIMEOUT_MAX);
+    for (int i = sent; i < count; i++) {
+        canFramePool.release(refs[i]);
+    }
+}
+
 NMTState CANOpenDevice::getNMTState() {
     return nmtState;
 }
 
+uint8_t CANOpenDevice::getNodeID() {
+    return nodeID;
+}
+
 }
\ No newline at end of file
@@ -6,6 +6,8 @@ namespace wrvcu {
 void CANOpenHost::init(AbstractCANController* ican) {
     this->can = ican;
 
+    can->set_tx_priority(0x80, CANTxPriority::High); // SYNC timing matters to every node
+
     task.start([this] { loop(); }, CANOPEN_HOST_TASK_PRIORITY, "CANOpen_Host_Task");
 };
 
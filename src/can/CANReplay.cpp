@@ -0,0 +1,486 @@
+#include "can/CANReplay.hpp"
+
+#include <cctype>
+#include <cstring>
+
+namespace wrvcu {
+
+bool CANBufferLineSource::readLine(char* line, int maxLen) {
+    if (*position == '\0') {
+        return false;
+    }
+
+    int len = 0;
+    while (*position != '\0' && *position != '\n') {
+        if (len < maxLen - 1) {
+            line[len] = *position;
+        }
+        len++;
+        position++;
+    }
+    if (*position == '\n') {
+        position++;
+    }
+
+    // lines too long for the buffer are returned empty, so they are skipped rather than parsed truncated
+    if (len >= maxLen) {
+        len = 0;
+    } else if (len > 0 && line[len - 1] == '\r') {
+        len--;
+    }
+    line[len] = '\0';
+
+    return true;
+}
+
+bool CANBufferLineSource::rewind() {
+    position = buffer;
+    return true;
+}
+
+bool CANStreamLineSource::readLine(char* line, int maxLen) {
+    int c = stream->read();
+    if (c < 0) {
+        return false;
+    }
+
+    int len = 0;
+    while (c >= 0 && c != '\n') {
+        if (len < maxLen - 1) {
+            line[len] = (char)c;
+        }
+        len++;
+        c = stream->read();
+    }
+
+    if (len >= maxLen) {
+        len = 0;
+    } else if (len > 0 && line[len - 1] == '\r') {
+        len--;
+    }
+    line[len] = '\0';
+
+    return true;
+}
+
+static const char* skipSpaces(const char* p) {
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    return p;
+}
+
+static bool isEnd(char c) {
+    return c == '\0' || c == ' ' || c == '\t';
+}
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/**
+ * @brief Parse a timestamp in seconds, with up to microsecond resolution, without going through floating point.
+ *
+ * @return const char* The first character after the timestamp, or nullptr if there was no timestamp
+ */
+static const char* parseTimestamp(const char* p, uint64_t& timestamp_us) {
+    if (!isdigit((unsigned char)*p)) {
+        return nullptr;
+    }
+
+    uint64_t seconds = 0;
+    while (isdigit((unsigned char)*p)) {
+        seconds = seconds * 10 + (*p - '0');
+        p++;
+    }
+
+    uint32_t fraction = 0;
+    int digits = 0;
+    if (*p == '.') {
+        p++;
+        while (isdigit((unsigned char)*p)) {
+            if (digits < 6) {
+                fraction = fraction * 10 + (*p - '0');
+                digits++;
+            }
+            p++;
+        }
+    }
+    for (; digits < 6; digits++) {
+        fraction *= 10;
+    }
+
+    timestamp_us = seconds * 1000000 + fraction;
+    return p;
+}
+
+/**
+ * @brief Parse an ID, returning the number of digits read.
+ *
+ */
+static int parseID(const char*& p, uint32_t& id, bool hex) {
+    int digits = 0;
+    id = 0;
+    while (true) {
+        int d = hex ? hexDigit(*p) : (isdigit((unsigned char)*p) ? *p - '0' : -1);
+        if (d < 0) {
+            break;
+        }
+        id = id * (hex ? 16 : 10) + d;
+        digits++;
+        p++;
+    }
+    return digits;
+}
+
+/**
+ * @brief Parse data bytes written as pairs of hex digits, optionally separated by spaces.
+ *
+ * @return int The number of bytes, or -1 if there were more than 8 or a byte was malformed
+ */
+static int parseBytes(const char* p, uint8_t* data, bool spaced, int count = -1) {
+    int len = 0;
+    while (count < 0 || len < count) {
+        if (spaced) {
+            p = skipSpaces(p);
+        }
+        int hi = hexDigit(p[0]);
+        if (hi < 0) {
+            break;
+        }
+        int lo = hexDigit(p[1]);
+        if (lo < 0 || len >= 8) {
+            return -1;
+        }
+        data[len] = (uint8_t)((hi << 4) | lo);
+        len++;
+        p += 2;
+    }
+
+    // a fixed number of bytes must all be present
+    if (count >= 0 && len != count) {
+        return -1;
+    }
+    return len;
+}
+
+static bool channelMatches(const char* token, int tokenLen, const char* channel) {
+    return channel == nullptr || ((int)strlen(channel) == tokenLen && strncmp(token, channel, tokenLen) == 0);
+}
+
+CANLogLine parseCandumpLine(const char* line, CANMessage& message, uint64_t& timestamp_us, const char* channel) {
+    const char* p = skipSpaces(line);
+    if (*p != '(') {
+        return CANLogLine::Skipped;
+    }
+
+    p = parseTimestamp(p + 1, timestamp_us);
+    if (p == nullptr || *p != ')') {
+        return CANLogLine::Error;
+    }
+
+    // interface
+    p = skipSpaces(p + 1);
+    const char* iface = p;
+    while (!isEnd(*p)) {
+        p++;
+    }
+    if (p == iface) {
+        return CANLogLine::Error;
+    }
+    if (!channelMatches(iface, p - iface, channel)) {
+        return CANLogLine::Skipped;
+    }
+
+    p = skipSpaces(p);
+    uint32_t id;
+    int idDigits = parseID(p, id, true);
+    if (idDigits == 0) {
+        return CANLogLine::Error;
+    }
+
+    message = CANMessage();
+    message.id = id;
+    message.flags.extended = idDigits > 3;
+
+    if (*p == '#') {
+        // candump -l: 123#DEADBEEF, 123#R, or 123##<flags><data> for CAN FD
+        p++;
+        if (*p == '#') {
+            return CANLogLine::Skipped;
+        }
+        if (*p == 'R') {
+            message.flags.remote = true;
+            message.len = isdigit((unsigned char)p[1]) ? p[1] - '0' : 0;
+            return message.len <= 8 ? CANLogLine::Frame : CANLogLine::Error;
+        }
+
+        int len = parseBytes(p, message.data, false);
+        if (len < 0) {
+            return CANLogLine::Error;
+        }
+        message.len = len;
+        return CANLogLine::Frame;
+    }
+
+    // candump -ta: 123   [8]  DE AD BE EF 00 00 00 00, or [8]  remote request
+    p = skipSpaces(p);
+    if (p[0] != '[' || !isdigit((unsigned char)p[1])) {
+        return CANLogLine::Error;
+    }
+    int len = p[1] - '0';
+    if (p[2] != ']') {
+        return isdigit((unsigned char)p[2]) ? CANLogLine::Skipped : CANLogLine::Error; // two digit lengths are CAN FD
+    }
+    if (len > 8) {
+        return CANLogLine::Error;
+    }
+    message.len = len;
+    p = skipSpaces(p + 3);
+
+    if (strncmp(p, "remote", 6) == 0) {
+        message.flags.remote = true;
+        return CANLogLine::Frame;
+    }
+
+    return parseBytes(p, message.data, true, len) == len ? CANLogLine::Frame : CANLogLine::Error;
+}
+
+CANLogLine parseASCLine(const char* line, CANMessage& message, uint64_t& timestamp_us, const char* channel, bool hexIDs) {
+    const char* p = skipSpaces(line);
+
+    // header lines such as "date", "base hex  timestamps absolute" and "Begin Triggerblock" don't start with a time
+    p = parseTimestamp(p, timestamp_us);
+    if (p == nullptr) {
+        return CANLogLine::Skipped;
+    }
+
+    // channel, which is a word instead for CAN FD frames and some events
+    p = skipSpaces(p);
+    const char* chan = p;
+    while (isdigit((unsigned char)*p)) {
+        p++;
+    }
+    if (p == chan || !isEnd(*p)) {
+        return CANLogLine::Skipped;
+    }
+    if (!channelMatches(chan, p - chan, channel)) {
+        return CANLogLine::Skipped;
+    }
+
+    // ID, followed by x for extended IDs. Error frames and statistics are logged here instead
+    p = skipSpaces(p);
+    uint32_t id;
+    if (parseID(p, id, hexIDs) == 0) {
+        return CANLogLine::Skipped;
+    }
+
+    message = CANMessage();
+    message.id = id;
+    if (*p == 'x') {
+        message.flags.extended = true;
+        p++;
+    }
+    if (!isEnd(*p)) {
+        return CANLogLine::Skipped;
+    }
+
+    // direction
+    p = skipSpaces(p);
+    if (strncmp(p, "Rx", 2) != 0 && strncmp(p, "Tx", 2) != 0) {
+        return CANLogLine::Error;
+    }
+    p = skipSpaces(p + 2);
+
+    // d for data frames, r for remote frames, followed by the DLC
+    char type = *p;
+    if (type != 'd' && type != 'r') {
+        return CANLogLine::Error;
+    }
+    p = skipSpaces(p + 1);
+
+    int len = 0;
+    if (isdigit((unsigned char)*p)) {
+        len = *p - '0';
+        p++;
+    } else if (type == 'd') {
+        return CANLogLine::Error;
+    }
+    if (len > 8 || !isEnd(*p)) {
+        return CANLogLine::Error;
+    }
+    message.len = len;
+
+    if (type == 'r') {
+        message.flags.remote = true;
+        return CANLogLine::Frame;
+    }
+
+    return parseBytes(p, message.data, true, len) == len ? CANLogLine::Frame : CANLogLine::Error;
+}
+
+void CANReplayController::set_source(CANLineSource* isource, CANLogFormat iformat, const char* ichannel) {
+    source = isource;
+    format = iformat;
+    channel = ichannel;
+}
+
+void CANReplayController::set_speed(float ispeed) {
+    speed = ispeed;
+}
+
+void CANReplayController::set_looping(bool iloop) {
+    looping = iloop;
+}
+
+void CANReplayController::init(uint32_t task_priority) {
+    if (source == nullptr) {
+        printf("WARNING: CAN replay started without a log!\n");
+        configASSERT(0); // assert error
+    } else { // ok
+    };
+
+    freeze_subscriptions();
+
+    task.start([this] { loop(); }, task_priority, "CAN_Replay_Task");
+}
+
+void CANReplayController::set_baud_rate(const uint32_t baud_rate) {
+    _baudRate = baud_rate;
+}
+
+bool CANReplayController::send(CANMessage const& message) {
+    stats.sent++;
+    return true;
+}
+
+CANReplayStats CANReplayController::get_replay_stats() {
+    return stats;
+}
+
+bool CANReplayController::is_finished() {
+    return finished;
+}
+
+CANLogLine CANReplayController::parseLine(const char* line, CANMessage& message, uint64_t& timestamp_us) {
+    if (format == CANLogFormat::Candump) {
+        return parseCandumpLine(line, message, timestamp_us, channel);
+    }
+
+    if (format == CANLogFormat::ASC) {
+        const char* p = skipSpaces(line);
+        if (strncmp(p, "base ", 5) == 0) {
+            hexIDs = strncmp(skipSpaces(p + 5), "hex", 3) == 0;
+            return CANLogLine::Skipped;
+        }
+        return parseASCLine(line, message, timestamp_us, channel, hexIDs);
+    }
+
+    // candump lines always start with the timestamp in brackets, and ASC frames never do
+    const char* p = skipSpaces(line);
+    if (*p == '(') {
+        format = CANLogFormat::Candump;
+        return parseLine(line, message, timestamp_us);
+    }
+    if (isdigit((unsigned char)*p) || strncmp(p, "base ", 5) == 0) {
+        format = CANLogFormat::ASC;
+        return parseLine(line, message, timestamp_us);
+    }
+    return CANLogLine::Skipped;
+}
+
+void CANReplayController::loop() {
+    char line[CAN_REPLAY_MAX_LINE];
+    CANMessage msg;
+    uint64_t timestamp_us = 0;
+
+    bool firstFrame = true;
+    uint64_t firstTimestamp_us = 0;
+    uint64_t lastTimestamp_us = 0;
+    uint64_t passRecorded_us = 0; // log time covered by earlier passes through a looping log
+    uint64_t passStart_us = 0;    // real time the current pass started
+
+    // real time since the replay started, kept in 64 bits so long logs don't wrap
+    uint32_t lastMicros = micros();
+    auto now = [&]() {
+        uint32_t t = micros();
+        stats.elapsed_us += t - lastMicros;
+        lastMicros = t;
+        return stats.elapsed_us;
+    };
+
+    while (true) {
+        uint64_t start = now();
+
+        if (!source->readLine(line, sizeof(line))) {
+            if (looping && source->rewind()) {
+                passRecorded_us = stats.recorded_us;
+                passStart_us = start;
+                firstFrame = true;
+                continue;
+            }
+            break;
+        }
+
+        CANLogLine result = parseLine(line, msg, timestamp_us);
+        if (result == CANLogLine::Skipped) {
+            stats.skippedLines++;
+            continue;
+        }
+        if (result == CANLogLine::Error) {
+            stats.parseErrors++;
+            continue;
+        }
+
+        if (firstFrame) {
+            firstTimestamp_us = timestamp_us;
+            lastTimestamp_us = timestamp_us;
+            firstFrame = false;
+        }
+
+        // logs are written in order, but merged captures can go back slightly, which is replayed immediately
+        if (timestamp_us > lastTimestamp_us) {
+            lastTimestamp_us = timestamp_us;
+        }
+        stats.recorded_us = passRecorded_us + (lastTimestamp_us - firstTimestamp_us);
+
+        if (speed > 0) {
+            // a frame from before the first one is due at the start, rather than wrapping to the far future
+            uint64_t offset_us = timestamp_us > firstTimestamp_us ? timestamp_us - firstTimestamp_us : 0;
+            uint64_t due_us = passStart_us + (uint64_t)(offset_us / speed);
+            uint64_t t = now();
+
+            // wait for the frame to be due, to the nearest tick, without counting the wait as ingest time
+            if (due_us >= t + 1000) {
+                stats.ingest_us += t - start;
+                Task::delay((uint32_t)((due_us - t) / 1000));
+                start = now();
+            } else if (t > due_us + 1000) {
+                stats.late++;
+            }
+        }
+
+        msg.timestamp = (uint16_t)timestamp_us;
+        post(msg, micros());
+        stats.frames++;
+
+        stats.ingest_us += now() - start;
+    }
+
+    finished = true;
+
+    while (true) {
+        Task::notify_take(true, TIMEOUT_MAX);
+    }
+}
+
+}
@@ -0,0 +1,118 @@
+#include "can/CANSignalMonitor.hpp"
+#include "logging/log.hpp"
+#include <cstdio>
+
+namespace wrvcu {
+
+bool CANSignalMonitor::watch(const CANSignalStoreBase* store, Mutex* mutex) {
+    if (numStores >= CAN_SIGNAL_MONITOR_MAX_STORES) {
+        ERROR("CAN signal monitor: Watching too many stores.");
+        return false;
+    }
+
+    if (store->getNumSignals() > CAN_SIGNAL_MONITOR_MAX_SIGNALS) {
+        ERROR("CAN signal monitor: Store has too many signals to monitor.");
+        return false;
+    }
+
+    stores[numStores] = store;
+    mutexes[numStores] = mutex;
+    numStores++;
+    return true;
+}
+
+bool CANSignalMonitor::subscribe(Queue<CANSignalEvent, CAN_SIGNAL_EVENT_QUEUE_LENGTH>* queue) {
+    if (numSubscribers >= CAN_SIGNAL_MONITOR_MAX_SUBSCRIBERS) {
+        ERROR("CAN signal monitor: Too many subscribers.");
+        return false;
+    }
+
+    subscribers[numSubscribers++] = queue;
+    return true;
+}
+
+void CANSignalMonitor::init(uint32_t task_priority) {
+    task.start(
+        [this] { loop(); }, task_priority, "CAN_Signal_Monitor_Task");
+}
+
+void CANSignalMonitor::loop() {
+    uint32_t wake = Task::millis();
+
+    while (true) {
+        uint32_t now_ms = Task::millis();
+
+        uint32_t stale = 0;
+        for (int i = 0; i < numStores; i++) {
+            stale += scan(i, now_ms);
+        }
+        staleSignals = stale;
+
+        Task::delay_until(&wake, CAN_SIGNAL_MONITOR_PERIOD_MS);
+    }
+}
+
+uint32_t CANSignalMonitor::scan(int store, uint32_t now_ms) {
+    const CANSignalStoreBase* s = stores[store];
+    uint32_t nowFresh[CAN_SIGNAL_MONITOR_MAX_SIGNALS / 32] = { 0 };
+    uint32_t stale = 0;
+
+    // only hold the owner's mutex while reading the store, not while logging and posting
+    mutexes[store]->take();
+    for (int signal = 0; signal < s->getNumSignals(); signal++) {
+        if (s->isFresh(signal, now_ms)) {
+            nowFresh[signal / 32] |= 1u << (signal % 32);
+        } else {
+            stale++;
+        }
+    }
+    mutexes[store]->give();
+
+    for (int signal = 0; signal < s->getNumSignals(); signal++) {
+        uint32_t& word = fresh[store][signal / 32];
+        uint32_t bit = 1u << (signal % 32);
+
+        bool wasFresh = (word & bit) != 0;
+        bool isFresh = (nowFresh[signal / 32] & bit) != 0;
+        if (isFresh == wasFresh) {
+            continue;
+        }
+
+        word ^= bit;
+
+        if (isFresh) {
+            INFO("CANSignalMonitor", formatLogMessage("Signal fresh:", s->getInfo(signal).name));
+        } else {
+            staleEvents++;
+            WARN("CANSignalMonitor", formatLogMessage("Signal stale:", s->getInfo(signal).name));
+        }
+
+        post(CANSignalEvent{ s, signal, !isFresh, now_ms });
+    }
+
+    return stale;
+}
+
+const char* CANSignalMonitor::formatLogMessage(const char* event, const char* name) {
+    char* message = logMessages[nextLogMessage];
+    nextLogMessage = (nextLogMessage + 1) % CAN_SIGNAL_MONITOR_LOG_MESSAGES;
+
+    snprintf(message, CAN_SIGNAL_MONITOR_LOG_MESSAGE_LENGTH, "%s %s", event, name);
+    return message;
+}
+
+void CANSignalMonitor::post(CANSignalEvent const& event) {
+    for (int i = 0; i < numSubscribers; i++) {
+        subscribers[i]->enqueue(event, 0);
+    }
+}
+
+uint32_t CANSignalMonitor::getStaleEvents() {
+    return staleEvents;
+}
+
+uint32_t CANSignalMonitor::getStaleSignals() {
+    return staleSignals;
+}
+
+}
@@ -0,0 +1,16 @@
+#include "can/CANTelemetryRoutes.hpp"
+#include "battery.h"
+#include "constants.hpp"
+
+namespace wrvcu {
+
+void addTelemetryRoutes(CANGateway* gateway, AbstractCANController* powertrain, AbstractCANController* telemetry) {
+    // rate limit the frames the loggers only need at 10Hz
+    gateway->addRoute(powertrain, BATTERY_BMS_CELL_STATUS_VOLTAGES_FRAME_ID, CAN_STD_ID_MASK, telemetry, 100);
+    gateway->addRoute(powertrain, BATTERY_BMS_CELL_STATUS_TEMPERATURES_FRAME_ID, CAN_STD_ID_MASK, telemetry, 100);
+    gateway->addRoute(powertrain, BATTERY_BMS_BATT_STATUS_FRAME_ID, CAN_STD_ID_MASK, telemetry, 100);
+    gateway->addRoute(powertrain, 0x520, 0x7f8, telemetry); // IVT results, 0x520-0x527
+    gateway->addRoute(powertrain, INVERTER_TPDO4 + 1, CAN_STD_ID_MASK, telemetry, 100); // inverter speed, node 1
+}
+
+}
@@ -0,0 +1,217 @@
+#include "can/VirtualCANBus.hpp"
+
+namespace wrvcu {
+
+void VirtualCANController::init(uint32_t task_priority) {
+    if (bus == nullptr) {
+        printf("WARNING: Virtual CAN controller started without a bus!\n");
+        configASSERT(0); // assert error
+    } else { // ok
+    };
+
+    // frames are received from the bus task, so there is no task of our own, and the bus task freezes subscriptions
+    _baudRate = bus->getBitRate();
+}
+
+void VirtualCANController::set_baud_rate(const uint32_t baud_rate) {
+    _baudRate = baud_rate;
+}
+
+bool VirtualCANController::send(CANMessage const& message) {
+    if (!txQueue.enqueue(message, 0)) {
+        txDropped++;
+        return false;
+    }
+
+    bus->notify();
+    return true;
+}
+
+void VirtualCANController::receive(CANMessage const& message, uint32_t rx_us) {
+    post(message, rx_us);
+}
+
+uint32_t VirtualCANController::get_tx_dropped() {
+    return txDropped;
+}
+
+uint32_t VirtualCANController::get_arbitration_losses() {
+    return arbitrationLosses;
+}
+
+void VirtualCANBus::attach(VirtualCANController* controller) {
+    if (numNodes >= VIRTUAL_CAN_MAX_NODES) {
+        printf("WARNING: Too many controllers on a virtual CAN bus!\n");
+        configASSERT(0); // assert error
+        return;
+    }
+
+    controller->bus = this;
+    controller->txQueue.init();
+    nodes[numNodes] = controller;
+    numNodes++;
+}
+
+void VirtualCANBus::setBitRate(uint32_t rate) {
+    bitRate = rate;
+}
+
+void VirtualCANBus::setTimeScale(float scale) {
+    timeScale = scale;
+}
+
+void VirtualCANBus::setBackgroundLoad(float load, uint16_t id) {
+    fillerLoad = load;
+    fillerID = id;
+}
+
+void VirtualCANBus::init(uint32_t task_priority) {
+    task.start([this] { loop(); }, task_priority, "Virtual_CAN_Task");
+}
+
+void VirtualCANBus::notify() {
+    task.notify();
+}
+
+uint32_t VirtualCANBus::getBitRate() {
+    return bitRate;
+}
+
+VirtualCANBusStats VirtualCANBus::getStats() {
+    return stats;
+}
+
+uint32_t VirtualCANBus::arbitrationKey(CANMessage const& message) {
+    if (message.flags.extended) {
+        return ((message.id >> 18) << 19) | (1 << 18) | (message.id & 0x3ffff);
+    }
+    return message.id << 19;
+}
+
+int VirtualCANBus::arbitrate(uint64_t now_us) {
+    int winner = -2;
+    uint32_t winningKey = UINT32_MAX;
+
+    for (int i = 0; i < numNodes; i++) {
+        if (nodes[i]->txQueue.size() == 0) {
+            continue;
+        }
+
+        uint32_t key = arbitrationKey(nodes[i]->txQueue.peek(0));
+        if (key < winningKey) {
+            winningKey = key;
+            winner = i;
+        }
+    }
+
+    if (fillerLoad > 0 && now_us >= nextFiller_us) {
+        CANMessage filler;
+        filler.id = fillerID;
+        if (arbitrationKey(filler) < winningKey) {
+            winner = -1;
+        }
+    }
+
+    // every node with a frame waiting, other than the winner, lost arbitration
+    for (int i = 0; i < numNodes; i++) {
+        if (i != winner && nodes[i]->txQueue.size() > 0) {
+            nodes[i]->arbitrationLosses++;
+        }
+    }
+
+    return winner;
+}
+
+void VirtualCANBus::loop() {
+    // all subscriptions are made during init, before the scheduler starts
+    for (int i = 0; i < numNodes; i++) {
+        nodes[i]->freeze_subscriptions();
+    }
+
+    uint32_t lastMicros = micros();
+    uint64_t real_us = 0;
+    bool idle = true;
+
+    CANMessage filler;
+    filler.len = 8;
+    uint32_t fillerPeriod_us = 0;
+
+    while (true) {
+        uint32_t nowMicros = micros();
+        real_us += nowMicros - lastMicros;
+        lastMicros = nowMicros;
+
+        filler.id = fillerID;
+        if (fillerLoad > 0) {
+            fillerPeriod_us = (uint32_t)(canFrameBits(filler) * 1000000ULL / bitRate / fillerLoad);
+        }
+
+        // the bus was idle up to now, so bus time never runs behind real time. A frame that follows straight on from the
+        // last one isn't resynced, so a hold that overslept doesn't stretch the bus.
+        if (timeScale > 0 && idle) {
+            uint64_t scaled_us = (uint64_t)(real_us * timeScale);
+            if (stats.busTime_us < scaled_us) {
+                stats.busTime_us = scaled_us;
+            }
+        }
+
+        int winner = arbitrate(stats.busTime_us);
+
+        if (winner == -2) {
+            // nothing to send, sleep until a controller queues a frame or the next filler frame is due
+            uint32_t timeout = TIMEOUT_MAX;
+            if (timeScale > 0 && fillerLoad > 0) {
+                uint64_t wait_us = nextFiller_us > stats.busTime_us ? nextFiller_us - stats.busTime_us : 0;
+                timeout = (uint32_t)(wait_us / timeScale / 1000) + 1;
+            }
+            Task::notify_take(true, timeout);
+            idle = true;
+            continue;
+        }
+
+        idle = false;
+
+        CANMessage msg;
+        VirtualCANController* sender = nullptr;
+
+        if (winner == -1) {
+            msg = filler;
+            stats.fillerFrames++;
+
+            nextFiller_us += fillerPeriod_us;
+            if (nextFiller_us + fillerPeriod_us < stats.busTime_us) {
+                nextFiller_us = stats.busTime_us; // fell behind while other frames held the bus, don't burst to catch up
+            }
+        } else {
+            sender = nodes[winner];
+            sender->txQueue.dequeue(msg, 0);
+            stats.frames++;
+        }
+
+        uint32_t bits = canFrameBits(msg);
+        stats.bits += bits;
+        stats.busTime_us += bits * 1000000ULL / bitRate;
+
+        // hold the frame until real time reaches the end of it, so it's received when the last bit is on the wire
+        if (timeScale > 0) {
+            uint64_t due_us = (uint64_t)(stats.busTime_us / timeScale);
+            uint64_t now_us = real_us + (micros() - lastMicros);
+            if (due_us > now_us) {
+                delayMicros((uint32_t)(due_us - now_us));
+            }
+        }
+
+        if (winner == -1) {
+            continue; // nobody listens to filler frames
+        }
+
+        uint32_t rx_us = micros();
+        for (int i = 0; i < numNodes; i++) {
+            if (nodes[i] != sender) {
+                nodes[i]->receive(msg, rx_us);
+            }
+        }
+    }
+}
+
+}
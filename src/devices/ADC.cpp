@@ -27,4 +27,12 @@ int ADC::read(int channel) {
     return adc_ou;
 }
 
+void ADC::readAll(uint16_t* counts) {
+    mutex.take();
+    for (int channel = 0; channel < ADC_NUM_CHANNELS; channel++) {
+        counts[channel] = adc.readFiltered(channel);
+    }
+    mutex.give();
+}
+
 }
\ No newline at end of file
@@ -4,9 +4,8 @@
 
 namespace wrvcu {
 
-void APPS::init(ADC* adc_o, int adc_channel, float angle_offset_o, float angle_range_o) {
+void APPS::init(int adc_channel, float angle_offset_o, float angle_range_o) {
 
-    this->adc = adc_o;
     this->adc_channel = adc_channel;
 
     this->angle_offset = angle_offset_o;
@@ -22,9 +21,11 @@ void APPS::init(ADC* adc_o, int adc_channel, float angle_offset_o, float angle_r
     }
 }
 
-uint16_t APPS::read() {
-    uint16_t val = adc->read(adc_channel);
+int APPS::getChannel() {
+    return adc_channel;
+}
 
+uint16_t APPS::filter(uint16_t val) {
     if (APPS_USE_SMOOTH) {
         window_total = window_total - window_array[window_index]; // Remove earliest reading from sum
         window_array[window_index] = val;                         // Add reading to the array
@@ -52,30 +53,30 @@ uint16_t APPS::read() {
     return val;
 }
 
-float APPS::getVoltage() {
-    return read() * APPS_MAX_VOLTAGE / ADC_RESOLUTION;
+float APPS::getVoltage(uint16_t counts) {
+    return counts * APPS_MAX_VOLTAGE / ADC_RESOLUTION;
 }
 
-float APPS::getAngle() {
-    return (getVoltage() - APPS_START_FRACTION * APPS_MAX_VOLTAGE) * APPS_MAX_ANGLE / (abs(APPS_END_FRACTION - APPS_START_FRACTION) * APPS_MAX_VOLTAGE);
+float APPS::getAngle(uint16_t counts) {
+    return (getVoltage(counts) - APPS_START_FRACTION * APPS_MAX_VOLTAGE) * APPS_MAX_ANGLE / (abs(APPS_END_FRACTION - APPS_START_FRACTION) * APPS_MAX_VOLTAGE);
 }
 
-float APPS::getProcessedAngle() {
-    return (getAngle() - angle_offset - angle_range * APPS_IGNORE_FRACTION);
+float APPS::getProcessedAngle(uint16_t counts) {
+    return (getAngle(counts) - angle_offset - angle_range * APPS_IGNORE_FRACTION);
 }
 
-float APPS::getRegenFraction() {
-    float frac_val = getProcessedAngle() / (angle_range * APPS_IGNORE_FRACTION);
+float APPS::getRegenFraction(uint16_t counts) {
+    float frac_val = getProcessedAngle(counts) / (angle_range * APPS_IGNORE_FRACTION);
     return (std::clamp(frac_val, -1.0f, 0.0f));
 }
 
-float APPS::getSaturatedFraction() {
-    float frac_val = getProcessedAngle() / (angle_range);
+float APPS::getSaturatedFraction(uint16_t counts) {
+    float frac_val = getProcessedAngle(counts) / (angle_range);
     return (std::clamp(frac_val, 0.0f, (float)(1.0f - APPS_IGNORE_FRACTION)) / (1 - APPS_IGNORE_FRACTION));
 }
 
-bool APPS::isConnected() {
-    float volts = getVoltage();
+bool APPS::isConnected(uint16_t counts) {
+    float volts = getVoltage(counts);
     return (volts > APPS_LOW_VOLTAGE && volts < APPS_HIGH_VOLTAGE);
 }
 
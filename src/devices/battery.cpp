@@ -1,30 +1,24 @@
 #include "devices/battery.hpp"
+#include "battery_fixed.hpp"
 #include "constants.hpp"
 #include "logging/log.hpp"
 #include "rtos/task.hpp"
 
-#define BATTERY_MAX_READS 15
-
 namespace wrvcu {
+
 void Battery::init(AbstractCANController* ican) {
     // Set initial state
     openContactors();
 
-    canQueue.init();
     mutex.init();
 
     can = ican;
 
-    can->subscribe(BATTERY_BMS_AVAIL_CURRENT_FRAME_ID, &canQueue);
-    can->subscribe(BATTERY_BMS_BATT_STATUS_FRAME_ID, &canQueue);
-    can->subscribe(BATTERY_BMS_CELL_STATUS_TEMPERATURES_FRAME_ID, &canQueue);
-    can->subscribe(BATTERY_BMS_CELL_STATUS_VOLTAGES_FRAME_ID, &canQueue);
-    can->subscribe(BATTERY_IMD_INFO_FRAME_ID, &canQueue);
-    can->subscribe(BATTERY_IVT_MSG_RESULT_I_FRAME_ID, &canQueue);
-    can->subscribe(BATTERY_IVT_MSG_RESULT_U1_FRAME_ID, &canQueue);
-    can->subscribe(BATTERY_IVT_MSG_RESULT_U2_FRAME_ID, &canQueue);
-    can->subscribe(BATTERY_IVT_MSG_RESULT_U3_FRAME_ID, &canQueue);
-    can->subscribe(BATTERY_IVT_MSG_RESULT_W_FRAME_ID, &canQueue);
+    // one mailbox for every frame in battery.dbc
+    for (int i = 0; i < BATTERY_NUM_DECODED_FRAMES; i++) {
+        canMailboxes[i].init();
+        can->subscribe(signals.getDecoderID(i), &canMailboxes[i]);
+    }
 
     // wake up BMS
     wake();
@@ -35,85 +29,54 @@ void Battery::init(AbstractCANController* ican) {
 
 void Battery::loop() {
     while (true) {
-        int reads = 0;
-
         mutex.take();
 
-        while (canQueue.size() > 0 && reads < BATTERY_MAX_READS) {
-            reads++;
-
-            CANMessage msg = canQueue.dequeue(TIMEOUT_MAX);
-
-            switch (msg.id) {
-            case BATTERY_BMS_AVAIL_CURRENT_FRAME_ID:
-                battery_bms_avail_current_t current_msg;
-                battery_bms_avail_current_unpack(&current_msg, (uint8_t*)&msg.data, 8);
-                maxDischargeCurrent = battery_bms_avail_current_max_discharge_decode(current_msg.max_discharge);
-                maxChargeCurrent = battery_bms_avail_current_max_charge_decode(current_msg.max_charge);
-                break;
-            case BATTERY_BMS_BATT_STATUS_FRAME_ID:
-                battery_bms_batt_status_t status_msg;
-                battery_bms_batt_status_unpack(&status_msg, (uint8_t*)&msg.data, 8);
-                updateState(status_msg.status);
-                chargeRemaining = battery_bms_batt_status_q_remain_nom_decode(status_msg.q_remain_nom);
-                SoC = battery_bms_batt_status_so_c_decode(status_msg.so_c);
-                break;
-            case BATTERY_BMS_CELL_STATUS_TEMPERATURES_FRAME_ID:
-                battery_bms_cell_status_temperatures_t cell_temp_msg;
-                battery_bms_cell_status_temperatures_unpack(&cell_temp_msg, (uint8_t*)&msg.data, 8);
-                cellAvgTemp = battery_bms_cell_status_temperatures_avg_cell_temp_decode(cell_temp_msg.avg_cell_temp);
-                cellMinTemp = battery_bms_cell_status_temperatures_min_cell_temp_decode(cell_temp_msg.min_cell_temp);
-                cellMaxTemp = battery_bms_cell_status_temperatures_max_cell_temp_decode(cell_temp_msg.max_cell_temp);
-                break;
-            case BATTERY_BMS_CELL_STATUS_VOLTAGES_FRAME_ID:
-                battery_bms_cell_status_voltages_t cell_volt_msg;
-                battery_bms_cell_status_voltages_unpack(&cell_volt_msg, (uint8_t*)&msg.data, 8);
-                cellAvgVoltage = battery_bms_cell_status_voltages_avg_cell_voltage_decode(cell_volt_msg.avg_cell_voltage);
-                cellMinVoltage = battery_bms_cell_status_voltages_min_cell_voltage_decode(cell_volt_msg.min_cell_voltage);
-                cellMaxVoltage = battery_bms_cell_status_voltages_max_cell_voltage_decode(cell_volt_msg.max_cell_voltage);
-                break;
-            case BATTERY_IMD_INFO_FRAME_ID:
-                battery_imd_info_t imd_msg;
-                battery_imd_info_unpack(&imd_msg, (uint8_t*)&msg.data, 8);
-                imdIsoRes = battery_imd_info_imd_r_iso_decode(imd_msg.imd_r_iso);
-                break;
-            case BATTERY_IVT_MSG_RESULT_I_FRAME_ID:
-                battery_ivt_msg_result_i_t ivt_i_msg;
-                battery_ivt_msg_result_i_unpack(&ivt_i_msg, (uint8_t*)&msg.data, 8);
-                terminalCurrent = battery_ivt_msg_result_i_ivt_result_i_decode(ivt_i_msg.ivt_result_i);
-                break;
-            case BATTERY_IVT_MSG_RESULT_U1_FRAME_ID:
-                battery_ivt_msg_result_u1_t ivt_u1_msg;
-                battery_ivt_msg_result_u1_unpack(&ivt_u1_msg, (uint8_t*)&msg.data, 8);
-                packVoltage = battery_ivt_msg_result_u1_ivt_result_u1_decode(ivt_u1_msg.ivt_result_u1);
-                break;
-            case BATTERY_IVT_MSG_RESULT_U2_FRAME_ID:
-                battery_ivt_msg_result_u2_t ivt_u2_msg;
-                battery_ivt_msg_result_u2_unpack(&ivt_u2_msg, (uint8_t*)&msg.data, 8);
-                preFuseVoltage = battery_ivt_msg_result_u2_ivt_result_u2_decode(ivt_u2_msg.ivt_result_u2);
-                break;
-            case BATTERY_IVT_MSG_RESULT_U3_FRAME_ID:
-                battery_ivt_msg_result_u3_t ivt_u3_msg;
-                battery_ivt_msg_result_u3_unpack(&ivt_u3_msg, (uint8_t*)&msg.data, 8);
-                postFuseVoltage = battery_ivt_msg_result_u3_ivt_result_u3_decode(ivt_u3_msg.ivt_result_u3);
-                break;
-            case BATTERY_IVT_MSG_RESULT_W_FRAME_ID:
-                battery_ivt_msg_result_w_t ivt_w_msg;
-                battery_ivt_msg_result_w_unpack(&ivt_w_msg, (uint8_t*)&msg.data, 8);
-                power = battery_ivt_msg_result_w_ivt_result_w_decode(ivt_w_msg.ivt_result_w);
-                break;
+        // only decode frames which have changed since they were last seen
+        for (int i = 0; i < BATTERY_NUM_DECODED_FRAMES; i++) {
+            Mailbox<CANMessage>::Item item;
+
+            if (canMailboxes[i].readIfNewer(item, lastSequence[i])) {
+                lastSequence[i] = item.sequence;
+                signals.decode(item.value, item.timestamp);
+
+                if (item.value.id == BATTERY_BMS_BATT_STATUS_FRAME_ID) {
+                    updateState((uint8_t)battery_bms_batt_status_status_get_fixed(item.value.data));
+                }
             }
         }
 
         mutex.give();
 
-        if (reads >= BATTERY_MAX_READS)
-            WARN("Battery task max reads exceeded!");
-
         Task::delay(5);
     }
 }
 
+float Battery::get(int signal) {
+    return signals.get(signal);
+}
+
+CANSignal Battery::getSignal(int signal) {
+    mutex.take();
+    CANSignal value = signals.getSignal(signal);
+    mutex.give();
+
+    return value;
+}
+
+bool Battery::isFresh(int signal) {
+    uint32_t now_ms = Task::millis();
+
+    mutex.take();
+    bool fresh = signals.isFresh(signal, now_ms);
+    mutex.give();
+
+    return fresh;
+}
+
+bool Battery::watchSignals(CANSignalMonitor* monitor) {
+    return monitor->watch(&signals, &mutex);
+}
+
 void Battery::closeContactors() {
     digitalWrite(BMS_IGNITION_PIN, HIGH);
 }
@@ -39,12 +39,12 @@ void Display::writeVar_128Bit(byte PacketAddress1, byte PacketAddress2, String D
 void Display::updateDisplay() {
     while (true) {
         // mutex.take();
-        writeVar_16Bit(SOC_ADDRESS, lowByte((uint16_t)battery.SoC), highByte((uint16_t)battery.SoC));
+        writeVar_16Bit(SOC_ADDRESS, lowByte((uint16_t)battery.get(BATTERY_SOC)), highByte((uint16_t)battery.get(BATTERY_SOC)));
         writeVar_16Bit(STATUS_ADDRESS, lowByte((uint16_t)ts.getState()), highByte((uint16_t)ts.getState()));
         writeVar_16Bit(REGEN_ACTIVE_ADDRESS, lowByte((uint16_t)ts.inRegenMode), highByte((uint16_t)ts.inRegenMode));
-        writeVar_16Bit(CELL_MAX_TEMP_ADDRESS, lowByte((uint16_t)battery.cellMaxTemp), highByte((uint16_t)battery.cellMaxTemp));
-        writeVar_16Bit(CELL_MAX_VOLTAGE_ADDRESS, lowByte((uint16_t)battery.cellMaxVoltage), highByte((uint16_t)battery.cellMaxVoltage));
-        writeVar_16Bit(CELL_MIN_VOLTAGE_ADDRESS, lowByte((uint16_t)battery.cellMinVoltage), highByte((uint16_t)battery.cellMinVoltage));
+        writeVar_16Bit(CELL_MAX_TEMP_ADDRESS, lowByte((uint16_t)battery.get(BATTERY_CELL_MAX_TEMP)), highByte((uint16_t)battery.get(BATTERY_CELL_MAX_TEMP)));
+        writeVar_16Bit(CELL_MAX_VOLTAGE_ADDRESS, lowByte((uint16_t)battery.get(BATTERY_CELL_MAX_VOLTAGE)), highByte((uint16_t)battery.get(BATTERY_CELL_MAX_VOLTAGE)));
+        writeVar_16Bit(CELL_MIN_VOLTAGE_ADDRESS, lowByte((uint16_t)battery.get(BATTERY_CELL_MIN_VOLTAGE)), highByte((uint16_t)battery.get(BATTERY_CELL_MIN_VOLTAGE)));
 
         // float dataloggerDistance = datalogger.getDistanceInKM();
         // int raceProgress = map(std::clamp((int)(MAX_ENDUR_DIST_KM - dataloggerDistance), 0, MAX_ENDUR_DIST_KM), 0, MAX_ENDUR_DIST_KM, 0, 100);
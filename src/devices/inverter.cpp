@@ -18,6 +18,9 @@ void Inverter::init(AbstractCANController* ican, uint8_t inodeID) {
     device.subscribePDO(INVERTER_TPDO3);
     device.subscribePDO(INVERTER_TPDO4);
 
+    // torque commands must never wait behind other traffic
+    ican->set_tx_priority(INVERTER_RPDO1 + inodeID, CANTxPriority::Critical);
+
     mutex.init();
 
     task.start(
@@ -43,7 +46,7 @@ void Inverter::stop() {
 
 void Inverter::sendTorque(int16_t torque) {
     int sentTorque = torque * polarityFactor;
-    uint8_t data[2] = { (uint8_t)(sentTorque & 0xff), (uint8_t)(sentTorque >> 8) };
+    uint8_t data[8] = { (uint8_t)(sentTorque & 0xff), (uint8_t)(sentTorque >> 8) }; // a PDO is always 8 bytes
     device.sendPDO(INVERTER_RPDO1, data);
 };
 
@@ -114,9 +117,8 @@ void Inverter::loop() {
         // Control Word Read command
         // device.sendSDORead(INV_CW_INDEX, INV_CW_SUBINDEX);
 
-        while (sdoQueue.size() > 0) {
-            SDOMessage sdoMsg = sdoQueue.dequeue(0);
-
+        // drain in batches rather than checking size() before each item
+        sdoQueue.drainInto([&](SDOMessage const& sdoMsg) {
             // controlword message
             // if (sdoMsg.index == INVERTER_CONTROLWORD_INDEX && sdoMsg.subindex == INVERTER_CONTROLWORD_SUBINDEX) {
 
@@ -126,13 +128,14 @@ void Inverter::loop() {
             //         state = InverterStates::Drive;
             //     }
             // }
-        }
+        });
 
-        while (pdoQueue.size() > 0) {
-            PDOMessage pdoMsg = pdoQueue.dequeue(0);
+        pdoQueue.drainInto([&](CANFrameRef ref) {
+            CANMessage& pdoMsg = canFramePool.get(ref);
+            uint32_t cobID = pdoMsg.id - device.getNodeID();
 
             // Read Errors
-            if (pdoMsg.cobID == 0x180) {
+            if (cobID == 0x180) {
                 // int newWarning = pdoMsg.data[0] | (pdoMsg.data[1] << 8);
                 // if (newWarning != warningCode) {
                 //     ERROR("Inverter: Got warning code");
@@ -148,10 +151,12 @@ void Inverter::loop() {
                 // }
             }
 
-            else if (pdoMsg.cobID == 0x480) {
+            else if (cobID == 0x480) {
                 rpm = polarityFactor * (pdoMsg.data[1] | (pdoMsg.data[2] << 8) | (pdoMsg.data[3] << 16) | (pdoMsg.data[4] << 24));
             }
-        }
+
+            canFramePool.release(ref);
+        });
 
         if (errorCode != 0) {
             state = InverterStates::Error;
@@ -6,12 +6,46 @@
 namespace wrvcu {
 
 void ThrottleManager::init(ADC* adc) {
-    this->APPS1.init(adc, APPS1_CHANNEL, APPS1_ANGLE_OFFSET, APPS1_ANGLE_RANGE);
-    this->APPS2.init(adc, APPS2_CHANNEL, APPS2_ANGLE_OFFSET, APPS2_ANGLE_RANGE);
+    this->adc = adc;
+    snapshots.init();
+
+    this->APPS1.init(APPS1_CHANNEL, APPS1_ANGLE_OFFSET, APPS1_ANGLE_RANGE);
+    this->APPS2.init(APPS2_CHANNEL, APPS2_ANGLE_OFFSET, APPS2_ANGLE_RANGE);
+}
+
+void ThrottleManager::sample() {
+    uint16_t counts[ADC_NUM_CHANNELS];
+    adc->readAll(counts);
+
+    // each moving average takes one reading a cycle, however many checks read it
+    snapshot.apps1 = APPS1.filter(counts[APPS1.getChannel()]);
+    snapshot.apps2 = APPS2.filter(counts[APPS2.getChannel()]);
+    snapshot.brakePressure1 = filterBrakePressure1(counts[BRAKEPRESSURE1_CHANNEL]);
+    snapshot.brakePressure2 = counts[BRAKEPRESSURE2_CHANNEL];
+
+    float APPSFraction = APPS1.getSaturatedFraction(snapshot.apps1);
+    float regenFraction = APPS1.getRegenFraction(snapshot.apps1);
+    if (APPSFraction > 0.00f) {
+        snapshot.throttleFraction = APPSFraction;
+    } else {
+        snapshot.throttleFraction = regenFraction * MAX_APPS_REGEN_FRACTION * MAX_ACCELERATION_REGEN_FRACTION;
+    }
+
+    snapshots.post(snapshot);
+}
+
+bool ThrottleManager::getLatestSnapshot(PedalSnapshot& out) {
+    Mailbox<PedalSnapshot>::Item item;
+    if (!snapshots.read(item, 0)) {
+        return false;
+    }
+
+    out = item.value;
+    return true;
 }
 
 void ThrottleManager::checkAPPSConnected() {
-    if (!APPS1.isConnected() || !APPS2.isConnected()) {
+    if (!APPS1.isConnected(snapshot.apps1) || !APPS2.isConnected(snapshot.apps2)) {
         APPSDisconnectedError = true;
     } else {
         APPSDisconnectedError = false; // TEMPORARY RESET
@@ -19,7 +53,10 @@ void ThrottleManager::checkAPPSConnected() {
 }
 
 void ThrottleManager::checkAPPSPlausibility() {
-    if ((APPS1.getSaturatedFraction() > APPS2.getSaturatedFraction() + APPS_PLAUSIBILITY_FRACTION) || (APPS1.getSaturatedFraction() < APPS2.getSaturatedFraction() - APPS_PLAUSIBILITY_FRACTION)) {
+    float APPS1Fraction = APPS1.getSaturatedFraction(snapshot.apps1);
+    float APPS2Fraction = APPS2.getSaturatedFraction(snapshot.apps2);
+
+    if ((APPS1Fraction > APPS2Fraction + APPS_PLAUSIBILITY_FRACTION) || (APPS1Fraction < APPS2Fraction - APPS_PLAUSIBILITY_FRACTION)) {
         currentAPPSMillis = Task::millis();
 
         if (!plausibilityTimerStarted) {
@@ -65,14 +102,7 @@ bool ThrottleManager::isCriticalError() {
 }
 
 float ThrottleManager::getThrottleFraction() {
-
-    float APPSFraction = APPS1.getSaturatedFraction();
-    float regenFraction = APPS1.getRegenFraction();
-    if (APPSFraction > 0.00f) {
-        return APPSFraction;
-    } else {
-        return regenFraction * MAX_APPS_REGEN_FRACTION * MAX_ACCELERATION_REGEN_FRACTION;
-    }
+    return snapshot.throttleFraction;
 }
 
 float ThrottleManager::getTorqueRequestFraction() {
@@ -164,9 +194,7 @@ float ThrottleManager::getBrakeRegenFraction() {
     return regen_fraction;
 }
 
-int ThrottleManager::getBrakePressure1() {
-    uint16_t val = adc.read(BRAKEPRESSURE1_CHANNEL);
-
+uint16_t ThrottleManager::filterBrakePressure1(uint16_t val) {
     if (BRAKE_USE_SMOOTH) {
         brake_1_window_total = brake_1_window_total - brake_1_window_array[brake_1_window_index]; // Remove earliest reading from sum
         brake_1_window_array[brake_1_window_index] = val;                                         // Add reading to the array
@@ -183,8 +211,12 @@ int ThrottleManager::getBrakePressure1() {
     return val;
 }
 
+int ThrottleManager::getBrakePressure1() {
+    return snapshot.brakePressure1;
+}
+
 int ThrottleManager::getBrakePressure2() {
-    return adc.read(BRAKEPRESSURE2_CHANNEL);
+    return snapshot.brakePressure2;
 }
 
 bool ThrottleManager::brakesOn() {
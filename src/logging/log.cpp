@@ -5,6 +5,7 @@
 #include <rtos/task.hpp>
 
 #define LOGGING_TASK_PRIORITY (TASK_PRIORITY_DEFAULT - 3)
+#define LOGGING_TASK_STACK_DEPTH TASK_STACK_DEPTH_DEFAULT
 
 static LogLevel _levels[] = {
     LogLevel::INFO,  // STDOUT
@@ -30,7 +31,7 @@ struct LogMessage {
     const char* message;
 };
 
-static wrvcu::Task loggingTask;
+static wrvcu::StaticTask<LOGGING_TASK_STACK_DEPTH> loggingTask;
 static wrvcu::Queue<LogMessage, 512> loggingQueue;
 static File logFile;
 
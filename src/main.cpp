@@ -1,8 +1,11 @@
 #include "SD.h"
 #include "arduino_freertos.h"
 #include "can/CANController_T4.hpp"
+#include "can/CANGateway.hpp"
 #include "can/CANMessage.hpp"
 #include "can/CANOpenHost.hpp"
+#include "can/CANSignalMonitor.hpp"
+#include "can/CANTelemetryRoutes.hpp"
 #include "car.hpp"
 #include "constants.hpp"
 #include "pins.hpp"
@@ -16,8 +19,11 @@ Battery battery;
 ThrottleManager throttle;
 IMU imu;
 
-CANController_T4<CAN1> can1;
+CANController_T4<CAN1> can1; // powertrain: inverter, BMS and IVT
+CANController_T4<CAN3> can3; // telemetry and logging
+CANGateway gateway;
 CANOpenHost canOpen;
+CANSignalMonitor signalMonitor; // raises events when BMS and IVT signals time out, and counts those which are stale
 
 ADC adc(ADC_CS, &SPI);
 
@@ -29,36 +35,144 @@ void test_throttle_func();
 void test_rtos();
 void test_can();
 void test_inverter();
+void test_can_dispatch();
+void test_can_pool();
+void test_can_gateway();
+void test_virtual_can();
+void test_can_replay();
+void test_dbc_codec();
+void test_queue_batch();
+void test_spsc_queue();
+void test_task_alloc();
 
 using namespace wrvcu;
 
-static wrvcu::Task canLoggingTask;
-void canLoggingLoop() {
-    while (true) {
-        vcu_log_vcu_log_t log_msg;
-
-        log_msg.vcu_state = static_cast<int>(ts.getState());
-        log_msg.scmon = ts.checkSDC();
-        log_msg.apps_disconnect = throttle.APPSDisconnectedError;
-        log_msg.apps_plausibility = throttle.APPSPlausibilityError;
-        log_msg.brake_disconnect = throttle.brakeDisconnectedError;
-        log_msg.brake_plausibility = throttle.brakePlausibilityError;
-        log_msg.brake_hard = throttle.hardBrakeError;
-        log_msg.regen_active = ts.inRegenMode;
-        log_msg.apps_raw = vcu_log_vcu_log_apps_raw_encode(throttle.getThrottleFraction() * INVERTER_MAXMIMUM_TORQUE_REQUEST);
-        log_msg.brake_raw = throttle.getBrakePressure1();
+/**
+ * @brief Pack the CAN bus statistics for the last period into a VCU_CAN_DIAG frame.
+ *
+ * @param period_ms The time since the last diagnostics frame
+ * @param staleSignals The number of BMS and IVT signals which have timed out or never arrived
+ */
+static CANMessage packCANDiagnostics(uint32_t period_ms, uint32_t staleSignals) {
+    static CANBusLoadMeter busLoad;
+    static CANRxCounters lastCounters;
+
+    CANRxCounters counters = can1.get_rx_counters();
+    CANErrorCounters errors = can1.get_error_counters();
+
+    vcu_log_vcu_can_diag_t diag_msg;
+
+    // tenths of a percent is already the raw unit of BUS_LOAD
+    diag_msg.bus_load = busLoad.sample(can1.get_bus_bits(), micros(), can1.get_baud_rate());
+    diag_msg.fault_state = static_cast<int>(errors.state);
+    diag_msg.error_flags = errors.errorFlags;
+    diag_msg.tx_err_cnt = errors.txErrors;
+    diag_msg.rx_err_cnt = errors.rxErrors;
+    diag_msg.rx_rate = std::min<uint32_t>((counters.received - lastCounters.received) * 1000 / period_ms, 4095);
+    diag_msg.rx_dropped = std::min<uint32_t>(counters.dropped - lastCounters.dropped, 4095);
+    diag_msg.stale_signals = std::min<uint32_t>(staleSignals, 63);
+
+    lastCounters = counters;
+
+    CANMessage msg;
+    msg.id = VCU_LOG_VCU_CAN_DIAG_FRAME_ID;
+    msg.len = VCU_LOG_VCU_CAN_DIAG_LENGTH;
+    vcu_log_vcu_can_diag_pack((uint8_t*)&msg.data, &diag_msg, 8);
+
+    return msg;
+}
+
+/**
+ * @brief Send one VCU_TASK_LOAD frame per task with its CPU load over the last period. TASK_INDEX is the task's
+ * position in the "LOAD" lines of Task::print_load_report, which is the order they were started in.
+ *
+ */
+static void sendTaskLoads() {
+    static TaskRunStats stats[TASK_MAX_REPORTED];
+    int numTasks = Task::sample_run_stats(stats, TASK_MAX_REPORTED);
+
+    uint32_t cpuLoad = 0;
+    for (int i = 0; i < numTasks; i++) {
+        cpuLoad += stats[i].load_permille;
+    }
+
+    for (int i = 0; i < numTasks; i++) {
+        vcu_log_vcu_task_load_t load_msg;
+
+        // tenths of a percent is already the raw unit of CPU_LOAD and TASK_LOAD
+        load_msg.task_index = i;
+        load_msg.cpu_load = std::min<uint32_t>(cpuLoad, 1000);
+        load_msg.task_load = std::min<uint32_t>(stats[i].load_permille, 1000);
+        load_msg.switches = std::min<uint32_t>(stats[i].switches, 65535);
+        load_msg.max_run = std::min<uint32_t>(stats[i].maxRun_us, 65535);
 
         CANMessage msg;
-        msg.id = VCU_LOG_VCU_LOG_FRAME_ID;
-        msg.len = VCU_LOG_VCU_LOG_LENGTH;
-        vcu_log_vcu_log_pack((uint8_t*)&msg.data, &log_msg, 8);
+        msg.id = VCU_LOG_VCU_TASK_LOAD_FRAME_ID;
+        msg.len = VCU_LOG_VCU_TASK_LOAD_LENGTH;
+        vcu_log_vcu_task_load_pack((uint8_t*)&msg.data, &load_msg, 8);
+
+        can3.send(msg);
+    }
+}
+
+#define CAN_LOGGING_TASK_STACK_DEPTH TASK_STACK_DEPTH_DEFAULT
 
-        can1.send(msg);
+static wrvcu::StaticTask<CAN_LOGGING_TASK_STACK_DEPTH> canLoggingTask;
+void canLoggingLoop() {
+    int iteration = 0;
+
+    while (true) {
+        // the TS task's latest snapshot, rather than reading the pedals again from this task. Until its first cycle
+        // there isn't one, and zeros would log as released pedals, so the frame waits for it.
+        PedalSnapshot pedals;
+        if (throttle.getLatestSnapshot(pedals)) {
+            vcu_log_vcu_log_t log_msg;
+
+            log_msg.vcu_state = static_cast<int>(ts.getState());
+            log_msg.scmon = ts.checkSDC();
+            log_msg.apps_disconnect = throttle.APPSDisconnectedError;
+            log_msg.apps_plausibility = throttle.APPSPlausibilityError;
+            log_msg.brake_disconnect = throttle.brakeDisconnectedError;
+            log_msg.brake_plausibility = throttle.brakePlausibilityError;
+            log_msg.brake_hard = throttle.hardBrakeError;
+            log_msg.regen_active = ts.inRegenMode;
+
+            log_msg.apps_raw = vcu_log_vcu_log_apps_raw_encode(pedals.throttleFraction * INVERTER_MAXMIMUM_TORQUE_REQUEST);
+            log_msg.brake_raw = pedals.brakePressure1;
+
+            CANMessage msg;
+            msg.id = VCU_LOG_VCU_LOG_FRAME_ID;
+            msg.len = VCU_LOG_VCU_LOG_LENGTH;
+            vcu_log_vcu_log_pack((uint8_t*)&msg.data, &log_msg, 8);
+
+            can3.send(msg);
+        }
+
+        // powertrain bus diagnostics and task loads once a second
+        if (++iteration % 10 == 0) {
+            can3.send(packCANDiagnostics(1000, signalMonitor.getStaleSignals()));
+            sendTaskLoads();
+        }
 
         wrvcu::Task::delay(100);
     }
 }
 
+// The first stack report is once everything has started, then they are periodic. Collect them with stack_report.py.
+#define STACK_REPORT_BOOT_DELAY 5000 // ms
+#define STACK_REPORT_PERIOD 60000    // ms
+#define STACK_REPORT_TASK_STACK_DEPTH TASK_STACK_DEPTH_DEFAULT
+
+static wrvcu::StaticTask<STACK_REPORT_TASK_STACK_DEPTH> stackReportTask;
+void stackReportLoop() {
+    wrvcu::Task::delay(STACK_REPORT_BOOT_DELAY);
+
+    while (true) {
+        wrvcu::Task::print_stack_report();
+        wrvcu::Task::delay(STACK_REPORT_PERIOD);
+    }
+}
+
 void setup() {
     Serial.begin(115200);  // wait up to 2 seconds for serial connection
     Serial7.begin(115200); // For the display
@@ -111,12 +225,25 @@ void setup() {
 
     imu.init(&Wire2);
 
+    can1.set_rx_mode(CANRxMode::Interrupt);
     can1.init(TASK_PRIORITY_DEFAULT + 3);
     canOpen.init((&can1));
     inverter.init((&can1), 1);
 
     battery.init((&can1));
 
+    battery.watchSignals(&signalMonitor);
+    signalMonitor.init(CAN_SIGNAL_MONITOR_TASK_PRIORITY);
+
+    can3.set_rx_mode(CANRxMode::Interrupt);
+    can3.init(CAN_TASK_PRIORITY);
+    can3.set_tx_priority(VCU_LOG_VCU_LOG_FRAME_ID, CANTxPriority::Low);
+    can3.set_tx_priority(VCU_LOG_VCU_CAN_DIAG_FRAME_ID, CANTxPriority::Low);
+    can3.set_tx_priority(VCU_LOG_VCU_TASK_LOAD_FRAME_ID, CANTxPriority::Low);
+
+    // forward powertrain telemetry to the telemetry bus
+    addTelemetryRoutes(&gateway, &can1, &can3);
+
     adc.init(false);
     throttle.init(&adc);
 
@@ -125,6 +252,7 @@ void setup() {
     ts.init();
 
     canLoggingTask.start([] { canLoggingLoop(); }, TASK_PRIORITY_DEFAULT - 3, "CAN_Logging_Task");
+    stackReportTask.start([] { stackReportLoop(); }, TASK_PRIORITY_MIN, "Stack_Report_Task");
 
     startScheduler();
 
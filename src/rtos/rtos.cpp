@@ -14,6 +14,13 @@ void startScheduler() {
     Serial.flush();
 };
 
+void delayMicros(uint32_t us) {
+    if (us >= 1000) {
+        vTaskDelay(pdMS_TO_TICKS(us / 1000));
+    }
+    delayMicroseconds(us % 1000);
+}
+
 /**
  * @brief Check whether a pointer is on the stack.
  *
@@ -2,6 +2,61 @@
 
 namespace wrvcu {
 
+// every task started, for the stack and load reports
+static Task* startedTasks[TASK_MAX_REPORTED];
+static int numStartedTasks = 0;
+
+// A started task's index is kept in its application task tag, so the trace hooks find the running task without a
+// search. The tags are turned on by build_flags in platformio.ini, but FreeRTOSConfig.h belongs to the library, so if it
+// turns them off the hooks search the started tasks' handles instead.
+#if configUSE_APPLICATION_TASK_TAG != 1
+static TaskHandle_t startedHandles[TASK_MAX_REPORTED];
+#endif
+
+static void setTaskIndex(TaskHandle_t handle, int index) {
+#if configUSE_APPLICATION_TASK_TAG == 1
+    vTaskSetApplicationTaskTag(handle, reinterpret_cast<TaskHookFunction_t>(static_cast<uintptr_t>(index + 1)));
+#else
+    startedHandles[index] = handle;
+#endif
+}
+
+/**
+ * @brief Get a task's index in startedTasks. Safe to call from the trace hooks.
+ *
+ * @return int The index, or -1 if it wasn't started by Task::start, e.g. the idle task
+ */
+static int getTaskIndex(TaskHandle_t handle) {
+#if configUSE_APPLICATION_TASK_TAG == 1
+    return static_cast<int>(reinterpret_cast<uintptr_t>(xTaskGetApplicationTaskTagFromISR(handle))) - 1;
+#else
+    for (int i = 0; i < numStartedTasks; i++) {
+        if (startedHandles[i] == handle) {
+            return i;
+        }
+    }
+    return -1;
+#endif
+}
+
+/**
+ * @brief Run time of a started task, counted in DWT cycles by the scheduler's trace hooks, see task_trace.h.
+ *
+ */
+struct TaskRunCounters {
+    uint64_t cycles = 0;   // cycles run in total
+    uint32_t switches = 0; // times switched in
+    uint32_t maxRun = 0;   // longest activation since the last sample, in cycles
+};
+
+// indexed the same as startedTasks
+static TaskRunCounters runCounters[TASK_MAX_REPORTED];
+static TaskRunCounters lastSample[TASK_MAX_REPORTED];
+static uint32_t lastSampleCycles = 0;
+
+static int runningTask = -1; // index of the running task, -1 if it isn't a Task, e.g. the idle task
+static uint32_t switchedIn = 0;
+
 void Task::start(task_fn_t function, void* parameters, std::uint32_t prio, const char* name) {
     if (isOnStack((void*)&taskBuffer)) {
         printf("WARNING: Static task %s allocated on the stack! This WILL cause severe problems.\n", name);
@@ -9,9 +64,16 @@ void Task::start(task_fn_t function, void* parameters, std::uint32_t prio, const
     } else {             /* ok*/
     };
 
-    int stack_depth = sizeof(stack) / sizeof(stack[0]);
-    // create the task
-    task = xTaskCreateStatic(function, name, stack_depth, parameters, prio, stack, &taskBuffer);
+    // create the task, registering it before it can first be switched in
+    vTaskSuspendAll();
+    task = xTaskCreateStatic(function, name, stackDepth, parameters, prio, stack, &taskBuffer);
+
+    if (task != NULL && numStartedTasks < TASK_MAX_REPORTED) {
+        startedTasks[numStartedTasks] = this;
+        setTaskIndex(task, numStartedTasks);
+        numStartedTasks++;
+    }
+    xTaskResumeAll();
 
     if (task == NULL) {
         printf("Task %s was not created!\n", name);
@@ -32,6 +94,26 @@ Task Task::current() {
 }
 
 void Task::remove() {
+    vTaskSuspendAll();
+    int i = getTaskIndex(task);
+    if (i >= 0) {
+        // the last task takes the removed one's place
+        numStartedTasks--;
+        startedTasks[i] = startedTasks[numStartedTasks];
+        runCounters[i] = runCounters[numStartedTasks];
+        lastSample[i] = lastSample[numStartedTasks];
+        runCounters[numStartedTasks] = TaskRunCounters();
+        lastSample[numStartedTasks] = TaskRunCounters();
+        setTaskIndex(startedTasks[i]->task, i);
+
+        if (runningTask == i) {
+            runningTask = -1;
+        } else if (runningTask == numStartedTasks) {
+            runningTask = i;
+        }
+    }
+    xTaskResumeAll();
+
     vTaskDelete(task);
 }
 
@@ -47,6 +129,90 @@ std::uint32_t Task::get_state() {
     return eTaskGetState(task);
 }
 
+std::uint32_t Task::get_stack_depth() {
+    return stackDepth;
+}
+
+std::uint32_t Task::get_stack_high_water_mark() {
+    return uxTaskGetStackHighWaterMark(task);
+}
+
+void Task::print_stack_report() {
+    uint32_t total = 0;
+    uint32_t totalUsed = 0;
+
+    for (int i = 0; i < numStartedTasks; i++) {
+        Task* t = startedTasks[i];
+        uint32_t depth = t->get_stack_depth();
+        uint32_t used = depth - t->get_stack_high_water_mark();
+
+        printf("STACK %-24s %5lu words, %5lu used, %3lu%%\n", t->get_name(), (unsigned long)depth, (unsigned long)used,
+            (unsigned long)(used * 100 / depth));
+
+        total += depth;
+        totalUsed += used;
+    }
+
+    printf("STACK total %lu bytes, %lu used\n", (unsigned long)(total * sizeof(StackType_t)),
+        (unsigned long)(totalUsed * sizeof(StackType_t)));
+}
+
+int Task::sample_run_stats(TaskRunStats* stats, int maxStats) {
+    uint32_t cyclesPerMicro = F_CPU_ACTUAL / 1000000;
+
+    TaskRunCounters counters[TASK_MAX_REPORTED];
+    int numTasks;
+    uint32_t now;
+
+    taskENTER_CRITICAL();
+    now = ARM_DWT_CYCCNT;
+    numTasks = numStartedTasks;
+    for (int i = 0; i < numTasks; i++) {
+        counters[i] = runCounters[i];
+        runCounters[i].maxRun = 0;
+    }
+
+    // the caller's own activation is still running
+    if (runningTask >= 0) {
+        counters[runningTask].cycles += now - switchedIn;
+    }
+    taskEXIT_CRITICAL();
+
+    uint32_t elapsed = now - lastSampleCycles;
+    lastSampleCycles = now;
+
+    int n = 0;
+    for (int i = 0; i < numTasks; i++) {
+        if (n < maxStats) {
+            TaskRunStats& out = stats[n++];
+            out.name = startedTasks[i]->get_name();
+            uint64_t run = counters[i].cycles - lastSample[i].cycles;
+            out.load_permille = elapsed == 0 ? 0 : (uint32_t)(run * 1000 / elapsed);
+            out.run_us = (uint32_t)(run / cyclesPerMicro);
+            out.switches = counters[i].switches - lastSample[i].switches;
+            out.maxRun_us = counters[i].maxRun / cyclesPerMicro;
+        }
+        lastSample[i] = counters[i];
+    }
+
+    return n;
+}
+
+void Task::print_load_report() {
+    TaskRunStats stats[TASK_MAX_REPORTED];
+    int numTasks = sample_run_stats(stats, TASK_MAX_REPORTED);
+
+    uint32_t total = 0;
+    for (int i = 0; i < numTasks; i++) {
+        printf("LOAD %2d %-24s %3lu.%lu%%, %5lu switches, %6lu us max\n", i, stats[i].name,
+            (unsigned long)(stats[i].load_permille / 10), (unsigned long)(stats[i].load_permille % 10),
+            (unsigned long)stats[i].switches, (unsigned long)stats[i].maxRun_us);
+        total += stats[i].load_permille;
+    }
+
+    printf("LOAD total %lu.%lu%%\n", (unsigned long)(total / 10), (unsigned long)(total % 10));
+}
+
 void Task::suspend() {
     vTaskSuspend(task);
 }
@@ -63,6 +229,12 @@ void Task::notify() {
     xTaskNotifyGive(task);
 }
 
+void Task::notify_from_isr() {
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(task, &higherPriorityTaskWoken);
+    portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
 // void Task::join() {
 //     if (!task)
 //         return;
@@ -96,4 +268,29 @@ uint32_t Task::millis() {
 //     return task_get_count();
 // }
 
-} // namespace wrvcu
\ No newline at end of file
+} // namespace wrvcu
+
+// Called by the scheduler with interrupts masked, so the counters need no locking
+
+extern "C" void wrvcu_task_switched_out(void) {
+    if (wrvcu::runningTask >= 0) {
+        uint32_t run = ARM_DWT_CYCCNT - wrvcu::switchedIn;
+
+        wrvcu::TaskRunCounters& counters = wrvcu::runCounters[wrvcu::runningTask];
+        counters.cycles += run;
+        if (run > counters.maxRun) {
+            counters.maxRun = run;
+        }
+    }
+}
+
+extern "C" void wrvcu_task_switched_in(void) {
+    int i = wrvcu::getTaskIndex(xTaskGetCurrentTaskHandle());
+
+    wrvcu::runningTask = i;
+    if (i >= 0) {
+        wrvcu::runCounters[i].switches++;
+    }
+
+    wrvcu::switchedIn = ARM_DWT_CYCCNT;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "arduino_freertos.h"
+#include <cstdint>
+
+/**
+ * @brief Print one line of a benchmark's results: the time taken, the time per item, and the time as a percentage of
+ * a baseline run of the same items.
+ *
+ * @param name The run, padded so the lines of a table line up
+ * @param time The run's time in microseconds
+ * @param items The number of items the run handled
+ * @param baseline The baseline's time in microseconds
+ * @param baselineName What the baseline is, e.g. "FreeRTOS queue"
+ *
+ * On virtual time code between kernel calls takes none, so a run can take 0 us, and is compared as 100%.
+ */
+inline void printBenchResult(const char* name, uint32_t time, uint32_t items, uint32_t baseline, const char* baselineName) {
+    printf("  %-28s %8lu us, %5lu ns each, %3lu%% of %s\n", name, (unsigned long)time,
+        (unsigned long)(items > 0 ? time * 1000ULL / items : 0),
+        (unsigned long)(baseline > 0 ? time * 100ULL / baseline : 100), baselineName);
+}
@@ -1,10 +1,14 @@
 #include "arduino_freertos.h"
 #include "rtos/rtos.hpp"
 #include <can/CANController_T4.hpp>
+#include <can/CANFDController_T4.hpp>
 
 using namespace wrvcu;
 
-static Task taskA;
+// nothing on the car uses CAN FD yet, so compile every member here to keep the controller building
+template class wrvcu::CANFDController_T4<CAN3>;
+
+static StaticTask<> taskA;
 
 static CANController_T4<CAN1> can1;
 static CANController_T4<CAN3> can2;
@@ -12,7 +16,6 @@ static CANController_T4<CAN3> can2;
 static Queue<CANMessage, 256> canQueue;
 
 void test_can_task() {
-    can2.subscribe(0, &canQueue);
     while (true) {
 
         if (canQueue.size() > 0) {
@@ -59,6 +62,7 @@ void test_can() {
     can2.init(TASK_PRIORITY_DEFAULT + 3);
 
     canQueue.init();
+    can2.subscribe(0, &canQueue); // subscribe before the CAN task starts dispatching
 
     startScheduler();
 }
\ No newline at end of file
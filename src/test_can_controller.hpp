@@ -0,0 +1,51 @@
+#pragma once
+
+#include "arduino_freertos.h"
+#include <can/AbstractCANController.hpp>
+
+namespace wrvcu {
+
+/**
+ * @brief A controller with no hardware behind it, for the test harnesses. Received frames are posted directly, and
+ * sent frames only counted.
+ *
+ */
+class TestCANController : public AbstractCANController {
+public:
+    uint32_t sent = 0;
+    uint32_t refused = 0;
+
+    bool full = false; // refuse every frame sent, as a full transmit queue does
+
+    void init(uint32_t task_priority) override {
+        freeze_subscriptions();
+    };
+
+    void set_baud_rate(const uint32_t baud_rate) override {};
+
+    bool send(CANMessage const& message) override {
+        if (full) {
+            refused++;
+            return false;
+        }
+
+        sent++;
+        return true;
+    };
+
+    void receive(CANMessage const& message, uint32_t rx_us) {
+        post(message, rx_us);
+    }
+
+    /**
+     * @brief Receive a frame the way a hardware controller does, writing it only once its subscriber is found.
+     *
+     * @param fill Callable writing the message into the CANMessage it is given.
+     */
+    template <class F>
+    void receive(uint32_t id, F&& fill, uint32_t rx_us) {
+        post(id, fill, rx_us);
+    }
+};
+
+}
@@ -0,0 +1,178 @@
+#include "arduino_freertos.h"
+#include "battery.h"
+#include "constants.hpp"
+#include "rtos/rtos.hpp"
+#include "test_bench.hpp"
+#include "test_can_controller.hpp"
+#include <map>
+
+using namespace wrvcu;
+
+#define DISPATCH_BENCH_FRAMES 100000
+#define DISPATCH_BENCH_INVERTER_NODE 1
+
+/**
+ * @brief Keeps the original std::map of queues alongside the flat table, with the original post(): a find(), then an
+ * at() and a blocking enqueue.
+ */
+class DispatchBenchCANController : public TestCANController {
+    std::map<uint32_t, Queue<CANMessage, 256>*> mapSubscribers;
+
+public:
+    void subscribeBoth(uint16_t id, Queue<CANMessage, 256>* queue) {
+        subscribe(id, queue);
+        mapSubscribers.emplace(id, queue);
+    }
+
+    int numSubscriptions() {
+        return _subscribers.size();
+    }
+
+    bool findFlat(uint32_t id) {
+        return _subscribers.find(id) != nullptr;
+    }
+
+    bool findMap(uint32_t id) {
+        return mapSubscribers.find(id) != mapSubscribers.end();
+    }
+
+    void postFlat(CANMessage const& message) {
+        post(message, micros());
+    }
+
+    // post() as it was before the flat table
+    void postMap(CANMessage const& message) {
+        if (mapSubscribers.find(message.id) == mapSubscribers.end())
+            return; // no subscriber for this ID, so skip
+
+        auto&& queue = mapSubscribers.at(message.id);
+        queue->enqueue(message, TIMEOUT_MAX); // enqueue the message
+    }
+};
+
+static DispatchBenchCANController benchCan;
+static Queue<CANMessage, 256> batteryQueue;
+static Queue<CANMessage, 256> inverterQueue;
+static StaticTask<> benchTask;
+
+static volatile uint32_t lookupSink;
+
+// Traffic seen on the car's bus: the subscribed battery and inverter frames, plus frames nobody subscribes to.
+static const uint32_t busIDs[] = {
+    BATTERY_IVT_MSG_RESULT_I_FRAME_ID,
+    BATTERY_IVT_MSG_RESULT_U1_FRAME_ID,
+    INVERTER_TPDO1 + DISPATCH_BENCH_INVERTER_NODE,
+    BATTERY_BMS_BATT_STATUS_FRAME_ID,
+    BATTERY_IVT_MSG_RESULT_U2_FRAME_ID,
+    0x80, // CANopen SYNC
+    BATTERY_IVT_MSG_RESULT_U3_FRAME_ID,
+    INVERTER_TPDO4 + DISPATCH_BENCH_INVERTER_NODE,
+    INVERTER_RPDO1 + DISPATCH_BENCH_INVERTER_NODE,
+    BATTERY_IVT_MSG_RESULT_W_FRAME_ID,
+    BATTERY_BMS_AVAIL_CURRENT_FRAME_ID,
+    HEARTBEAT_COB_ID + VCU_NODE_ID,
+    BATTERY_BMS_CELL_STATUS_TEMPERATURES_FRAME_ID,
+    INVERTER_TPDO2 + DISPATCH_BENCH_INVERTER_NODE,
+    BATTERY_BMS_CELL_STATUS_VOLTAGES_FRAME_ID,
+    BATTERY_IVT_MSG_RESULT_T_FRAME_ID,
+    BATTERY_IMD_INFO_FRAME_ID,
+    INVERTER_TPDO3 + DISPATCH_BENCH_INVERTER_NODE,
+    HEARTBEAT_COB_ID + DISPATCH_BENCH_INVERTER_NODE,
+    BATTERY_CHARGER_REQUEST_FRAME_ID,
+};
+
+/**
+ * @brief Post DISPATCH_BENCH_FRAMES frames through a dispatch function.
+ *
+ * @return uint32_t The time taken in microseconds
+ */
+template <class F>
+static uint32_t runDispatchBench(F&& postFunction) {
+    const int numIDs = sizeof(busIDs) / sizeof(busIDs[0]);
+    CANMessage msg;
+
+    batteryQueue.reset();
+    inverterQueue.reset();
+
+    uint32_t start = micros();
+    for (int i = 0; i < DISPATCH_BENCH_FRAMES; i++) {
+        msg.id = busIDs[i % numIDs];
+        postFunction(msg);
+
+        // empty the queues before they fill, so enqueue never blocks
+        if ((i & 127) == 127) {
+            batteryQueue.reset();
+            inverterQueue.reset();
+        }
+    }
+    return micros() - start;
+}
+
+/**
+ * @brief Look up the ID of DISPATCH_BENCH_FRAMES frames, subscribed or not, without posting them.
+ *
+ * @return uint32_t The time taken in microseconds
+ */
+template <class F>
+static uint32_t runLookupBench(F&& findFunction) {
+    const int numIDs = sizeof(busIDs) / sizeof(busIDs[0]);
+    uint32_t found = 0;
+
+    uint32_t start = micros();
+    for (int i = 0; i < DISPATCH_BENCH_FRAMES; i++) {
+        found += findFunction(busIDs[i % numIDs]);
+    }
+    uint32_t time = micros() - start;
+
+    lookupSink = found;
+    return time;
+}
+
+void test_can_dispatch_task() {
+    uint32_t mapLookupTime = runLookupBench([](uint32_t id) { return benchCan.findMap(id); });
+    uint32_t flatLookupTime = runLookupBench([](uint32_t id) { return benchCan.findFlat(id); });
+
+    uint32_t mapTime = runDispatchBench([](CANMessage const& msg) { benchCan.postMap(msg); });
+    uint32_t flatTime = runDispatchBench([](CANMessage const& msg) { benchCan.postFlat(msg); });
+
+    printf("CAN dispatch: %d frames, %d subscribed IDs, %lu of the frames subscribed\n", DISPATCH_BENCH_FRAMES,
+        benchCan.numSubscriptions(), (unsigned long)lookupSink);
+    printBenchResult("lookup, std::map", mapLookupTime, DISPATCH_BENCH_FRAMES, mapLookupTime, "std::map");
+    printBenchResult("lookup, flat table", flatLookupTime, DISPATCH_BENCH_FRAMES, mapLookupTime, "std::map");
+    printBenchResult("post(), std::map as it was", mapTime, DISPATCH_BENCH_FRAMES, mapTime, "std::map");
+    printBenchResult("post(), flat table", flatTime, DISPATCH_BENCH_FRAMES, mapTime, "std::map");
+
+    while (true) {
+        Task::delay(1000);
+    }
+}
+
+void test_can_dispatch() {
+    batteryQueue.init();
+    inverterQueue.init();
+
+    // the real battery and inverter subscription set
+    benchCan.subscribeBoth(BATTERY_BMS_AVAIL_CURRENT_FRAME_ID, &batteryQueue);
+    benchCan.subscribeBoth(BATTERY_BMS_BATT_STATUS_FRAME_ID, &batteryQueue);
+    benchCan.subscribeBoth(BATTERY_BMS_CELL_STATUS_TEMPERATURES_FRAME_ID, &batteryQueue);
+    benchCan.subscribeBoth(BATTERY_BMS_CELL_STATUS_VOLTAGES_FRAME_ID, &batteryQueue);
+    benchCan.subscribeBoth(BATTERY_IMD_INFO_FRAME_ID, &batteryQueue);
+    benchCan.subscribeBoth(BATTERY_IVT_MSG_RESULT_I_FRAME_ID, &batteryQueue);
+    benchCan.subscribeBoth(BATTERY_IVT_MSG_RESULT_U1_FRAME_ID, &batteryQueue);
+    benchCan.subscribeBoth(BATTERY_IVT_MSG_RESULT_U2_FRAME_ID, &batteryQueue);
+    benchCan.subscribeBoth(BATTERY_IVT_MSG_RESULT_U3_FRAME_ID, &batteryQueue);
+    benchCan.subscribeBoth(BATTERY_IVT_MSG_RESULT_W_FRAME_ID, &batteryQueue);
+
+    benchCan.subscribeBoth(HEARTBEAT_COB_ID + DISPATCH_BENCH_INVERTER_NODE, &inverterQueue);
+    benchCan.subscribeBoth(SDO_RESPONSE_COB_ID + DISPATCH_BENCH_INVERTER_NODE, &inverterQueue);
+    benchCan.subscribeBoth(INVERTER_TPDO1 + DISPATCH_BENCH_INVERTER_NODE, &inverterQueue);
+    benchCan.subscribeBoth(INVERTER_TPDO2 + DISPATCH_BENCH_INVERTER_NODE, &inverterQueue);
+    benchCan.subscribeBoth(INVERTER_TPDO3 + DISPATCH_BENCH_INVERTER_NODE, &inverterQueue);
+    benchCan.subscribeBoth(INVERTER_TPDO4 + DISPATCH_BENCH_INVERTER_NODE, &inverterQueue);
+
+    benchCan.init(TASK_PRIORITY_DEFAULT);
+
+    benchTask.start(test_can_dispatch_task, TASK_PRIORITY_DEFAULT, "CAN_Dispatch_Bench");
+
+    startScheduler();
+}
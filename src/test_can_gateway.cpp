@@ -0,0 +1,152 @@
+#include "arduino_freertos.h"
+#include "battery.h"
+#include "constants.hpp"
+#include "rtos/rtos.hpp"
+#include "test_can_controller.hpp"
+#include <can/CANGateway.hpp>
+#include <can/CANTelemetryRoutes.hpp>
+
+using namespace wrvcu;
+
+#define GATEWAY_BENCH_FRAMES 100000
+#define GATEWAY_CHECK_FRAME_US 100 // time between frames in the check, so each ID arrives every ms
+
+static TestCANController powertrainCan;
+static TestCANController telemetryCan;
+static CANGateway benchGateway;
+static TestCANController checkPowertrainCan;
+static TestCANController checkTelemetryCan;
+static CANGateway checkGateway;
+static StaticTask<> benchTask;
+
+// Powertrain traffic, most of which the gateway forwards
+static const uint32_t busIDs[] = {
+    BATTERY_IVT_MSG_RESULT_I_FRAME_ID,
+    BATTERY_IVT_MSG_RESULT_U1_FRAME_ID,
+    INVERTER_TPDO1 + 1,
+    BATTERY_BMS_BATT_STATUS_FRAME_ID,
+    BATTERY_IVT_MSG_RESULT_U2_FRAME_ID,
+    INVERTER_TPDO4 + 1,
+    BATTERY_BMS_CELL_STATUS_VOLTAGES_FRAME_ID,
+    BATTERY_IVT_MSG_RESULT_W_FRAME_ID,
+    BATTERY_BMS_CELL_STATUS_TEMPERATURES_FRAME_ID,
+    BATTERY_IVT_MSG_RESULT_U3_FRAME_ID,
+};
+
+#define GATEWAY_NUM_IDS (sizeof(busIDs) / sizeof(busIDs[0]))
+
+// What each of the car's routes forwards in the check, with every ID arriving once a ms for 10 s. The 100 ms routes
+// forward every 100th frame, and the IVT route every frame of its five IDs.
+static const uint32_t expectedForwarded[] = {
+    100,   // cell voltages
+    100,   // cell temperatures
+    100,   // battery status
+    50000, // IVT results
+    100,   // inverter speed
+};
+
+/**
+ * @brief Post frames through the car's routes at a fixed rate, so each route should forward what its rate limit allows.
+ *
+ */
+static void runCheck() {
+    CANMessage msg;
+
+    for (int i = 0; i < GATEWAY_BENCH_FRAMES; i++) {
+        msg.id = busIDs[i % GATEWAY_NUM_IDS];
+        checkPowertrainCan.receive(msg, (uint32_t)i * GATEWAY_CHECK_FRAME_US);
+    }
+}
+
+/**
+ * @brief Post a second of frames while the destination's transmit queue is full.
+ *
+ * @return bool Whether every refused frame was counted as dropped, and none as forwarded
+ */
+static bool runDropCheck() {
+    CANMessage msg;
+    uint32_t forwardedBefore = 0;
+    uint32_t droppedBefore = 0;
+
+    for (int r = 0; r < checkGateway.getNumRoutes(); r++) {
+        forwardedBefore += checkGateway.getRouteStats(r).forwarded;
+        droppedBefore += checkGateway.getRouteStats(r).dropped;
+    }
+
+    checkTelemetryCan.full = true;
+    for (int i = GATEWAY_BENCH_FRAMES; i < GATEWAY_BENCH_FRAMES + 10000; i++) {
+        msg.id = busIDs[i % GATEWAY_NUM_IDS];
+        checkPowertrainCan.receive(msg, (uint32_t)i * GATEWAY_CHECK_FRAME_US);
+    }
+    checkTelemetryCan.full = false;
+
+    uint32_t forwarded = 0;
+    uint32_t dropped = 0;
+    for (int r = 0; r < checkGateway.getNumRoutes(); r++) {
+        forwarded += checkGateway.getRouteStats(r).forwarded;
+        dropped += checkGateway.getRouteStats(r).dropped;
+    }
+
+    printf("  destination full: %lu dropped of %lu refused, %lu forwarded\n", (unsigned long)(dropped - droppedBefore),
+        (unsigned long)checkTelemetryCan.refused, (unsigned long)(forwarded - forwardedBefore));
+
+    return checkTelemetryCan.refused > 0 && dropped - droppedBefore == checkTelemetryCan.refused && forwarded == forwardedBefore;
+}
+
+void test_can_gateway_task() {
+    CANMessage msg;
+
+    uint32_t start = micros();
+    for (int i = 0; i < GATEWAY_BENCH_FRAMES; i++) {
+        msg.id = busIDs[i % GATEWAY_NUM_IDS];
+        powertrainCan.receive(msg, micros());
+    }
+    uint32_t time = micros() - start;
+
+    runCheck();
+
+    // on virtual time the frames take no time at all
+    printf("CAN gateway: %d frames in %lu us, %lu frames/s\n", GATEWAY_BENCH_FRAMES, (unsigned long)time,
+        (unsigned long)(time > 0 ? GATEWAY_BENCH_FRAMES * 1000000ULL / time : 0));
+    printf("  forwarding at %d us per frame, latency to the destination's queue at full speed\n", GATEWAY_CHECK_FRAME_US);
+
+    bool pass = checkGateway.getNumRoutes() == sizeof(expectedForwarded) / sizeof(expectedForwarded[0]);
+    uint32_t total = 0;
+
+    for (int r = 0; r < checkGateway.getNumRoutes(); r++) {
+        CANRouteStats stats = checkGateway.getRouteStats(r);
+        CANRouteStats benchStats = benchGateway.getRouteStats(r);
+        uint32_t expected = r < (int)(sizeof(expectedForwarded) / sizeof(expectedForwarded[0])) ? expectedForwarded[r] : 0;
+
+        printf("  route %d: %lu forwarded of %lu expected, %lu rate limited, latency min %lu avg %lu max %lu us\n", r,
+            (unsigned long)stats.forwarded, (unsigned long)expected, (unsigned long)stats.rateLimited,
+            (unsigned long)benchStats.latency.min_us, (unsigned long)benchStats.latency.avg_us(),
+            (unsigned long)benchStats.latency.max_us);
+
+        pass = pass && stats.forwarded == expected;
+        total += stats.forwarded;
+    }
+    pass = pass && checkTelemetryCan.sent == total;
+    pass = runDropCheck() && pass;
+
+    printf("%s\n", pass ? "PASS: each route forwarded what its rate limit allows, and counted frames dropped" : "FAIL");
+
+    while (true) {
+        Task::delay(1000);
+    }
+}
+
+void test_can_gateway() {
+    // the car's routes
+    addTelemetryRoutes(&benchGateway, &powertrainCan, &telemetryCan);
+    addTelemetryRoutes(&checkGateway, &checkPowertrainCan, &checkTelemetryCan);
+
+    powertrainCan.init(TASK_PRIORITY_DEFAULT);
+    telemetryCan.init(TASK_PRIORITY_DEFAULT);
+    checkPowertrainCan.init(TASK_PRIORITY_DEFAULT);
+    checkTelemetryCan.init(TASK_PRIORITY_DEFAULT);
+
+    benchTask.start(test_can_gateway_task, TASK_PRIORITY_DEFAULT, "CAN_Gateway_Bench");
+
+    startScheduler();
+}
@@ -0,0 +1,168 @@
+#include "arduino_freertos.h"
+#include "can/CANOpenDevice.hpp"
+#include "constants.hpp"
+#include "rtos/rtos.hpp"
+#include "test_can_controller.hpp"
+#include <FlexCAN_T4.h>
+
+using namespace wrvcu;
+
+#define POOL_BENCH_FRAMES 20480 // a whole number of batches of 64
+#define POOL_BENCH_INVERTER_NODE 1
+
+/**
+ * @brief Copies of frame data made along one path, counted where they happen.
+ *
+ */
+struct CopyCount {
+    uint32_t copies = 0;
+    uint32_t bytes = 0;
+
+    void add(uint32_t size, uint32_t count = 1) {
+        copies += count;
+        bytes += size * count;
+    }
+};
+
+static TestCANController copyCan;
+static TestCANController refCan;
+
+// the original path: CANMessage copies into the device queue, PDOMessage copies into the inverter queue
+static Queue<CANMessage, 256> copyDeviceQueue;
+static Queue<PDOMessage, 256> copyInverterQueue;
+
+// the pool path: handles into the device queue, the same handles into the inverter queue
+static Queue<CANFrameRef, 256> refDeviceQueue;
+static Queue<CANFrameRef, 256> refInverterQueue;
+
+static StaticTask<> benchTask;
+
+static volatile int32_t rpmSink;
+
+// frame data copied along each path, and handles moved along the pool path
+static CopyCount copyPathCopies;
+static CopyCount refPathCopies;
+static CopyCount refPathHandles;
+
+/**
+ * @brief Convert a FlexCAN message as the receive path does, counting the copy.
+ *
+ */
+static void convertCounted(CAN_message_t const& msg, CANMessage& out, CopyCount& count) {
+    out.id = msg.id;
+    out.len = msg.len;
+    out.timestamp = msg.timestamp;
+    memcpy(out.data, msg.buf, sizeof(out.data));
+    count.add(sizeof(CANMessage));
+}
+
+template <typename T>
+static T dequeueCounted(Queue<T, 256>& queue, CopyCount& count) {
+    T item = queue.dequeue(0);
+    count.add(sizeof(T));
+    return item;
+}
+
+template <typename T>
+static void enqueueCounted(Queue<T, 256>& queue, T const& item, CopyCount& count) {
+    queue.enqueue(item, 0);
+    count.add(sizeof(T));
+}
+
+/**
+ * @brief Push POOL_BENCH_FRAMES inverter PDOs from the receive path through to the inverter, the way the CAN,
+ * CANOpen and inverter tasks do, in batches small enough that no queue fills.
+ *
+ * @return uint32_t The time taken in microseconds
+ */
+template <class R, class D, class I>
+static uint32_t runPoolBench(R&& receive, D&& device, I&& inverter) {
+    CAN_message_t msg;
+    msg.id = INVERTER_TPDO4 + POOL_BENCH_INVERTER_NODE;
+    msg.len = 8;
+
+    uint32_t start = micros();
+    for (int i = 0; i < POOL_BENCH_FRAMES; i += 64) {
+        for (int j = 0; j < 64; j++) {
+            msg.buf[1] = j;
+            receive(msg);
+        }
+        for (int j = 0; j < 64; j++) {
+            device();
+        }
+        for (int j = 0; j < 64; j++) {
+            inverter();
+        }
+    }
+    return micros() - start;
+}
+
+void test_can_pool_task() {
+    uint32_t copyTime = runPoolBench(
+        [](CAN_message_t const& msg) {
+            copyCan.receive(msg.id, [&msg](CANMessage& out) { convertCounted(msg, out, copyPathCopies); }, micros());
+        },
+        [] {
+            CANMessage canMessage = dequeueCounted(copyDeviceQueue, copyPathCopies);
+            PDOMessage pdoMessage = { .cobID = canMessage.id - POOL_BENCH_INVERTER_NODE };
+            memcpy(pdoMessage.data, canMessage.data, 8);
+            copyPathCopies.add(sizeof(PDOMessage));
+            enqueueCounted(copyInverterQueue, pdoMessage, copyPathCopies);
+        },
+        [] {
+            PDOMessage pdoMsg = dequeueCounted(copyInverterQueue, copyPathCopies);
+            rpmSink = pdoMsg.data[1] | (pdoMsg.data[2] << 8);
+        });
+
+    uint32_t refTime = runPoolBench(
+        [](CAN_message_t const& msg) {
+            refCan.receive(msg.id, [&msg](CANMessage& out) { convertCounted(msg, out, refPathCopies); }, micros());
+        },
+        [] {
+            CANFrameRef ref = dequeueCounted(refDeviceQueue, refPathHandles);
+            enqueueCounted(refInverterQueue, ref, refPathHandles);
+        },
+        [] {
+            CANFrameRef ref = dequeueCounted(refInverterQueue, refPathHandles);
+            CANMessage& pdoMsg = canFramePool.get(ref);
+            rpmSink = pdoMsg.data[1] | (pdoMsg.data[2] << 8);
+            canFramePool.release(ref);
+        });
+
+    // the controllers' enqueues into the device queues, from what they delivered
+    copyPathCopies.add(sizeof(CANMessage), copyCan.get_rx_counters().dispatched);
+    refPathHandles.add(sizeof(CANFrameRef), refCan.get_rx_counters().dispatched);
+
+    printf("CAN frame pool: %d PDO frames from receive to inverter, per frame\n", POOL_BENCH_FRAMES);
+    printf("  copies: %.1f copies, %.1f bytes moved, %lu us\n", (double)copyPathCopies.copies / POOL_BENCH_FRAMES,
+        (double)copyPathCopies.bytes / POOL_BENCH_FRAMES, (unsigned long)copyTime);
+    printf("  pool  : %.1f copies + %.1f handle moves, %.1f bytes moved, %lu us\n",
+        (double)refPathCopies.copies / POOL_BENCH_FRAMES, (double)refPathHandles.copies / POOL_BENCH_FRAMES,
+        (double)(refPathCopies.bytes + refPathHandles.bytes) / POOL_BENCH_FRAMES, (unsigned long)refTime);
+    printf("  queue storage: %lu bytes vs %lu bytes (+ %lu byte pool)\n",
+        (unsigned long)(sizeof(CANMessage) * 256 + sizeof(PDOMessage) * 256),
+        (unsigned long)(sizeof(CANFrameRef) * 256 * 2),
+        (unsigned long)sizeof(CANFramePool));
+    printf("  pool free after run: %lu of %d\n", (unsigned long)canFramePool.available(), CAN_FRAME_POOL_SIZE);
+
+    while (true) {
+        Task::delay(1000);
+    }
+}
+
+void test_can_pool() {
+    copyDeviceQueue.init();
+    copyInverterQueue.init();
+    refDeviceQueue.init();
+    refInverterQueue.init();
+
+    copyCan.subscribe(INVERTER_TPDO4 + POOL_BENCH_INVERTER_NODE, &copyDeviceQueue);
+    refCan.subscribe(INVERTER_TPDO4 + POOL_BENCH_INVERTER_NODE, &refDeviceQueue);
+
+    copyCan.init(TASK_PRIORITY_DEFAULT);
+    refCan.init(TASK_PRIORITY_DEFAULT);
+
+    benchTask.start(test_can_pool_task, TASK_PRIORITY_DEFAULT, "CAN_Pool_Bench");
+
+    startScheduler();
+}
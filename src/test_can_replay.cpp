@@ -0,0 +1,148 @@
+#include "arduino_freertos.h"
+#include "battery.h"
+#include "constants.hpp"
+#include "devices/battery.hpp"
+#include "logging/log.hpp"
+#include "rtos/rtos.hpp"
+#include <can/CANReplay.hpp>
+
+using namespace wrvcu;
+
+// A 30 minute endurance run
+#define REPLAY_BENCH_DURATION_S (30 * 60)
+
+// 0 replays as fast as possible, to measure ingest rate
+#define REPLAY_BENCH_SPEED 0
+
+/**
+ * @brief Writes a candump log of powertrain traffic as it is read, so a race's worth of frames doesn't need storing.
+ *
+ */
+class ReplayBenchLineSource : public CANLineSource {
+    uint32_t frame = 0;
+
+public:
+    uint32_t numFrames;
+
+    ReplayBenchLineSource(uint32_t inumFrames) : numFrames(inumFrames) {};
+
+    bool readLine(char* line, int maxLen) override;
+};
+
+// The BMS, IVT and inverter frames seen on CAN1, each sent every 10 ms
+static const uint32_t raceIDs[] = {
+    BATTERY_BMS_AVAIL_CURRENT_FRAME_ID,
+    BATTERY_BMS_BATT_STATUS_FRAME_ID,
+    BATTERY_BMS_CELL_STATUS_TEMPERATURES_FRAME_ID,
+    BATTERY_BMS_CELL_STATUS_VOLTAGES_FRAME_ID,
+    BATTERY_IMD_INFO_FRAME_ID,
+    BATTERY_IVT_MSG_RESULT_I_FRAME_ID,
+    BATTERY_IVT_MSG_RESULT_U1_FRAME_ID,
+    BATTERY_IVT_MSG_RESULT_U2_FRAME_ID,
+    BATTERY_IVT_MSG_RESULT_U3_FRAME_ID,
+    BATTERY_IVT_MSG_RESULT_W_FRAME_ID,
+    INVERTER_TPDO1 + 1,
+    INVERTER_TPDO2 + 1,
+    INVERTER_TPDO3 + 1,
+    INVERTER_TPDO4 + 1,
+};
+static const int numRaceIDs = sizeof(raceIDs) / sizeof(raceIDs[0]);
+
+bool ReplayBenchLineSource::readLine(char* line, int maxLen) {
+    if (frame >= numFrames) {
+        return false;
+    }
+
+    // every ID once per 10 ms cycle, spread evenly through it
+    uint64_t timestamp_us = 1700000000000000ULL + (uint64_t)frame * 10000 / numRaceIDs;
+    uint32_t id = raceIDs[frame % numRaceIDs];
+    uint32_t value = frame / numRaceIDs;
+
+    snprintf(line, maxLen, "(%lu.%06lu) can0 %03lX#%02X%02X%02X%02X00000000", (unsigned long)(timestamp_us / 1000000),
+        (unsigned long)(timestamp_us % 1000000), (unsigned long)id, (unsigned int)(value & 0xff),
+        (unsigned int)((value >> 8) & 0xff), (unsigned int)((value >> 16) & 0xff), (unsigned int)(frame & 0xff));
+
+    frame++;
+    return true;
+}
+
+static ReplayBenchLineSource raceLog(REPLAY_BENCH_DURATION_S * 100 * numRaceIDs);
+static CANReplayController replayCan;
+static Battery replayBattery;
+static StaticTask<> benchTask;
+
+// A merged capture whose second frame was recorded before its first, replayed at real time
+static const char mergedLog[] = "(1700000000.000000) can0 521#0000000000000000\n"
+                                "(1699999999.995000) can0 522#0000000000000000\n"
+                                "(1700000000.010000) can0 523#0000000000000000\n"
+                                "(1700000000.020000) can0 526#0000000000000000\n";
+static CANBufferLineSource mergedLogSource(mergedLog);
+static CANReplayController mergedReplayCan;
+
+/**
+ * @brief Check a frame recorded before the first frame of a log is replayed straight away, rather than never.
+ *
+ */
+static void checkOutOfOrder() {
+    uint32_t start = Task::millis();
+    while (!mergedReplayCan.is_finished() && Task::millis() - start < 1000) {
+        Task::delay(10);
+    }
+
+    CANReplayStats stats = mergedReplayCan.get_replay_stats();
+    bool pass = mergedReplayCan.is_finished() && stats.frames == 4 && stats.late == 0;
+
+    printf("CAN replay out of order: %lu frames, %lu late, %lu ms recorded, finished in %lu ms\n",
+        (unsigned long)stats.frames, (unsigned long)stats.late, (unsigned long)(stats.recorded_us / 1000),
+        (unsigned long)(stats.elapsed_us / 1000));
+    printf("%s\n", pass ? "PASS: a frame from before the first was replayed straight away" : "FAIL");
+}
+
+void test_can_replay_task() {
+    checkOutOfOrder();
+
+    printf("CAN replay: %lu frames, %d s of traffic\n", (unsigned long)raceLog.numFrames, REPLAY_BENCH_DURATION_S);
+
+    while (!replayCan.is_finished()) {
+        Task::delay(1000);
+
+        CANReplayStats stats = replayCan.get_replay_stats();
+        printf("  %lu frames, %lu s recorded in %lu ms\n", (unsigned long)stats.frames,
+            (unsigned long)(stats.recorded_us / 1000000), (unsigned long)(stats.elapsed_us / 1000));
+    }
+
+    CANReplayStats stats = replayCan.get_replay_stats();
+    CANRxCounters counters = replayCan.get_rx_counters();
+
+    printf("CAN replay finished: %lu frames in %lu ms, %lu frames/s ingest, %lux real time\n", (unsigned long)stats.frames,
+        (unsigned long)(stats.elapsed_us / 1000), (unsigned long)(stats.frames * 1000000ULL / stats.ingest_us),
+        (unsigned long)(stats.recorded_us / stats.elapsed_us));
+    printf("  %lu skipped, %lu parse errors, %lu late, %lu dispatched, %lu dropped, %lu rejected\n",
+        (unsigned long)stats.skippedLines, (unsigned long)stats.parseErrors, (unsigned long)stats.late,
+        (unsigned long)counters.dispatched, (unsigned long)counters.dropped, (unsigned long)counters.softwareRejected);
+    printf("  battery decoded %.1f V pack, %.1f A\n", replayBattery.get(BATTERY_PACK_VOLTAGE),
+        replayBattery.get(BATTERY_TERMINAL_CURRENT));
+
+    while (true) {
+        Task::delay(1000);
+    }
+}
+
+void test_can_replay() {
+    loggingInit(); // the battery logs its state changes
+
+    replayCan.set_source(&raceLog, CANLogFormat::Candump);
+    replayCan.set_speed(REPLAY_BENCH_SPEED);
+
+    replayBattery.init(&replayCan);
+
+    mergedReplayCan.set_source(&mergedLogSource, CANLogFormat::Candump);
+    mergedReplayCan.init(TASK_PRIORITY_DEFAULT + 1);
+
+    // as fast as possible never blocks, so run below the battery and the progress reports
+    replayCan.init(TASK_PRIORITY_DEFAULT - 1);
+
+    benchTask.start(test_can_replay_task, TASK_PRIORITY_DEFAULT, "CAN_Replay_Bench");
+
+    startScheduler();
+}
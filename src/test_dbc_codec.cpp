@@ -0,0 +1,397 @@
+#include "arduino_freertos.h"
+#include "battery.h"
+#include "battery_fixed.hpp"
+#include "battery_signals.hpp"
+#include "rtos/rtos.hpp"
+#include "test_bench.hpp"
+#include "vcu_log.h"
+#include "vcu_log_fixed.hpp"
+#include <can/CANMessage.hpp>
+#include <cstring>
+
+using namespace wrvcu;
+
+#define CODEC_BENCH_ITERATIONS 20000
+
+static StaticTask<> benchTask;
+static CANSignalStore<BATTERY_NUM_SIGNALS> benchStore{ battery_frame_decoders, BATTERY_NUM_DECODED_FRAMES, battery_signal_info };
+
+// written by every decode so the work can't be optimised away
+static volatile float floatSink;
+static volatile int32_t fixedSink;
+static volatile uint64_t frameSink; // every byte of an encoded frame
+
+// The frames compared, with varying data
+static const uint32_t codecIDs[] = {
+    BATTERY_BMS_AVAIL_CURRENT_FRAME_ID,
+    BATTERY_BMS_BATT_STATUS_FRAME_ID,
+    BATTERY_BMS_CELL_STATUS_TEMPERATURES_FRAME_ID,
+    BATTERY_BMS_CELL_STATUS_VOLTAGES_FRAME_ID,
+    BATTERY_IVT_MSG_RESULT_I_FRAME_ID,
+    BATTERY_IVT_MSG_RESULT_U1_FRAME_ID,
+    VCU_LOG_VCU_LOG_FRAME_ID,
+    VCU_LOG_VCU_CAN_DIAG_FRAME_ID,
+};
+static const int numCodecIDs = sizeof(codecIDs) / sizeof(codecIDs[0]);
+
+/**
+ * @brief Change every byte of the frame, so no signal in it is the same from one iteration to the next.
+ *
+ */
+static inline void varyFrame(CANMessage& msg, int n) {
+    for (int b = 0; b < 8; b++) {
+        msg.data[b] ^= (uint8_t)(n + b);
+    }
+}
+
+static inline void sinkFrame(const uint8_t* data) {
+    uint64_t frame;
+    memcpy(&frame, data, sizeof(frame));
+    frameSink = frame;
+}
+
+/**
+ * @brief Decode with the cantools --use-float functions, as Battery did before the signal store.
+ *
+ */
+static float decodeFloat(CANMessage const& msg) {
+    switch (msg.id) {
+    case BATTERY_BMS_AVAIL_CURRENT_FRAME_ID: {
+        battery_bms_avail_current_t m;
+        battery_bms_avail_current_unpack(&m, msg.data, 8);
+        return battery_bms_avail_current_max_discharge_decode(m.max_discharge) + battery_bms_avail_current_max_charge_decode(m.max_charge);
+    }
+    case BATTERY_BMS_BATT_STATUS_FRAME_ID: {
+        battery_bms_batt_status_t m;
+        battery_bms_batt_status_unpack(&m, msg.data, 8);
+        return battery_bms_batt_status_status_decode(m.status) + battery_bms_batt_status_q_remain_nom_decode(m.q_remain_nom) + battery_bms_batt_status_so_c_decode(m.so_c);
+    }
+    case BATTERY_BMS_CELL_STATUS_TEMPERATURES_FRAME_ID: {
+        battery_bms_cell_status_temperatures_t m;
+        battery_bms_cell_status_temperatures_unpack(&m, msg.data, 8);
+        return battery_bms_cell_status_temperatures_avg_cell_temp_decode(m.avg_cell_temp) + battery_bms_cell_status_temperatures_min_cell_temp_decode(m.min_cell_temp) + battery_bms_cell_status_temperatures_max_cell_temp_decode(m.max_cell_temp);
+    }
+    case BATTERY_BMS_CELL_STATUS_VOLTAGES_FRAME_ID: {
+        battery_bms_cell_status_voltages_t m;
+        battery_bms_cell_status_voltages_unpack(&m, msg.data, 8);
+        return battery_bms_cell_status_voltages_avg_cell_voltage_decode(m.avg_cell_voltage) + battery_bms_cell_status_voltages_min_cell_voltage_decode(m.min_cell_voltage) + battery_bms_cell_status_voltages_max_cell_voltage_decode(m.max_cell_voltage);
+    }
+    case BATTERY_IVT_MSG_RESULT_I_FRAME_ID: {
+        battery_ivt_msg_result_i_t m;
+        battery_ivt_msg_result_i_unpack(&m, msg.data, 8);
+        return battery_ivt_msg_result_i_ivt_result_i_decode(m.ivt_result_i);
+    }
+    case BATTERY_IVT_MSG_RESULT_U1_FRAME_ID: {
+        battery_ivt_msg_result_u1_t m;
+        battery_ivt_msg_result_u1_unpack(&m, msg.data, 8);
+        return battery_ivt_msg_result_u1_ivt_result_u1_decode(m.ivt_result_u1);
+    }
+    case VCU_LOG_VCU_LOG_FRAME_ID: {
+        vcu_log_vcu_log_t m;
+        vcu_log_vcu_log_unpack(&m, msg.data, 8);
+        return vcu_log_vcu_log_vcu_state_decode(m.vcu_state) + vcu_log_vcu_log_apps_raw_decode(m.apps_raw) + vcu_log_vcu_log_brake_raw_decode(m.brake_raw) + vcu_log_vcu_log_scmon_decode(m.scmon) + vcu_log_vcu_log_regen_active_decode(m.regen_active);
+    }
+    case VCU_LOG_VCU_CAN_DIAG_FRAME_ID: {
+        vcu_log_vcu_can_diag_t m;
+        vcu_log_vcu_can_diag_unpack(&m, msg.data, 8);
+        return vcu_log_vcu_can_diag_bus_load_decode(m.bus_load) + vcu_log_vcu_can_diag_rx_rate_decode(m.rx_rate) + vcu_log_vcu_can_diag_rx_dropped_decode(m.rx_dropped) + vcu_log_vcu_can_diag_tx_err_cnt_decode(m.tx_err_cnt);
+    }
+    }
+    return 0;
+}
+
+/**
+ * @brief Decode the same signals with the generated fixed-point codec.
+ *
+ */
+static int32_t decodeFixed(CANMessage const& msg) {
+    switch (msg.id) {
+    case BATTERY_BMS_AVAIL_CURRENT_FRAME_ID:
+        return battery_bms_avail_current_max_discharge_get_fixed(msg.data) + battery_bms_avail_current_max_charge_get_fixed(msg.data);
+    case BATTERY_BMS_BATT_STATUS_FRAME_ID:
+        return battery_bms_batt_status_status_get_fixed(msg.data) + battery_bms_batt_status_q_remain_nom_get_fixed(msg.data) + battery_bms_batt_status_so_c_get_fixed(msg.data);
+    case BATTERY_BMS_CELL_STATUS_TEMPERATURES_FRAME_ID:
+        return battery_bms_cell_status_temperatures_avg_cell_temp_get_fixed(msg.data) + battery_bms_cell_status_temperatures_min_cell_temp_get_fixed(msg.data) + battery_bms_cell_status_temperatures_max_cell_temp_get_fixed(msg.data);
+    case BATTERY_BMS_CELL_STATUS_VOLTAGES_FRAME_ID:
+        return battery_bms_cell_status_voltages_avg_cell_voltage_get_fixed(msg.data) + battery_bms_cell_status_voltages_min_cell_voltage_get_fixed(msg.data) + battery_bms_cell_status_voltages_max_cell_voltage_get_fixed(msg.data);
+    case BATTERY_IVT_MSG_RESULT_I_FRAME_ID:
+        return battery_ivt_msg_result_i_ivt_result_i_get_fixed(msg.data);
+    case BATTERY_IVT_MSG_RESULT_U1_FRAME_ID:
+        return battery_ivt_msg_result_u1_ivt_result_u1_get_fixed(msg.data);
+    case VCU_LOG_VCU_LOG_FRAME_ID:
+        return vcu_log_vcu_log_vcu_state_get_fixed(msg.data) + vcu_log_vcu_log_apps_raw_get_fixed(msg.data) + vcu_log_vcu_log_brake_raw_get_fixed(msg.data) + vcu_log_vcu_log_scmon_get_fixed(msg.data) + vcu_log_vcu_log_regen_active_get_fixed(msg.data);
+    case VCU_LOG_VCU_CAN_DIAG_FRAME_ID:
+        return vcu_log_vcu_can_diag_bus_load_get_fixed(msg.data) + vcu_log_vcu_can_diag_rx_rate_get_fixed(msg.data) + vcu_log_vcu_can_diag_rx_dropped_get_fixed(msg.data) + vcu_log_vcu_can_diag_tx_err_cnt_get_fixed(msg.data);
+    }
+    return 0;
+}
+
+/**
+ * @brief One signal, through both the cantools functions and the generated fixed-point codec.
+ *
+ */
+struct CodecSignal {
+    const char* name;
+    int64_t (*unpackRaw)(const uint8_t* data); // cantools, the raw count before scaling
+    float (*decode)(int64_t raw);              // cantools, raw count to physical value
+    int64_t (*toFixed)(float value);           // physical value to fixed-point
+    int64_t (*getFixed)(const uint8_t* data);
+    void (*setFixed)(uint8_t* data, int64_t value);
+};
+
+#define CODEC_SIGNAL(dbc, msg, sig)                                                                                     \
+    {                                                                                                                   \
+        #dbc "." #msg "." #sig,                                                                                         \
+            [](const uint8_t* data) -> int64_t { dbc##_##msg##_t m; dbc##_##msg##_unpack(&m, data, 8); return m.sig; }, \
+            [](int64_t raw) -> float { return dbc##_##msg##_##sig##_decode(raw); },                                     \
+            [](float value) -> int64_t { return dbc##_##msg##_##sig##_fixed(value); },                                  \
+            [](const uint8_t* data) -> int64_t { return dbc##_##msg##_##sig##_get_fixed(data); },                       \
+            [](uint8_t* data, int64_t value) { dbc##_##msg##_##sig##_set_fixed(data, value); }                          \
+    }
+
+// Every signal with a fixed-point codec in both DBCs
+static const CodecSignal codecSignals[] = {
+    CODEC_SIGNAL(battery, imd_info, imd_vifc_status),
+    CODEC_SIGNAL(battery, imd_info, imd_imc_status),
+    CODEC_SIGNAL(battery, imd_info, imd_r_iso),
+    CODEC_SIGNAL(battery, bms_batt_status, v_sum_of_cells),
+    CODEC_SIGNAL(battery, bms_batt_status, so_c),
+    CODEC_SIGNAL(battery, bms_batt_status, q_remain_nom),
+    CODEC_SIGNAL(battery, bms_batt_status, status),
+    CODEC_SIGNAL(battery, bms_cell_status_temperatures, min_cell_temp),
+    CODEC_SIGNAL(battery, bms_cell_status_temperatures, max_cell_temp),
+    CODEC_SIGNAL(battery, bms_cell_status_temperatures, avg_cell_temp),
+    CODEC_SIGNAL(battery, bms_cell_status_voltages, min_cell_voltage),
+    CODEC_SIGNAL(battery, bms_cell_status_voltages, max_cell_voltage),
+    CODEC_SIGNAL(battery, bms_cell_status_voltages, avg_cell_voltage),
+    CODEC_SIGNAL(battery, bms_avail_current, max_discharge),
+    CODEC_SIGNAL(battery, bms_avail_current, max_charge),
+    CODEC_SIGNAL(battery, charger_request, bms_charger_output_current),
+    CODEC_SIGNAL(battery, charger_request, bms_charger_output_voltage),
+    CODEC_SIGNAL(battery, charger_request, requested_charging_power),
+    CODEC_SIGNAL(battery, charger_request, charge_enable),
+    CODEC_SIGNAL(battery, ivt_msg_result_i, ivt_result_i),
+    CODEC_SIGNAL(battery, ivt_msg_result_u1, ivt_result_u1),
+    CODEC_SIGNAL(battery, ivt_msg_result_u2, ivt_result_u2),
+    CODEC_SIGNAL(battery, ivt_msg_result_u3, ivt_result_u3),
+    CODEC_SIGNAL(battery, ivt_msg_result_t, ivt_result_t),
+    CODEC_SIGNAL(battery, ivt_msg_result_w, ivt_result_w),
+    CODEC_SIGNAL(vcu_log, vcu_log, regen_active),
+    CODEC_SIGNAL(vcu_log, vcu_log, brake_raw),
+    CODEC_SIGNAL(vcu_log, vcu_log, brake_hard),
+    CODEC_SIGNAL(vcu_log, vcu_log, brake_plausibility),
+    CODEC_SIGNAL(vcu_log, vcu_log, brake_disconnect),
+    CODEC_SIGNAL(vcu_log, vcu_log, apps_raw),
+    CODEC_SIGNAL(vcu_log, vcu_log, apps_plausibility),
+    CODEC_SIGNAL(vcu_log, vcu_log, apps_disconnect),
+    CODEC_SIGNAL(vcu_log, vcu_log, scmon),
+    CODEC_SIGNAL(vcu_log, vcu_log, vcu_state),
+    CODEC_SIGNAL(vcu_log, vcu_can_diag, bus_load),
+    CODEC_SIGNAL(vcu_log, vcu_can_diag, fault_state),
+    CODEC_SIGNAL(vcu_log, vcu_can_diag, error_flags),
+    CODEC_SIGNAL(vcu_log, vcu_can_diag, tx_err_cnt),
+    CODEC_SIGNAL(vcu_log, vcu_can_diag, rx_err_cnt),
+    CODEC_SIGNAL(vcu_log, vcu_can_diag, rx_rate),
+    CODEC_SIGNAL(vcu_log, vcu_can_diag, rx_dropped),
+    CODEC_SIGNAL(vcu_log, vcu_can_diag, stale_signals),
+    CODEC_SIGNAL(vcu_log, vcu_task_load, task_index),
+    CODEC_SIGNAL(vcu_log, vcu_task_load, cpu_load),
+    CODEC_SIGNAL(vcu_log, vcu_task_load, task_load),
+    CODEC_SIGNAL(vcu_log, vcu_task_load, switches),
+    CODEC_SIGNAL(vcu_log, vcu_task_load, max_run),
+};
+static const int numCodecSignals = sizeof(codecSignals) / sizeof(codecSignals[0]);
+
+#define CODEC_CHECK_RANDOM_FRAMES 1000
+
+/**
+ * @brief Fill a frame with the n-th test pattern: all zeros, all ones, each single bit set, each single bit clear, then
+ * pseudo-random data. Between them every signal sees zero, -1 or its unsigned maximum, its signed minimum and maximum,
+ * and each of its bits alone.
+ *
+ */
+static void codecPattern(int n, uint8_t* data) {
+    uint64_t bits;
+    if (n == 0) {
+        bits = 0;
+    } else if (n == 1) {
+        bits = ~0ULL;
+    } else if (n < 66) {
+        bits = 1ULL << (n - 2);
+    } else if (n < 130) {
+        bits = ~(1ULL << (n - 66));
+    } else {
+        bits = (uint64_t)n * 6364136223846793005ULL + 1442695040888963407ULL;
+        bits ^= bits >> 29;
+        bits *= 0xbf58476d1ce4e5b9ULL;
+        bits ^= bits >> 32;
+    }
+
+    for (int b = 0; b < 8; b++) {
+        data[b] = (uint8_t)(bits >> (8 * b));
+    }
+}
+
+/**
+ * @brief Check a signal decodes and encodes the same through both codecs for a frame.
+ *
+ * @return bool Whether the codecs agreed
+ */
+static bool checkSignal(CodecSignal const& signal, const uint8_t* data) {
+    int64_t raw = signal.unpackRaw(data);
+    int64_t fixed = signal.getFixed(data);
+
+    // the same count, with the offset in counts added
+    int64_t offset = signal.toFixed(signal.decode(0));
+    if (fixed != raw + offset) {
+        printf("  %s: fixed %lld, cantools raw %lld\n", signal.name, (long long)fixed, (long long)raw);
+        return false;
+    }
+
+    // the fixed-point value times the resolution is the float physical value, within the float's precision
+    double resolution = (double)signal.decode(1) - signal.decode(0);
+    double expected = (double)fixed * resolution;
+    float value = signal.decode(raw);
+    if (fabs(value - expected) > fabs(expected) * 1e-6 + resolution * 1e-6) {
+        printf("  %s: fixed %lld, cantools %f\n", signal.name, (long long)fixed, value);
+        return false;
+    }
+
+    // writing the value back leaves the frame unchanged, so only the signal's own bits are touched
+    uint8_t written[8];
+    memcpy(written, data, sizeof(written));
+    signal.setFixed(written, fixed);
+    if (memcmp(written, data, sizeof(written)) != 0) {
+        printf("  %s: writing %lld back changed the frame\n", signal.name, (long long)fixed);
+        return false;
+    }
+
+    // and into an empty frame it reads back the same through cantools
+    uint8_t empty[8] = {};
+    signal.setFixed(empty, fixed);
+    if (signal.unpackRaw(empty) != raw) {
+        printf("  %s: wrote %lld, cantools read back raw %lld\n", signal.name, (long long)fixed,
+            (long long)signal.unpackRaw(empty));
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Check the fixed-point codec against the cantools float functions, over every signal and test pattern.
+ *
+ */
+static void checkEquivalence() {
+    const int numPatterns = 130 + CODEC_CHECK_RANDOM_FRAMES;
+    uint32_t mismatches = 0;
+    uint8_t data[8];
+
+    for (int n = 0; n < numPatterns; n++) {
+        codecPattern(n, data);
+        for (int i = 0; i < numCodecSignals; i++) {
+            if (!checkSignal(codecSignals[i], data)) {
+                mismatches++;
+            }
+        }
+    }
+
+    printf("DBC codec equivalence: %d signals, %d frames each, %lu mismatches\n", numCodecSignals, numPatterns,
+        (unsigned long)mismatches);
+    printf("%s\n", mismatches == 0 ? "PASS: the fixed-point codec matches cantools" : "FAIL");
+}
+
+void test_dbc_codec_task() {
+    checkEquivalence();
+
+    CANMessage msgs[numCodecIDs];
+    for (int i = 0; i < numCodecIDs; i++) {
+        msgs[i].id = codecIDs[i];
+        for (int b = 0; b < 8; b++) {
+            msgs[i].data[b] = (uint8_t)(i * 37 + b * 11);
+        }
+    }
+
+    // decode
+    uint32_t start = micros();
+    for (int n = 0; n < CODEC_BENCH_ITERATIONS; n++) {
+        varyFrame(msgs[n % numCodecIDs], n);
+        for (int i = 0; i < numCodecIDs; i++) {
+            floatSink = decodeFloat(msgs[i]);
+        }
+    }
+    uint32_t floatTime = micros() - start;
+
+    start = micros();
+    for (int n = 0; n < CODEC_BENCH_ITERATIONS; n++) {
+        varyFrame(msgs[n % numCodecIDs], n);
+        for (int i = 0; i < numCodecIDs; i++) {
+            fixedSink = decodeFixed(msgs[i]);
+        }
+    }
+    uint32_t fixedTime = micros() - start;
+
+    // the signal store decodes every signal in the frame, and only has battery frames
+    start = micros();
+    for (int n = 0; n < CODEC_BENCH_ITERATIONS; n++) {
+        varyFrame(msgs[n % numCodecIDs], n);
+        for (int i = 0; i < numCodecIDs; i++) {
+            benchStore.decode(msgs[i], n);
+        }
+    }
+    uint32_t storeTime = micros() - start;
+    floatSink = benchStore.get(BATTERY_IVT_MSG_RESULT_U1_IVT_RESULT_U1_SIGNAL);
+
+    // encode, the VCU's own frames
+    vcu_log_vcu_can_diag_fixed_t diagFixed = { 123, 1, 5, 10, 20, 900, 3, 2 };
+    vcu_log_vcu_can_diag_t diagRaw;
+    uint8_t data[8];
+
+    start = micros();
+    for (int n = 0; n < CODEC_BENCH_ITERATIONS * numCodecIDs; n++) {
+        diagRaw.bus_load = vcu_log_vcu_can_diag_bus_load_encode(12.3f + (n & 0xf));
+        diagRaw.fault_state = vcu_log_vcu_can_diag_fault_state_encode(n & 1);
+        diagRaw.error_flags = vcu_log_vcu_can_diag_error_flags_encode(5 + (n & 3));
+        diagRaw.tx_err_cnt = vcu_log_vcu_can_diag_tx_err_cnt_encode(10 + (n & 7));
+        diagRaw.rx_err_cnt = vcu_log_vcu_can_diag_rx_err_cnt_encode(20 + (n & 7));
+        diagRaw.rx_rate = vcu_log_vcu_can_diag_rx_rate_encode(900 + (n & 0xff));
+        diagRaw.rx_dropped = vcu_log_vcu_can_diag_rx_dropped_encode(3 + (n & 3));
+        diagRaw.stale_signals = vcu_log_vcu_can_diag_stale_signals_encode(2 + (n & 3));
+        vcu_log_vcu_can_diag_pack(data, &diagRaw, 8);
+        sinkFrame(data);
+    }
+    uint32_t floatEncodeTime = micros() - start;
+
+    start = micros();
+    for (int n = 0; n < CODEC_BENCH_ITERATIONS * numCodecIDs; n++) {
+        diagFixed.bus_load = vcu_log_vcu_can_diag_bus_load_fixed(12.3f) + (n & 0xf) * 10;
+        diagFixed.fault_state = n & 1;
+        diagFixed.error_flags = 5 + (n & 3);
+        diagFixed.tx_err_cnt = 10 + (n & 7);
+        diagFixed.rx_err_cnt = 20 + (n & 7);
+        diagFixed.rx_rate = 900 + (n & 0xff);
+        diagFixed.rx_dropped = 3 + (n & 3);
+        diagFixed.stale_signals = 2 + (n & 3);
+        vcu_log_vcu_can_diag_encode_fixed(data, &diagFixed);
+        sinkFrame(data);
+    }
+    uint32_t fixedEncodeTime = micros() - start;
+
+    const uint32_t frames = CODEC_BENCH_ITERATIONS * numCodecIDs;
+    printf("DBC codec: %lu frames of battery.dbc and vcu_log.dbc\n", (unsigned long)frames);
+    printBenchResult("float decode", floatTime, frames, floatTime, "float");
+    printBenchResult("fixed decode", fixedTime, frames, floatTime, "float");
+    printBenchResult("signal store decode", storeTime, frames, floatTime, "float");
+    printBenchResult("float encode", floatEncodeTime, frames, floatEncodeTime, "float");
+    printBenchResult("fixed encode", fixedEncodeTime, frames, floatEncodeTime, "float");
+
+    while (true) {
+        Task::delay(1000);
+    }
+}
+
+void test_dbc_codec() {
+    benchTask.start(test_dbc_codec_task, TASK_PRIORITY_DEFAULT, "DBC_Codec_Bench");
+
+    startScheduler();
+}
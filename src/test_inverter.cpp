@@ -7,7 +7,7 @@
 
 using namespace wrvcu;
 
-static Task taskA;
+static StaticTask<> taskA;
 
 static CANController_T4<CAN1> can1;
 static Inverter inverter;
@@ -7,7 +7,7 @@
 
 using namespace wrvcu;
 
-static Task taskA;
+static StaticTask<> taskA;
 void test_logging_task() {
     while (true) {
         DEBUG("This is a test debug message");
@@ -19,7 +19,7 @@ void test_logging_task() {
     }
 }
 
-static Task taskB;
+static StaticTask<> taskB;
 void test_mtp_task() {
     while (true) {
         // MTP.loop();
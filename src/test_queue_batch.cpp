@@ -0,0 +1,196 @@
+#include "arduino_freertos.h"
+#include "can/CANMessage.hpp"
+#include "rtos/rtos.hpp"
+#include "test_bench.hpp"
+
+using namespace wrvcu;
+
+#define QUEUE_BENCH_ROUNDS 200
+#define QUEUE_BENCH_LENGTH 256
+
+// the batch the consumer in the two task benchmark takes at once
+#define QUEUE_BENCH_BATCH 16
+
+static Queue<CANMessage, QUEUE_BENCH_LENGTH> benchQueue;
+static Queue<CANMessage, QUEUE_BENCH_LENGTH> handoffQueue;
+
+static StaticTask<> benchTask;
+static StaticTask<> consumerTask;
+
+static volatile uint32_t sink;
+static volatile uint32_t consumed;
+static volatile bool batchConsumer = false;
+
+/**
+ * @brief Count the items which aren't the run of IDs starting at first.
+ *
+ */
+static int countOutOfOrder(CANMessage const* got, int n, uint32_t first) {
+    int wrong = 0;
+    for (int i = 0; i < n; i++) {
+        if (got[i].id != first + i) {
+            wrong++;
+        }
+    }
+    return wrong;
+}
+
+/**
+ * @brief Check the batch calls queue and return the same items, in the same order, as enqueue and dequeue one at a
+ * time, including batches cut short by an empty or full queue.
+ *
+ */
+static void checkBatches(CANMessage const* items) {
+    static CANMessage single[QUEUE_BENCH_LENGTH];
+    static CANMessage out[QUEUE_BENCH_LENGTH];
+    int failures = 0;
+
+    // the single item order everything is compared with
+    for (int i = 0; i < QUEUE_BENCH_LENGTH; i++) {
+        benchQueue.enqueue(items[i], 0);
+    }
+    for (int i = 0; i < QUEUE_BENCH_LENGTH; i++) {
+        benchQueue.dequeue(single[i], 0);
+    }
+    failures += countOutOfOrder(single, QUEUE_BENCH_LENGTH, 0) != 0;
+
+    // a full batch fills the queue, and nothing more fits
+    failures += benchQueue.enqueueMany(items, QUEUE_BENCH_LENGTH, 0) != QUEUE_BENCH_LENGTH;
+    failures += benchQueue.enqueueMany(items, 5, 0) != 0;
+    failures += benchQueue.size() != QUEUE_BENCH_LENGTH;
+
+    // a batch smaller than the queue, then one larger than what's left, which stops short
+    failures += benchQueue.dequeueMany(out, 100, 0) != 100;
+    failures += benchQueue.dequeueMany(out + 100, QUEUE_BENCH_LENGTH, 0) != QUEUE_BENCH_LENGTH - 100;
+    failures += memcmp(out, single, sizeof(single)) != 0;
+    failures += benchQueue.dequeueMany(out, QUEUE_BENCH_LENGTH, 0) != 0;
+
+    // a batch which only partly fits queues its start, after what was already there
+    for (int i = 0; i < QUEUE_BENCH_LENGTH - 6; i++) {
+        benchQueue.enqueue(items[i], 0);
+    }
+    failures += benchQueue.enqueueMany(items + QUEUE_BENCH_LENGTH - 6, 16, 0) != 6;
+
+    int drained = 0;
+    failures += benchQueue.drainInto([&](CANMessage const& msg) { out[drained++] = msg; }) != QUEUE_BENCH_LENGTH;
+    failures += drained != QUEUE_BENCH_LENGTH;
+    failures += memcmp(out, single, sizeof(single)) != 0;
+    failures += benchQueue.drainInto([](CANMessage const& msg) { sink = msg.data[0]; }) != 0;
+
+    printf("Queue batch checks: %d failed\n", failures);
+    printf("%s\n", failures == 0 ? "PASS: batches match single items in order and count" : "FAIL");
+}
+
+/**
+ * @brief A higher priority task receiving from handoffQueue, as the CANOpen task does from the CAN task, so every item
+ * sent one at a time switches to it.
+ *
+ */
+void test_queue_batch_consumer() {
+    CANMessage batch[QUEUE_BENCH_BATCH];
+
+    while (true) {
+        if (batchConsumer) {
+            int received = handoffQueue.dequeueMany(batch, QUEUE_BENCH_BATCH, TIMEOUT_MAX);
+            for (int i = 0; i < received; i++) {
+                sink = batch[i].data[0];
+            }
+            consumed = consumed + received;
+        } else {
+            CANMessage msg;
+            handoffQueue.dequeue(msg, TIMEOUT_MAX);
+            sink = msg.data[0];
+            consumed = consumed + 1;
+        }
+    }
+}
+
+void test_queue_batch_task() {
+    static CANMessage items[QUEUE_BENCH_LENGTH];
+    static CANMessage out[QUEUE_BENCH_LENGTH];
+    const uint32_t total = QUEUE_BENCH_ROUNDS * QUEUE_BENCH_LENGTH;
+
+    for (int i = 0; i < QUEUE_BENCH_LENGTH; i++) {
+        items[i].id = i;
+        items[i].data[0] = i;
+    }
+
+    checkBatches(items);
+
+    // one task, fill then empty, the way the inverter drained its queues
+    uint32_t start = micros();
+    for (int r = 0; r < QUEUE_BENCH_ROUNDS; r++) {
+        for (int i = 0; i < QUEUE_BENCH_LENGTH; i++) {
+            benchQueue.enqueue(items[i], 0);
+        }
+        while (benchQueue.size() > 0) {
+            sink = benchQueue.dequeue(0).data[0];
+        }
+    }
+    uint32_t singleTime = micros() - start;
+
+    start = micros();
+    for (int r = 0; r < QUEUE_BENCH_ROUNDS; r++) {
+        benchQueue.enqueueMany(items, QUEUE_BENCH_LENGTH, 0);
+        int received = benchQueue.dequeueMany(out, QUEUE_BENCH_LENGTH, 0);
+        sink = out[received - 1].data[0];
+    }
+    uint32_t batchTime = micros() - start;
+
+    start = micros();
+    for (int r = 0; r < QUEUE_BENCH_ROUNDS; r++) {
+        benchQueue.enqueueMany(items, QUEUE_BENCH_LENGTH, 0);
+        benchQueue.drainInto([](CANMessage const& msg) { sink = msg.data[0]; });
+    }
+    uint32_t drainTime = micros() - start;
+
+    // two tasks, a higher priority consumer woken by every item
+    consumed = 0;
+    start = micros();
+    for (int r = 0; r < QUEUE_BENCH_ROUNDS; r++) {
+        for (int i = 0; i < QUEUE_BENCH_LENGTH; i++) {
+            handoffQueue.enqueue(items[i], TIMEOUT_MAX);
+        }
+    }
+    while (consumed < total) {
+        Task::delay(1);
+    }
+    uint32_t handoffSingleTime = micros() - start;
+
+    batchConsumer = true;
+    handoffQueue.enqueue(items[0], TIMEOUT_MAX); // let the consumer switch to batches
+    while (consumed < total + 1) {
+        Task::delay(1);
+    }
+
+    consumed = 0;
+    start = micros();
+    for (int r = 0; r < QUEUE_BENCH_ROUNDS; r++) {
+        handoffQueue.enqueueMany(items, QUEUE_BENCH_LENGTH, TIMEOUT_MAX);
+    }
+    while (consumed < total) {
+        Task::delay(1);
+    }
+    uint32_t handoffBatchTime = micros() - start;
+
+    printf("Queue batches: %lu CANMessages in each test\n", (unsigned long)total);
+    printBenchResult("enqueue, size, dequeue", singleTime, total, singleTime, "single");
+    printBenchResult("enqueueMany, dequeueMany", batchTime, total, singleTime, "single");
+    printBenchResult("enqueueMany, drainInto", drainTime, total, singleTime, "single");
+    printBenchResult("handoff, single", handoffSingleTime, total, handoffSingleTime, "single");
+    printBenchResult("handoff, batched", handoffBatchTime, total, handoffSingleTime, "single");
+
+    while (true) {
+        Task::delay(1000);
+    }
+}
+
+void test_queue_batch() {
+    benchQueue.init();
+    handoffQueue.init();
+
+    benchTask.start(test_queue_batch_task, TASK_PRIORITY_DEFAULT, "Queue_Batch_Bench");
+    consumerTask.start(test_queue_batch_consumer, TASK_PRIORITY_DEFAULT + 1, "Queue_Batch_Consumer");
+
+    startScheduler();
+}
@@ -93,14 +93,14 @@ void task8() {
     }
 }
 
-static Task taskA;
-static Task taskB;
-static Task taskC;
-static Task taskD;
-static Task taskE;
-static Task taskF;
-static Task taskG;
-static Task taskH;
+static StaticTask<> taskA;
+static StaticTask<> taskB;
+static StaticTask<> taskC;
+static StaticTask<> taskD;
+static StaticTask<> taskE;
+static StaticTask<> taskF;
+static StaticTask<> taskG;
+static StaticTask<> taskH;
 
 void test_rtos() {
     pinMode(LED_BUILTIN, OUTPUT);
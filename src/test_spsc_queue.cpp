@@ -0,0 +1,242 @@
+#include "arduino_freertos.h"
+#include "can/CANFramePool.hpp"
+#include "rtos/rtos.hpp"
+#include "test_bench.hpp"
+
+using namespace wrvcu;
+
+#define SPSC_BENCH_ITEMS 100000
+#define SPSC_BENCH_LENGTH 256
+
+// short, so the checks fill it and wrap around it quickly
+#define SPSC_CHECK_LENGTH 8
+#define SPSC_CHECK_TIMEOUT 1000 // ms, far longer than the waker takes to respond
+
+// CANOpenDevice to Inverter, as it was and as it is
+static Queue<CANFrameRef, SPSC_BENCH_LENGTH> rtosQueue;
+static SPSCQueue<CANFrameRef, SPSC_BENCH_LENGTH> spscQueue;
+
+static SPSCQueue<uint32_t, SPSC_CHECK_LENGTH> checkQueue;
+
+static StaticTask<> benchTask;
+static StaticTask<> consumerTask;
+static StaticTask<> wakerTask;
+
+static volatile uint32_t sink;
+static volatile uint32_t consumed;
+static volatile bool useSPSC = false;
+
+enum class WakerAction {
+    None,
+    Enqueue,
+    Dequeue,
+};
+
+// what the waker does next, set by the checks before they block on checkQueue
+static volatile WakerAction wakerAction = WakerAction::None;
+static volatile uint32_t wakerItem; // the item it enqueues
+
+/**
+ * @brief A lower priority task, so it only runs once the checks block, which then takes the other side of checkQueue.
+ *
+ */
+void test_spsc_queue_waker() {
+    while (true) {
+        // cleared before acting, as the woken task preempts this one and may set the next action straight away
+        WakerAction action = wakerAction;
+        wakerAction = WakerAction::None;
+
+        if (action == WakerAction::Enqueue) {
+            uint32_t item = wakerItem;
+            checkQueue.enqueue(item, 0);
+        } else if (action == WakerAction::Dequeue) {
+            uint32_t item = 0;
+            checkQueue.dequeue(item, 0);
+        }
+        Task::delay(1);
+    }
+}
+
+/**
+ * @brief Take count items from checkQueue one at a time, counting any which aren't the run starting at first.
+ *
+ */
+static int dequeueRun(int count, uint32_t first) {
+    int wrong = 0;
+    for (int i = 0; i < count; i++) {
+        uint32_t item = 0;
+        if (!checkQueue.dequeue(item, 0) || item != first + i) {
+            wrong++;
+        }
+    }
+    return wrong;
+}
+
+/**
+ * @brief Check the SPSC queue keeps order through full, empty and wrapped states, and that a task blocked on either
+ * side is woken by the other.
+ *
+ */
+static void checkQueueBehaviour() {
+    int failures = 0;
+    uint32_t item = 0;
+
+    // empty
+    failures += checkQueue.dequeue(item, 0);
+    failures += checkQueue.dequeueMany(&item, 1, 0) != 0;
+    failures += checkQueue.drainInto([](uint32_t) {}) != 0;
+    failures += checkQueue.size() != 0;
+
+    // full, in order
+    for (uint32_t i = 0; i < SPSC_CHECK_LENGTH; i++) {
+        failures += !checkQueue.enqueue(i, 0);
+    }
+    failures += checkQueue.enqueue(SPSC_CHECK_LENGTH, 0);
+    failures += checkQueue.enqueueMany(&item, 1, 0) != 0;
+    failures += checkQueue.size() != SPSC_CHECK_LENGTH;
+    failures += dequeueRun(SPSC_CHECK_LENGTH, 0);
+
+    // the indices wrap around the buffer many times, part full each time
+    uint32_t next = 0;
+    for (int round = 0; round < 5 * SPSC_CHECK_LENGTH; round++) {
+        for (int i = 0; i < 5; i++) {
+            failures += !checkQueue.enqueue(next + i, 0);
+        }
+        failures += dequeueRun(5, next);
+        next += 5;
+    }
+
+    // a batch which only partly fits, then drained in order
+    uint32_t batch[SPSC_CHECK_LENGTH];
+    for (uint32_t i = 0; i < SPSC_CHECK_LENGTH; i++) {
+        batch[i] = next + 5 + i;
+    }
+    for (uint32_t i = 0; i < 5; i++) {
+        checkQueue.enqueue(next + i, 0);
+    }
+    failures += checkQueue.enqueueMany(batch, SPSC_CHECK_LENGTH, 0) != SPSC_CHECK_LENGTH - 5;
+
+    uint32_t expected = next;
+    int wrong = 0;
+    failures += checkQueue.drainInto([&](uint32_t got) { wrong += got != expected++; }) != SPSC_CHECK_LENGTH;
+    failures += wrong;
+
+    // a consumer blocked on an empty queue is woken by an enqueue
+    wakerItem = 1234;
+    wakerAction = WakerAction::Enqueue;
+    uint32_t start = Task::millis();
+    failures += !checkQueue.dequeue(item, SPSC_CHECK_TIMEOUT) || item != 1234;
+    failures += Task::millis() - start >= SPSC_CHECK_TIMEOUT;
+
+    // a producer blocked on a full queue is woken by a dequeue
+    for (uint32_t i = 0; i < SPSC_CHECK_LENGTH; i++) {
+        checkQueue.enqueue(i, 0);
+    }
+    wakerAction = WakerAction::Dequeue;
+    start = Task::millis();
+    failures += !checkQueue.enqueue(SPSC_CHECK_LENGTH, SPSC_CHECK_TIMEOUT);
+    failures += Task::millis() - start >= SPSC_CHECK_TIMEOUT;
+    failures += dequeueRun(SPSC_CHECK_LENGTH, 1); // the waker took the first
+
+    // and a wait with nothing to wake it times out
+    failures += checkQueue.dequeue(item, 10);
+
+    printf("SPSC queue checks: %d failed\n", failures);
+    printf("%s\n", failures == 0 ? "PASS: order, wrap around, full, empty and wake ups" : "FAIL");
+}
+
+/**
+ * @brief A higher priority task blocked on the queue, so every item wakes it.
+ *
+ */
+void test_spsc_queue_consumer() {
+    while (true) {
+        CANFrameRef ref;
+        if (useSPSC) {
+            spscQueue.dequeue(ref, TIMEOUT_MAX);
+        } else {
+            rtosQueue.dequeue(ref, TIMEOUT_MAX);
+        }
+        sink = ref.slot;
+        consumed = consumed + 1;
+    }
+}
+
+/**
+ * @brief Send SPSC_BENCH_ITEMS to the consumer task and wait for it to take them all.
+ *
+ * @return uint32_t The time taken in microseconds
+ */
+template <class Q>
+static uint32_t runHandoff(Q& queue) {
+    consumed = 0;
+
+    uint32_t start = micros();
+    for (int i = 0; i < SPSC_BENCH_ITEMS; i++) {
+        queue.enqueue(CANFrameRef{ (uint16_t)i }, TIMEOUT_MAX);
+    }
+    while (consumed < SPSC_BENCH_ITEMS) {
+        Task::delay(1);
+    }
+    return micros() - start;
+}
+
+/**
+ * @brief Fill and empty the queue from one task, the way the inverter drains its queues.
+ *
+ * @return uint32_t The time taken in microseconds
+ */
+template <class Q>
+static uint32_t runBurst(Q& queue) {
+    uint32_t start = micros();
+    for (int i = 0; i < SPSC_BENCH_ITEMS; i += SPSC_BENCH_LENGTH) {
+        for (int j = 0; j < SPSC_BENCH_LENGTH; j++) {
+            queue.enqueue(CANFrameRef{ (uint16_t)j }, 0);
+        }
+        queue.drainInto([](CANFrameRef ref) { sink = ref.slot; });
+    }
+    return micros() - start;
+}
+
+void test_spsc_queue_task() {
+    // one task only, so the consumer is kept out of the way
+    consumerTask.suspend();
+    checkQueueBehaviour();
+
+    uint32_t rtosBurstTime = runBurst(rtosQueue);
+    uint32_t spscBurstTime = runBurst(spscQueue);
+    consumerTask.resume();
+
+    // the consumer is blocked on the FreeRTOS queue, so that goes first
+    uint32_t rtosHandoffTime = runHandoff(rtosQueue);
+
+    useSPSC = true;
+    rtosQueue.enqueue(CANFrameRef{}, TIMEOUT_MAX); // let the consumer move to the SPSC queue
+    while (consumed < SPSC_BENCH_ITEMS + 1) {
+        Task::delay(1);
+    }
+
+    uint32_t spscHandoffTime = runHandoff(spscQueue);
+
+    printf("SPSC queue: %d CANFrameRefs in each test\n", SPSC_BENCH_ITEMS);
+    printBenchResult("handoff, FreeRTOS queue", rtosHandoffTime, SPSC_BENCH_ITEMS, rtosHandoffTime, "FreeRTOS queue");
+    printBenchResult("handoff, SPSC queue", spscHandoffTime, SPSC_BENCH_ITEMS, rtosHandoffTime, "FreeRTOS queue");
+    printBenchResult("burst, FreeRTOS queue", rtosBurstTime, SPSC_BENCH_ITEMS, rtosBurstTime, "FreeRTOS queue");
+    printBenchResult("burst, SPSC queue", spscBurstTime, SPSC_BENCH_ITEMS, rtosBurstTime, "FreeRTOS queue");
+
+    while (true) {
+        Task::delay(1000);
+    }
+}
+
+void test_spsc_queue() {
+    rtosQueue.init();
+    spscQueue.init();
+    checkQueue.init();
+
+    benchTask.start(test_spsc_queue_task, TASK_PRIORITY_DEFAULT, "SPSC_Queue_Bench");
+    consumerTask.start(test_spsc_queue_consumer, TASK_PRIORITY_DEFAULT + 1, "SPSC_Queue_Consumer");
+    wakerTask.start(test_spsc_queue_waker, TASK_PRIORITY_DEFAULT - 1, "SPSC_Queue_Waker");
+
+    startScheduler();
+}
@@ -0,0 +1,103 @@
+#include "arduino_freertos.h"
+#include "rtos/rtos.hpp"
+#include <malloc.h>
+
+using namespace wrvcu;
+
+static void idle() {
+    while (true) {
+        Task::delay(1000);
+    }
+}
+
+/**
+ * @brief Starts tasks with each kind of callable the firmware uses, and checks the heap is untouched.
+ *
+ */
+class AllocTestDevice {
+    StaticTask<> task;
+
+public:
+    volatile bool ran = false;
+
+    void init() {
+        task.start(
+            [this] {
+                ran = true;
+                idle();
+            },
+            TASK_PRIORITY_DEFAULT, "Alloc_Member_Task");
+    }
+};
+
+static AllocTestDevice allocDevice;
+static StaticTask<> lambdaTask;
+static StaticTask<> captureTask;
+static StaticTask<> pointerTask;
+static StaticTask<> reportTask;
+
+static volatile uint32_t captured = 0;
+static volatile bool pointerRan = false;
+static volatile bool lambdaRan = false;
+
+static size_t heapBefore;
+static size_t heapAfter;
+
+/**
+ * @brief Get the bytes of heap in use. glibc 2.33 deprecated mallinfo for mallinfo2, while newlib only has mallinfo.
+ *
+ */
+static size_t heapInUse() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return mallinfo2().uordblks;
+#else
+    return mallinfo().uordblks;
+#endif
+}
+
+void test_task_alloc_pointer() {
+    pointerRan = true;
+    idle();
+}
+
+void test_task_alloc_report() {
+    Task::delay(100);
+
+    bool pass = heapAfter == heapBefore && allocDevice.ran && lambdaRan && pointerRan && captured == 0x1234 + 42;
+
+    printf("Task alloc: heap %u bytes before starting tasks, %u after\n", (unsigned)heapBefore, (unsigned)heapAfter);
+    printf("  member %d, lambda %d, function pointer %d, captures %lx\n", allocDevice.ran, lambdaRan, pointerRan,
+        (unsigned long)captured);
+    printf("%s\n", pass ? "PASS: task creation made no heap allocations" : "FAIL");
+
+    idle();
+}
+
+void test_task_alloc() {
+    uint32_t a = 0x1234;
+    uint32_t b = 42;
+    volatile uint32_t* out = &captured;
+
+    heapBefore = heapInUse();
+
+    allocDevice.init();
+    lambdaTask.start(
+        [] {
+            lambdaRan = true;
+            idle();
+        },
+        TASK_PRIORITY_DEFAULT, "Alloc_Lambda_Task");
+    captureTask.start(
+        [a, b, out] {
+            *out = a + b;
+            idle();
+        },
+        TASK_PRIORITY_DEFAULT, "Alloc_Capture_Task");
+    pointerTask.start(test_task_alloc_pointer, TASK_PRIORITY_DEFAULT, "Alloc_Pointer_Task");
+
+    heapAfter = heapInUse();
+
+    reportTask.start(test_task_alloc_report, TASK_PRIORITY_DEFAULT - 1, "Alloc_Report_Task");
+
+    startScheduler();
+}
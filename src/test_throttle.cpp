@@ -7,7 +7,7 @@
 
 using namespace wrvcu;
 
-static Task taskA;
+static StaticTask<> taskA;
 static TractiveSystem ts;
 static ThrottleManager throttleT;
 static ADC adc(ADC_CS, &SPI);
@@ -30,6 +30,7 @@ void test_throttle_task() {
         // Serial.println(throttleT.APPS2.read());
         // throttleT.APPS1.getSaturatedFraction();
         // Serial.println(throttleT.getBrakeRegenFraction());
+        throttleT.sample();
         Serial.println(throttleT.getTorqueRequestFraction());
 
         // in tractivesystem.cpp
@@ -0,0 +1,101 @@
+#include "arduino_freertos.h"
+#include "rtos/rtos.hpp"
+#include <can/VirtualCANBus.hpp>
+
+using namespace wrvcu;
+
+#define VIRTUAL_BENCH_STEP_MS 2000
+#define VIRTUAL_BENCH_ID 0x100
+#define VIRTUAL_BENCH_FILLER_ID 0x050 // wins arbitration against the measured frames
+
+static VirtualCANBus virtualBus;
+static VirtualCANController senderCan;
+static VirtualCANController receiverCan;
+
+static Queue<CANMessage, 256> receiveQueue;
+
+static StaticTask<> senderTask;
+static StaticTask<> receiverTask;
+static StaticTask<> benchTask;
+
+static CANLatencyStats latency;
+static volatile uint32_t received = 0;
+
+/**
+ * @brief Sends a frame every millisecond, stamped with the time it was sent.
+ *
+ */
+void test_virtual_can_sender() {
+    uint32_t prev = Task::millis();
+    while (true) {
+        CANMessage msg;
+        msg.id = VIRTUAL_BENCH_ID;
+        uint32_t now = micros();
+        memcpy(msg.data, &now, sizeof(now));
+
+        senderCan.send(msg);
+        Task::delay_until(&prev, 1);
+    }
+}
+
+void test_virtual_can_receiver() {
+    while (true) {
+        CANMessage msg = receiveQueue.dequeue(TIMEOUT_MAX);
+
+        uint32_t sent;
+        memcpy(&sent, msg.data, sizeof(sent));
+        latency.add(micros() - sent);
+        received = received + 1;
+    }
+}
+
+void test_virtual_can_task() {
+    const float loads[] = { 0.0f, 0.25f, 0.5f, 0.75f, 0.9f, 0.95f, 1.0f };
+
+    printf("Virtual CAN: 1 kHz frames at %lu bit/s against background load\n", (unsigned long)virtualBus.getBitRate());
+
+    for (float load : loads) {
+        virtualBus.setBackgroundLoad(load, VIRTUAL_BENCH_FILLER_ID);
+        Task::delay(100); // settle
+
+        latency = CANLatencyStats();
+        received = 0;
+        uint32_t lossesBefore = senderCan.get_arbitration_losses();
+        uint32_t droppedBefore = senderCan.get_tx_dropped();
+        VirtualCANBusStats before = virtualBus.getStats();
+
+        Task::delay(VIRTUAL_BENCH_STEP_MS);
+
+        VirtualCANBusStats after = virtualBus.getStats();
+        uint64_t busTime = after.busTime_us - before.busTime_us;
+        uint32_t measuredLoad = busTime > 0 ? (uint32_t)((after.bits - before.bits) * 1000000ULL / virtualBus.getBitRate() * 100 / busTime) : 0;
+
+        printf("  load %3d%% (measured %3lu%%): %lu received, latency avg %lu max %lu us, %lu arbitration losses, %lu dropped\n",
+            (int)(load * 100), (unsigned long)measuredLoad, (unsigned long)received, (unsigned long)latency.avg_us(),
+            (unsigned long)latency.max_us, (unsigned long)(senderCan.get_arbitration_losses() - lossesBefore),
+            (unsigned long)(senderCan.get_tx_dropped() - droppedBefore));
+    }
+
+    while (true) {
+        Task::delay(1000);
+    }
+}
+
+void test_virtual_can() {
+    receiveQueue.init();
+
+    virtualBus.attach(&senderCan);
+    virtualBus.attach(&receiverCan);
+
+    receiverCan.subscribe(VIRTUAL_BENCH_ID, &receiveQueue, CANOverflowPolicy::OverwriteOldest);
+
+    senderCan.init(TASK_PRIORITY_DEFAULT);
+    receiverCan.init(TASK_PRIORITY_DEFAULT);
+    virtualBus.init(TASK_PRIORITY_DEFAULT + 3);
+
+    senderTask.start(test_virtual_can_sender, TASK_PRIORITY_DEFAULT + 1, "Virtual_Sender");
+    receiverTask.start(test_virtual_can_receiver, TASK_PRIORITY_DEFAULT + 1, "Virtual_Receiver");
+    benchTask.start(test_virtual_can_task, TASK_PRIORITY_DEFAULT, "Virtual_CAN_Bench");
+
+    startScheduler();
+}
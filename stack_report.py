@@ -0,0 +1,90 @@
+"""
+Suggests task stack depths from the STACK lines printed by Task::print_stack_report.
+
+Collect the serial output over a representative run (driving, logging, charging), then:
+    python stack_report.py run1.log run2.log
+or pipe the serial output straight in. The peak usage of each task across every report is taken, and the suggested
+depth is that plus a margin, rounded up. Set the suggestions in the *_TASK_STACK_DEPTH define for each task. A task's
+deepest path is often one that logs a warning, so include runs which reach them.
+
+Size the car's tasks from the Teensy's output only. The host build prints a report too, see host/src/endurance.cpp, but
+its x86-64 frames, glibc printf and stubbed drivers (Wire, SPI, SD, serial) use the stack differently, so it's only good
+for the host's own simulated nodes.
+"""
+
+import argparse
+import math
+import re
+import sys
+from pathlib import Path
+
+# STACK CAN1_Task                  2048 words,   412 used,  20%
+STACK_LINE = re.compile(r"STACK (\S+)\s+(\d+) words,\s+(\d+) used")
+
+WORD_BYTES = 4
+
+SOURCE_DIRS = [Path.cwd() / "src", Path.cwd() / "include"]
+
+
+def find_source(task_name):
+    # the file which starts the task, where its stack depth is set. The kernel may have cut the name short.
+    needle = f'"{task_name}'
+    for directory in SOURCE_DIRS:
+        for path in sorted(directory.rglob("*.[ch]pp")):
+            if needle in path.read_text(errors="ignore"):
+                return path.relative_to(Path.cwd())
+    return None
+
+
+def read_reports(files):
+    depth = {}
+    peak = {}
+
+    for f in files:
+        for line in f:
+            match = STACK_LINE.search(line)
+            if not match:
+                continue
+
+            name = match[1]
+            depth[name] = int(match[2])
+            peak[name] = max(peak.get(name, 0), int(match[3]))
+
+    return depth, peak
+
+
+def suggest(used, margin, minimum, round_to):
+    words = max(used * (1 + margin / 100), minimum)
+    return int(math.ceil(words / round_to) * round_to)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("logs", nargs="*", type=argparse.FileType("r", errors="ignore"), help="serial logs, default stdin")
+    parser.add_argument("--margin", type=float, default=50, help="headroom over the measured peak, percent")
+    parser.add_argument("--min", type=int, default=256, help="smallest depth to suggest, words")
+    parser.add_argument("--round", type=int, default=64, help="round depths up to a multiple of this, words")
+    args = parser.parse_args()
+
+    depth, peak = read_reports(args.logs or [sys.stdin])
+    if not depth:
+        print("No STACK lines found")
+        return
+
+    print(f"{'Task':<24} {'Depth':>6} {'Peak':>6} {'Suggest':>8} {'Saves':>8}  Source")
+
+    total_saved = 0
+    for name in sorted(depth):
+        suggested = suggest(peak[name], args.margin, args.min, args.round)
+        saved = (depth[name] - suggested) * WORD_BYTES
+        total_saved += saved
+
+        source = find_source(name) or "?"
+        warning = "  ** over 90% used **" if peak[name] * 10 > depth[name] * 9 else ""
+        print(f"{name:<24} {depth[name]:>6} {peak[name]:>6} {suggested:>8} {saved:>7}B  {source}{warning}")
+
+    print(f"Total: {total_saved} bytes reclaimed ({total_saved / 1024:.1f} KB)")
+
+
+if __name__ == "__main__":
+    main()